@@ -4,6 +4,7 @@
 //
 
 #include <cpplinq/linq.hpp>
+#include <cpplinq/linq_file.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -11,37 +12,35 @@
 #include <string>
 #include <vector>
 #include <exception>
-#include <regex>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
 
 using namespace std;
 
-vector<string> load_data();
-string extract_value(const string& input, const string& key);
 
 
 void run()
 {
     using namespace cpplinq;
 
+    // args refers to the line it was read from, in the mapping of the file
     struct item {
-        string args;
-        int    concurrency;
-        double time;
-
-        item(const string& input) {
-            args =              extract_value(input, "args");
-            concurrency = atoi( extract_value(input, "concurrency").c_str() );
-            time =        atof( extract_value(input, "time").c_str() );
+        string_ref args;
+        int        concurrency;
+        double     time;
+
+        item(string_ref input) {
+            args =        key_value(input, "args");
+            concurrency = to_long( key_value(input, "concurrency") );
+            time =        to_double( key_value(input, "time") );
         }
     };
 
-    auto data_unparsed = load_data();
+    auto data_unparsed = from_lines("data.txt");
     auto data_parsed = 
-        from(data_unparsed)
-        .select([](const string& line) { return item(line); })
+        data_unparsed
+        .select([](string_ref line) { return item(line); })
         .to_vector();
     
     cout << "data loaded" << endl;
@@ -94,35 +93,3 @@ int main()
         cerr << "exception: " << e.what() << endl;
     }
 }
-
-vector<string> load_data()
-{
-	ifstream datafile("data.txt");
-    vector<string> v;
-    string line;
-
-    if (datafile.fail())
-        throw logic_error("could not find file");
-
-    while(getline(datafile, line))
-        v.push_back(line);
-
-    return v;
-}
-
-regex key_value_pair("'([^\']*)'\\s*[:,]\\s*(\\d+(?:\\.\\d+)?|'[^']*')");
-
-string extract_value(const string& input, const string& key)
-{
-    const std::sregex_iterator end;
-    for (std::sregex_iterator i(input.cbegin(), input.cend(), key_value_pair);
-        i != end;
-        ++i)
-    {
-        if ((*i)[1] == key)
-        {
-            return (*i)[2];
-        }
-    }
-    throw std::range_error("search key not found");
-}
@@ -42,6 +42,20 @@
 /// 
 /// 
 /// 
+/// from_lines(path), from_records(path, delimiter)
+/// =================================================
+/// -   Result: Query
+/// -   Powers: input, forward, bidirectional, random access
+/// -   Header: linq_file.hpp
+/// 
+/// Construct a new query over the lines, or the records separated by `delimiter`, of a file. The
+/// file is mapped into memory and scanned for the line ends with vector instructions when the query
+/// is made. The elements are `string_ref`s into the mapping, which stays mapped while a query or
+/// cursor over it is alive, so no line is copied. `key_value(line, key)` finds a value in a line
+/// such as `{'key': value}` without copying, and `to_long` and `to_double` parse it.
+/// 
+/// 
+/// 
 /// query.select(map)
 /// ==========================
 /// -   Result: Query 
@@ -63,11 +77,102 @@
 /// 
 /// 
 /// 
-/// query.groupby(keymap [, keyequal])
-/// ====================================
+/// query.groupby(keymap [, keyless])
+/// ===================================
 /// Result: Query of groups. Each group has a 'key' field, and is a query of elements from the input.
 /// Powers: forward
 /// 
+/// Groups are in the order their first elements appear in the input, and the elements of a group
+/// keep their input order. Keys are hashed with std::hash and compared with ==, unless `keyless`
+/// is given to order them instead. Keys that std::hash cannot hash are ordered with <. The input
+/// is read only as far as needed to produce the next group or element.
+/// 
+/// 
+/// 
+/// query.join(inner, outerkey, innerkey, result)
+/// ===============================================
+/// -   Result: Query
+/// -   Powers: input, forward
+/// 
+/// For each element `x` of the input and each element `y` of the query `inner` with
+/// `outerkey(x) == innerkey(y)`, computes `result(x, y)`. Results are in input order, and the
+/// matches of one element are in the order of `inner`. Keys are hashed with std::hash.
+/// 
+/// `inner` is read into a hash index each time the query is enumerated, before the first element.
+/// The input is read only as far as needed to produce the next result.
+/// 
+/// 
+/// 
+/// query.group_join(inner, outerkey, innerkey, result)
+/// =====================================================
+/// -   Result: Query
+/// -   Powers: input, forward
+/// 
+/// For each element `x` of the input, computes `result(x, matches)`, where `matches` is a query of
+/// the elements `y` of `inner` with `outerkey(x) == innerkey(y)`. It is empty when there are none.
+/// 
+/// 
+/// 
+/// query.order_by(keymap [, less]), query.order_by_descending(keymap [, less])
+/// ==============================================================================
+/// -   Result: Ordered query
+/// -   Powers: random access
+/// 
+/// The elements of the input, ordered by `keymap(x)`. Keys are compared with `<`, or with `less`.
+/// The order is stable. The input is read and sorted each time the query is enumerated, before the
+/// first element. The elements are read into an array once and only their positions are sorted.
+/// 
+/// `take(n)` and `first()` on an ordered query select the first `n` elements with
+/// `std::nth_element` and only sort those.
+/// 
+/// ordered.then_by(keymap [, less]), ordered.then_by_descending(keymap [, less])
+/// ===============================================================================
+/// -   Result: Ordered query
+/// 
+/// Orders elements whose earlier keys are equal by one more key.
+/// 
+/// ordered.parallel_sort([n])
+/// ==========================
+/// -   Result: Ordered query
+/// 
+/// Sorts on `n` threads (default: one per hardware thread) when the input is large enough. Key
+/// selectors and comparers are then called from several threads at once. A `take(n)` or `first()`
+/// still selects on one thread.
+/// 
+/// 
+/// 
+/// query.distinct([hash, eq [, expected]])
+/// ==========================================
+/// -   Result: Query
+/// -   Powers: input, forward
+/// 
+/// The first occurrence of each element, in input order. Elements are hashed with std::hash and
+/// compared with ==, or with `hash` and `eq`. The input is read only as far as the next new
+/// element. Each cursor keeps one copy of every distinct element it has passed, shared with the
+/// copies of the cursor. `expected`, the number of distinct elements, presizes that set so it does
+/// not grow while the input is read.
+/// 
+/// 
+/// 
+/// query.union_with(second [, hash, eq [, expected]])
+/// ====================================================
+/// -   Result: Query
+/// -   Powers: input, forward
+/// 
+/// The distinct elements of the input, then those of `second` that were not in the input.
+/// 
+/// 
+/// 
+/// query.intersect(second [, hash, eq [, expected]]), query.except(second [, hash, eq [, expected]])
+/// ====================================================================================================
+/// -   Result: Query
+/// -   Powers: input, forward
+/// 
+/// The distinct elements of the input that are (intersect) or are not (except) in `second`, in input
+/// order. `second` is read into a hash set each time the query is enumerated, before the first
+/// element, and `expected` is the number of distinct elements in `second`. The input is read as the
+/// query is enumerated.
+/// 
 /// 
 /// 
 /// query.any([pred])
@@ -117,11 +222,42 @@
 /// _TODO: should use inner container's iterator distance type instead._
 /// 
 /// (Zero-argument) Returns the number of elements in the range. 
-/// Equivalent to `std::distance(query.begin(), query.end())`
+/// Equivalent to `std::distance(query.begin(), query.end())`. Constant time when the query knows its
+/// size: random access queries, `take` of them and `late_bind` of them.
 /// 
 /// (One-argument) Returns the number of elements for whicht `pred(element)` is true.
 /// Equivalent to `query.where(pred).count()`
 /// 
+/// 
+/// 
+/// query.sum(), query.average()
+/// ==============================
+/// -   Result: element type, double
+/// 
+/// Adds up the elements. `average` throws std::logic_error on an empty sequence.
+/// 
+/// `sum`, `average`, `min`, `max`, `count(pred)` and `aggregate(std::plus<T>())` read arrays of
+/// arithmetic values (from a std::vector or a pointer range) directly instead of through the cursor,
+/// using SSE2 or AVX2 when the compiler targets them. `select` over such an array is read the same
+/// way. `take` and `skip` over an array, and over a `select` of one, are read in batches of 256
+/// elements that go through the same loops. Floating point sums are then added in a different
+/// order, so the last bits may differ from `std::accumulate`.
+/// 
+/// 
+/// 
+/// query.parallel([n])
+/// ===================
+/// -   Result: parallel query
+/// -   Powers: random access input only
+/// 
+/// Splits the input into `n` ranges (default: one per hardware thread) and evaluates each range on
+/// its own thread. A parallel query supports `select` and `where`, which run fused within each range,
+/// and `aggregate`, `count`, `any`, `all`, `min`, `max`, `sum` and `to_vector`, which merge the
+/// results of the ranges. `to_vector` keeps the input order. The functions passed to a parallel
+/// query are called from several threads at once, and those passed to `aggregate`, `min` and `max`
+/// must be associative. `aggregate(seed, fn, merge)` starts each range from `seed` and combines
+/// the ranges with `merge`.
+/// 
  
 
 
@@ -140,10 +276,15 @@
 #include <numeric>
 #include <list>
 #include <map>
+#include <deque>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <type_traits>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 
 
@@ -156,6 +297,16 @@
 #define LINQ_USE_RTTI 1
 #endif
 
+// vector instructions for reductions over arrays, define LINQ_NO_SIMD to use scalar loops only
+#if !defined(LINQ_NO_SIMD)
+#if defined(__AVX2__)
+#define LINQ_USE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINQ_USE_SSE2 1
+#endif
+#endif
+
 #if defined(__clang__)
 #if __has_feature(cxx_rvalue_references)
 #define LINQ_USE_RVALUEREF 1
@@ -174,9 +325,14 @@
 #include "linq_take.hpp"
 #include "linq_skip.hpp"
 #include "linq_groupby.hpp"
+#include "linq_join.hpp"
+#include "linq_set.hpp"
 #include "linq_where.hpp"
 #include "linq_last.hpp"
 #include "linq_selectmany.hpp"
+#include "linq_reduce.hpp"
+#include "linq_parallel.hpp"
+#include "linq_orderby.hpp"
 
 
 
@@ -234,9 +390,27 @@ public:
         return linq_groupby<Collection, KeyFn>(c, std::move(fn) );
     }
 
-    // TODO: groupby(keyfn, eq)
+    template <class KeyFn, class Compare>
+    linq_driver< linq_groupby<Collection, KeyFn, Compare> > groupby(KeyFn fn, Compare comp)
+    {
+        return linq_groupby<Collection, KeyFn, Compare>(c, std::move(fn), std::move(comp) );
+    }
+
+    template <class Inner, class OuterKeyFn, class InnerKeyFn, class ResultFn>
+    linq_driver< linq_join<Collection, Inner, OuterKeyFn, InnerKeyFn, ResultFn> >
+        join(const linq_driver<Inner>& inner, OuterKeyFn outerKey, InnerKeyFn innerKey, ResultFn resultFn) const
+    {
+        return linq_join<Collection, Inner, OuterKeyFn, InnerKeyFn, ResultFn>(
+            c, inner.c, std::move(outerKey), std::move(innerKey), std::move(resultFn));
+    }
 
-    // TODO: join...
+    template <class Inner, class OuterKeyFn, class InnerKeyFn, class ResultFn>
+    linq_driver< linq_group_join<Collection, Inner, OuterKeyFn, InnerKeyFn, ResultFn> >
+        group_join(const linq_driver<Inner>& inner, OuterKeyFn outerKey, InnerKeyFn innerKey, ResultFn resultFn) const
+    {
+        return linq_group_join<Collection, Inner, OuterKeyFn, InnerKeyFn, ResultFn>(
+            c, inner.c, std::move(outerKey), std::move(innerKey), std::move(resultFn));
+    }
 
     template <class Selector>
     linq_driver< linq_select<Collection, Selector> > select(Selector sel) const {
@@ -267,13 +441,7 @@ public:
     template <class Fn>
     element_type aggregate(Fn fn) const
     {
-        auto it = begin();
-        if (it == end()) {
-            return element_type();
-        }
-        
-        reference_type first = *it;
-        return std::accumulate(++it, end(), first, fn);
+        return aggregate_(fn, std::is_same<Fn, std::plus<element_type>>());
     }
 
     template <class T, class Fn>
@@ -296,7 +464,10 @@ public:
         return it == end();
     }
 
-    // TODO: average
+    double average() const
+    {
+        return average_(reduce_source());
+    }
 
 #if !defined(__clang__)
     // Clang complains that linq_driver is not complete until the closing brace 
@@ -316,36 +487,44 @@ public:
     }
 
     typename std::iterator_traits<iterator>::difference_type count() const {
-        return std::distance(begin(), end());
+        auto cur = c.get_cursor();
+        auto hint = util::get_size_hint(cur);
+        if (hint.kind == util::size_hint::exact_size) {
+            return hint.count;
+        }
+        typename std::iterator_traits<iterator>::difference_type n = 0;
+        for (; !cur.empty(); cur.inc()) {
+            ++n;
+        }
+        return n;
     }
 
     template <class Predicate>
     typename std::iterator_traits<iterator>::difference_type count(Predicate p) const {
-        auto filtered = this->where(p);
-        return std::distance(begin(filtered), end(filtered));
+        return count_(p, reduce_source());
     }
 
     // TODO: default_if_empty
     
-    // TODO: distinct()
-    // TODO: distinct(cmp)
+    linq_driver< linq_distinct<Collection, default_hash, default_equality> > distinct() const {
+        return distinct(default_hash(), default_equality());
+    }
+
+    template <class Hash, class Equal>
+    linq_driver< linq_distinct<Collection, Hash, Equal> > distinct(Hash hash, Equal eq, size_t expected = 0) const {
+        return linq_distinct<Collection, Hash, Equal>(c, std::move(hash), std::move(eq), expected);
+    }
 
     reference_type element_at(size_t ix) const {
         auto cur = c.get_cursor();
-        while(ix && !cur.empty()) {
-            cur.inc();
-            --ix;
-        }
+        util::advance(cur, ix);
         if (cur.empty()) { throw std::logic_error("index out of bounds"); }
         else             { return cur.get(); }
     }
 
     element_type element_at_or_default(size_t ix) const {
         auto cur = c.get_cursor();
-        while(ix && !cur.empty()) {
-            cur.inc();
-            -- ix;
-        }
+        util::advance(cur, ix);
         if (cur.empty()) { return element_type(); }
         else             { return cur.get(); }
     }
@@ -354,11 +533,22 @@ public:
         return !this->any();
     }
 
-    // TODO: except(second)
-    // TODO: except(second, eq)
+    template <class Collection2>
+    linq_driver< linq_except<Collection, Collection2, default_hash, default_equality> >
+        except(const linq_driver<Collection2>& second) const
+    {
+        return except(second, default_hash(), default_equality());
+    }
+
+    template <class Collection2, class Hash, class Equal>
+    linq_driver< linq_except<Collection, Collection2, Hash, Equal> >
+        except(const linq_driver<Collection2>& second, Hash hash, Equal eq, size_t expected = 0) const
+    {
+        return linq_except<Collection, Collection2, Hash, Equal>(c, second.c, std::move(hash), std::move(eq), expected);
+    }
 
     reference_type first() const {
-        auto cur = c.get_cursor();
+        auto cur = detail::take_limit(c, 1).get_cursor();
         if (cur.empty()) { throw std::logic_error("index out of bounds"); }
         else             { return cur.get(); }
     }
@@ -374,7 +564,7 @@ public:
     }
 
     element_type first_or_default() const {
-        auto cur = c.get_cursor();
+        auto cur = detail::take_limit(c, 1).get_cursor();
         if (cur.empty()) { return element_type(); }
         else             { return cur.get(); }
     }
@@ -389,8 +579,19 @@ public:
         else             { return cur.get(); }
     }
     
-    // TODO: intersect(second)
-    // TODO: intersect(second, eq)
+    template <class Collection2>
+    linq_driver< linq_intersect<Collection, Collection2, default_hash, default_equality> >
+        intersect(const linq_driver<Collection2>& second) const
+    {
+        return intersect(second, default_hash(), default_equality());
+    }
+
+    template <class Collection2, class Hash, class Equal>
+    linq_driver< linq_intersect<Collection, Collection2, Hash, Equal> >
+        intersect(const linq_driver<Collection2>& second, Hash hash, Equal eq, size_t expected = 0) const
+    {
+        return linq_intersect<Collection, Collection2, Hash, Equal>(c, second.c, std::move(hash), std::move(eq), expected);
+    }
 
     // note: forward cursors and beyond can provide a clone, so we can refer to the element directly
     typename std::conditional< 
@@ -425,7 +626,7 @@ public:
 
     reference_type max() const
     {
-        return max(std::less<element_type>());
+        return max_(reduce_source());
     }
 
     template <class Compare>
@@ -440,7 +641,7 @@ public:
 
     reference_type min() const
     {
-        return min(std::less<element_type>());
+        return min_(reduce_source());
     }
 
     template <class Compare>
@@ -453,10 +654,30 @@ public:
         return *it;
     }
 
-    // TODO: order_by(sel)
-    // TODO: order_by(sel, less)
-    // TODO: order_by_descending(sel)
-    // TODO: order_by_descending(sel, less)
+    template <class KeyFn>
+    linq_driver< linq_order_by<Collection, KeyFn, default_less> > order_by(KeyFn fn) const {
+        return linq_order_by<Collection, KeyFn, default_less>(c, std::move(fn), default_less(), false);
+    }
+
+    template <class KeyFn, class Less>
+    linq_driver< linq_order_by<Collection, KeyFn, Less> > order_by(KeyFn fn, Less less) const {
+        return linq_order_by<Collection, KeyFn, Less>(c, std::move(fn), std::move(less), false);
+    }
+
+    template <class KeyFn>
+    linq_driver< linq_order_by<Collection, KeyFn, default_less> > order_by_descending(KeyFn fn) const {
+        return linq_order_by<Collection, KeyFn, default_less>(c, std::move(fn), default_less(), true);
+    }
+
+    template <class KeyFn, class Less>
+    linq_driver< linq_order_by<Collection, KeyFn, Less> > order_by_descending(KeyFn fn, Less less) const {
+        return linq_order_by<Collection, KeyFn, Less>(c, std::move(fn), std::move(less), true);
+    }
+
+    // only for ordered queries
+    linq_driver<Collection> parallel_sort(size_t threads = 0) const {
+        return c.parallel_sort(threads);
+    }
 
     // TODO: sequence_equal(second)
     // TODO: sequence_equal(second, eq)
@@ -469,28 +690,68 @@ public:
 
     // TODO: skip_while(pred)
 
-    // TODO: sum
+    element_type sum() const
+    {
+        return sum_(reduce_source());
+    }
 
     linq_driver<linq_take<Collection>> take(size_t n) const {
-        return linq_take<Collection>(c, n);
+        return linq_take<Collection>(detail::take_limit(c, n), n);
     }
 
     // TODO: take_while
 
-    // TODO: then_by / then_by_descending ?
+    // only for ordered queries
+    template <class KeyFn, class Ordered = Collection>
+    linq_driver< typename Ordered::template then_by_result<KeyFn, default_less>::type > then_by(KeyFn fn) const {
+        return c.then_by(std::move(fn), default_less(), false);
+    }
+
+    template <class KeyFn, class Less, class Ordered = Collection>
+    linq_driver< typename Ordered::template then_by_result<KeyFn, Less>::type > then_by(KeyFn fn, Less less) const {
+        return c.then_by(std::move(fn), std::move(less), false);
+    }
+
+    template <class KeyFn, class Ordered = Collection>
+    linq_driver< typename Ordered::template then_by_result<KeyFn, default_less>::type > then_by_descending(KeyFn fn) const {
+        return c.then_by(std::move(fn), default_less(), true);
+    }
+
+    template <class KeyFn, class Less, class Ordered = Collection>
+    linq_driver< typename Ordered::template then_by_result<KeyFn, Less>::type > then_by_descending(KeyFn fn, Less less) const {
+        return c.then_by(std::move(fn), std::move(less), true);
+    }
 
     // TODO: to_...
 
-    // TODO: union(second)
-    // TODO: union(eq)
+    // union is a keyword
+    template <class Collection2>
+    linq_driver< linq_union<Collection, Collection2, default_hash, default_equality> >
+        union_with(const linq_driver<Collection2>& second) const
+    {
+        return union_with(second, default_hash(), default_equality());
+    }
+
+    template <class Collection2, class Hash, class Equal>
+    linq_driver< linq_union<Collection, Collection2, Hash, Equal> >
+        union_with(const linq_driver<Collection2>& second, Hash hash, Equal eq, size_t expected = 0) const
+    {
+        return linq_union<Collection, Collection2, Hash, Equal>(c, second.c, std::move(hash), std::move(eq), expected);
+    }
 
     // TODO: zip
     
+    // -------------------- parallel execution --------------------
+
+    linq_parallel<Collection> parallel(size_t threads = 0) const {
+        return linq_parallel<Collection>(c, threads);
+    }
+
     // -------------------- conversion methods --------------------
 
     std::vector<typename Collection::cursor::element_type> to_vector() const 
     {
-        return std::vector<typename Collection::cursor::element_type>(begin(), end());
+        return to_vector_(typename util::batch_category<typename Collection::cursor>::type());
     }
 
     // -------------------- container/range methods --------------------
@@ -503,13 +764,13 @@ public:
 
     typename std::iterator_traits<iterator>::reference
         operator[](size_t ix) const {
-        return *(begin()+=ix);
+        return element_at(ix);
     }
 
     // -------------------- collection methods (leaky abstraction) --------------------
 
     typedef typename Collection::cursor cursor;
-    cursor get_cursor() { return c.get_cursor(); }
+    cursor get_cursor() const { return c.get_cursor(); }
 
     linq_driver< dynamic_collection<typename Collection::cursor::reference_type> >
         late_bind() const
@@ -518,6 +779,260 @@ public:
     }
 
 private: 
+    template <class TC2>
+    friend class linq_driver;
+
+    // reductions over arrays skip the cursor, see linq_reduce.hpp
+    typedef typename detail::reduce_source<Collection>::type
+        reduce_source;
+
+    // queries whose cursor reads in batches are reduced a batch at a time
+    typedef std::integral_constant<bool,
+            util::is_batch_cursor<typename Collection::cursor>::value
+            && std::is_default_constructible<typename util::batch_value<typename Collection::cursor>::type>::value>
+        batched;
+
+    typedef std::integral_constant<bool, batched::value && std::is_arithmetic<element_type>::value>
+        batched_arithmetic;
+
+    // calls fn(first, last) for each batch of elements
+    template <class Fn>
+    void for_each_batch(Fn fn) const
+    {
+        for_each_batch_(fn, typename util::batch_category<typename Collection::cursor>::type());
+    }
+    // an array is one batch, read where it is
+    template <class Fn>
+    void for_each_batch_(Fn fn, span_cursor_tag) const
+    {
+        auto in = c.get_cursor().span();
+        if (in.first != in.second) {
+            fn(in.first, in.second);
+        }
+    }
+    template <class Fn>
+    void for_each_batch_(Fn fn, batch_cursor_tag) const
+    {
+        typedef typename util::batch_value<typename Collection::cursor>::type value_type;
+        std::vector<value_type> buffer(detail::batch_size);
+        auto cur = c.get_cursor();
+        for (;;) {
+            size_t n = cur.get_batch(buffer.data(), buffer.size());
+            if (n == 0) {
+                break;
+            }
+            fn(static_cast<const value_type*>(buffer.data()), static_cast<const value_type*>(buffer.data() + n));
+        }
+    }
+
+    // an array is copied in one piece
+    std::vector<typename Collection::cursor::element_type> to_vector_(span_cursor_tag) const
+    {
+        auto in = c.get_cursor().span();
+        return std::vector<typename Collection::cursor::element_type>(in.first, in.second);
+    }
+    // the vector is allocated once when the size is known. the range
+    //   constructor would read the query twice, once to count it.
+    template <class Tag>
+    std::vector<typename Collection::cursor::element_type> to_vector_(Tag) const
+    {
+        std::vector<typename Collection::cursor::element_type> result;
+        auto cur = c.get_cursor();
+        auto hint = util::get_size_hint(cur);
+        if (hint.kind != util::size_hint::unknown_size) {
+            result.reserve(hint.count);
+        }
+        for (; !cur.empty(); cur.inc()) {
+            result.push_back(cur.get());
+        }
+        return result;
+    }
+
+    template <class Fn>
+    element_type aggregate_(Fn fn, std::false_type) const
+    {
+        return aggregate_(fn, std::false_type(), batched());
+    }
+    template <class Fn>
+    element_type aggregate_(Fn fn, std::false_type, std::true_type) const
+    {
+        auto result = element_type();
+        bool first = true;
+        for_each_batch([&](const element_type* it, const element_type* last) {
+            if (first) {
+                result = *it++;
+                first = false;
+            }
+            result = std::accumulate(it, last, result, fn);
+        });
+        return result;
+    }
+    template <class Fn>
+    element_type aggregate_(Fn fn, std::false_type, std::false_type) const
+    {
+        auto it = begin();
+        if (it == end()) {
+            return element_type();
+        }
+        
+        reference_type first = *it;
+        return std::accumulate(++it, end(), first, fn);
+    }
+    template <class Fn>
+    element_type aggregate_(Fn, std::true_type) const
+    {
+        return sum();
+    }
+
+    double average_(detail::generic_source_tag) const
+    {
+        return average_(batched_arithmetic());
+    }
+    double average_(std::true_type) const
+    {
+        auto total = element_type();
+        size_t n = 0;
+        for_each_batch([&](const element_type* first, const element_type* last) {
+            total += detail::sum(first, last);
+            n += last - first;
+        });
+        if (n == 0) { throw std::logic_error("average performed on empty range"); }
+        return double(total) / n;
+    }
+    double average_(std::false_type) const
+    {
+        auto total = element_type();
+        size_t n = 0;
+        for (auto cur = c.get_cursor(); !cur.empty(); cur.inc(), ++n) {
+            total += cur.get();
+        }
+        if (n == 0) { throw std::logic_error("average performed on empty range"); }
+        return double(total) / n;
+    }
+    double average_(detail::contiguous_source_tag) const
+    {
+        auto r = detail::contiguous_range(c);
+        if (r.first == r.second) { throw std::logic_error("average performed on empty range"); }
+        return double(detail::sum(r.first, r.second)) / (r.second - r.first);
+    }
+    double average_(detail::projected_source_tag) const
+    {
+        auto r = detail::contiguous_range(c.source());
+        if (r.first == r.second) { throw std::logic_error("average performed on empty range"); }
+        return double(detail::sum_scalar(r.first, r.second, c.selector())) / (r.second - r.first);
+    }
+
+    template <class Predicate>
+    typename std::iterator_traits<iterator>::difference_type count_(Predicate p, detail::generic_source_tag) const {
+        return count_(p, batched());
+    }
+    template <class Predicate>
+    typename std::iterator_traits<iterator>::difference_type count_(Predicate p, std::true_type) const {
+        typename std::iterator_traits<iterator>::difference_type n = 0;
+        for_each_batch([&](const element_type* first, const element_type* last) {
+            n += detail::count_if(first, last, p);
+        });
+        return n;
+    }
+    template <class Predicate>
+    typename std::iterator_traits<iterator>::difference_type count_(Predicate p, std::false_type) const {
+        auto filtered = this->where(p);
+        return std::distance(filtered.begin(), filtered.end());
+    }
+    template <class Predicate>
+    typename std::iterator_traits<iterator>::difference_type count_(Predicate p, detail::contiguous_source_tag) const {
+        auto r = detail::contiguous_range(c);
+        return detail::count_if(r.first, r.second, p);
+    }
+    template <class Predicate>
+    typename std::iterator_traits<iterator>::difference_type count_(Predicate p, detail::projected_source_tag) const {
+        auto r = detail::contiguous_range(c.source());
+        auto& sel = c.selector();
+        return detail::count_if(r.first, r.second, [&](decltype(*r.first) value) { return p(sel(value)); });
+    }
+
+    reference_type max_(detail::generic_source_tag) const
+    {
+        return max(std::less<element_type>());
+    }
+    reference_type max_(detail::contiguous_source_tag) const
+    {
+        auto r = detail::contiguous_range(c);
+        if (r.first == r.second) 
+            throw std::logic_error("max performed on empty range");
+
+        return *detail::max_element(r.first, r.second);
+    }
+    reference_type max_(detail::projected_source_tag) const
+    {
+        auto r = detail::contiguous_range(c.source());
+        if (r.first == r.second) 
+            throw std::logic_error("max performed on empty range");
+
+        auto& sel = c.selector();
+        element_type result = sel(*r.first);
+        for (auto it = r.first + 1; it != r.second; ++it) {
+            element_type value = sel(*it);
+            result = result < value ? value : result;
+        }
+        return result;
+    }
+
+    reference_type min_(detail::generic_source_tag) const
+    {
+        return min(std::less<element_type>());
+    }
+    reference_type min_(detail::contiguous_source_tag) const
+    {
+        auto r = detail::contiguous_range(c);
+        if (r.first == r.second) 
+            throw std::logic_error("min performed on empty range");
+
+        return *detail::min_element(r.first, r.second);
+    }
+    reference_type min_(detail::projected_source_tag) const
+    {
+        auto r = detail::contiguous_range(c.source());
+        if (r.first == r.second) 
+            throw std::logic_error("min performed on empty range");
+
+        auto& sel = c.selector();
+        element_type result = sel(*r.first);
+        for (auto it = r.first + 1; it != r.second; ++it) {
+            element_type value = sel(*it);
+            result = value < result ? value : result;
+        }
+        return result;
+    }
+
+    element_type sum_(detail::generic_source_tag) const
+    {
+        return sum_(batched_arithmetic());
+    }
+    element_type sum_(std::true_type) const
+    {
+        auto total = element_type();
+        for_each_batch([&](const element_type* first, const element_type* last) {
+            total += detail::sum(first, last);
+        });
+        return total;
+    }
+    element_type sum_(std::false_type) const
+    {
+        return std::accumulate(begin(), end(), element_type());
+    }
+
+    element_type sum_(detail::contiguous_source_tag) const
+    {
+        auto r = detail::contiguous_range(c);
+        return detail::sum(r.first, r.second);
+    }
+    element_type sum_(detail::projected_source_tag) const
+    {
+        auto r = detail::contiguous_range(c.source());
+        return detail::sum_scalar(r.first, r.second, c.selector());
+    }
+
     Collection c;
 };
  
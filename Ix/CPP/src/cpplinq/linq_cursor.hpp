@@ -45,6 +45,29 @@
 /// -   size(cur)     -> n
 /// -   truncate(n)         : keep only n more elements
 /// 
+/// Batch cursor (optional, any of the above)
+/// ==========================================
+/// -   get_batch(out, max) -> n : copies up to max elements to out and moves past them. 0 at the end.
+/// -   batch_category     :: { batch_cursor_tag, span_cursor_tag }
+/// 
+/// Span cursor (optional, also a batch cursor)
+/// ===========================================
+/// -   span(cur) -> (first, last) : pointers to the remaining elements, which are one array
+/// -   skip(cur, n)
+/// 
+/// Size hint (optional, any of the above)
+/// ======================================
+/// -   size_hint(cur) -> util::size_hint : how many elements are left, exactly or at most, if known
+/// 
+/// Random access cursors always know their exact size. select and take pass the hint of their input
+/// on, take(n) of a cursor without an exact size has at most n elements, and the cursors of
+/// late_bind ask the cursor they hide. count, to_vector, element_at and last use the hint.
+/// 
+/// Cursors without a batch_category are read one element at a time. Arrays are span cursors, select
+/// and take keep the batch_category of their input, and terminal operators that reduce arithmetic
+/// values read batched queries a batch at a time. where reads one element at a time, as compacting
+/// the matches into a batch costs more than the loop it would replace.
+/// 
 /// As well, cursors must define the appropriate type/typedefs:
 /// -   cursor_category  :: { onepass_cursor_tag, forward_cursor_tag, bidirectional_cursor_tag, random_access_cursor_tag }
 /// -   element_type
@@ -63,6 +86,16 @@ namespace cpplinq {
     struct bidirectional_cursor_tag : forward_cursor_tag {}; 
     struct random_access_cursor_tag : bidirectional_cursor_tag {};
 
+    struct no_batch_tag {};
+    struct batch_cursor_tag {};
+    struct span_cursor_tag : batch_cursor_tag {};
+
+    namespace detail
+    {
+        // the number of elements terminal operators read at a time
+        static const size_t batch_size = 256;
+    }
+
     struct noread_cursor_tag {}; // TODO: remove if not used
     struct readonly_cursor_tag : noread_cursor_tag {};
     struct readwrite_cursor_tag : readonly_cursor_tag {};
@@ -134,6 +167,111 @@ namespace cpplinq {
         struct cursor_type {
             typedef decltype(cursor(*static_cast<Collection*>(0))) type;
         };
+
+        // the batch_category of a cursor, or no_batch_tag if it has none
+        template <class Cursor>
+        struct batch_category
+        {
+        private:
+            template <class C> static typename C::batch_category test(int);
+            template <class C> static no_batch_tag test(...);
+        public:
+            typedef decltype(test<Cursor>(0)) type;
+        };
+
+        template <class Cursor>
+        struct is_batch_cursor
+            : std::is_convertible<typename batch_category<Cursor>::type, batch_cursor_tag>
+        {
+        };
+
+        // the type of the elements get_batch writes
+        template <class Cursor>
+        struct batch_value
+        {
+            typedef typename std::remove_cv<typename Cursor::element_type>::type type;
+        };
+
+        // true for iterators that walk one array: pointers and the iterators of std::vector
+        template <class Iter, class T = typename std::iterator_traits<Iter>::value_type>
+        struct is_contiguous_iterator
+            : std::integral_constant<bool,
+                std::is_pointer<Iter>::value
+                || (!std::is_same<T, bool>::value
+                    && (std::is_same<Iter, typename std::vector<T>::iterator>::value
+                        || std::is_same<Iter, typename std::vector<T>::const_iterator>::value))>
+        {
+        };
+
+        // how many elements a cursor has left, as far as it knows without
+        //   reading them
+        struct size_hint
+        {
+            enum kind_type { unknown_size, at_most_size, exact_size };
+
+            kind_type   kind;
+            size_t      count;
+
+            static size_hint unknown() { size_hint h = { unknown_size, 0 }; return h; }
+            static size_hint at_most(size_t n) { size_hint h = { at_most_size, n }; return h; }
+            static size_hint exact(size_t n) { size_hint h = { exact_size, n }; return h; }
+        };
+
+        namespace detail
+        {
+            template <class Cursor>
+            size_hint measure_size_hint_(const Cursor& cur, random_access_cursor_tag)
+            {
+                return size_hint::exact(cur.size() - cur.position());
+            }
+            template <class Cursor>
+            size_hint measure_size_hint_(const Cursor&, onepass_cursor_tag)
+            {
+                return size_hint::unknown();
+            }
+
+            // a cursor that knows its own hint is asked first, a random
+            //   access cursor without one is measured
+            template <class Cursor>
+            auto get_size_hint_(const Cursor& cur, int)
+                -> decltype(cur.size_hint())
+            {
+                return cur.size_hint();
+            }
+            template <class Cursor>
+            size_hint get_size_hint_(const Cursor& cur, long)
+            {
+                return measure_size_hint_(cur, typename Cursor::cursor_category());
+            }
+
+            template <class Cursor>
+            void advance_(Cursor& cur, size_t n, random_access_cursor_tag)
+            {
+                const size_t left = cur.size() - cur.position();
+                cur.skip(n < left ? n : left);
+            }
+            template <class Cursor>
+            void advance_(Cursor& cur, size_t n, onepass_cursor_tag)
+            {
+                for (; n != 0 && !cur.empty(); --n) {
+                    cur.inc();
+                }
+            }
+        }
+
+        template <class Cursor>
+        size_hint get_size_hint(const Cursor& cur)
+        {
+            return detail::get_size_hint_(cur, 0);
+        }
+
+        // moves cur past n elements, or to its end if it has fewer. random
+        //   access cursors skip them.
+        template <class Cursor>
+        void advance(Cursor& cur, size_t n)
+        {
+            detail::advance_(cur, n, typename Cursor::cursor_category());
+        }
     }
     
     // simultaniously models a cursor and a cursor-collection
@@ -149,6 +287,11 @@ namespace cpplinq {
             reference_type;
         typedef typename util::iter_to_cursor_category<Iterator>::type
             cursor_category;
+        typedef typename std::conditional<
+                util::is_contiguous_iterator<Iterator>::value,
+                span_cursor_tag,
+                no_batch_tag>::type
+            batch_category;
 
         void forget() { start = current; }
         bool empty() const { return current == fin; }
@@ -167,14 +310,32 @@ namespace cpplinq {
         }
         
         void skip(ptrdiff_t n) { current += n; }
-        size_t size() { return fin-start; }
-        void position() { return current-start; }
+        size_t size() const { return fin-start; }
+        size_t position() const { return current-start; }
         void truncate(size_t n) {
-            if (n > fin-current) {
+            if (n < size_t(fin-current)) {
                 fin = current + n;
             }
         }
 
+        // only for contiguous iterators
+        size_t get_batch(typename util::batch_value<iter_cursor>::type* out, size_t max) {
+            size_t n = std::min(max, size_t(fin - current));
+            std::copy(current, current + n, out);
+            current += n;
+            return n;
+        }
+        std::pair<typename std::remove_reference<reference_type>::type*, typename std::remove_reference<reference_type>::type*>
+            span() const
+        {
+            typedef typename std::remove_reference<reference_type>::type* pointer;
+            if (current == fin) {
+                return std::make_pair(pointer(), pointer());
+            }
+            pointer first = &*current;
+            return std::make_pair(first, first + (fin - current));
+        }
+
 
         iter_cursor(Iterator start, Iterator fin)
         : current(start)
@@ -207,6 +368,9 @@ namespace cpplinq {
 
         virtual T get() const = 0;
 
+        virtual util::size_hint size_hint() const = 0;
+        virtual void skip(size_t n) = 0;
+
         virtual ~cursor_interface() {}
     };
 
@@ -233,6 +397,14 @@ namespace cpplinq {
             {
                 return innerCursor.get();
             }
+            virtual util::size_hint size_hint() const
+            {
+                return util::get_size_hint(innerCursor);
+            }
+            virtual void skip(size_t n)
+            {
+                util::advance(innerCursor, n);
+            }
             virtual cursor_interface<T>* copy() const 
             {
                 return new instance(*this);
@@ -270,10 +442,15 @@ namespace cpplinq {
             *this = iter_cursor<Iterator>(start, end);
         }
 
+        void forget() { } // nop on forward-only cursors
         bool empty() const { return !myCur || myCur->empty(); }
         void inc() { myCur->inc(); }
         T get() const { return myCur->get(); }
 
+        // the hidden cursor knows its size and skips in constant time if it is random access
+        util::size_hint size_hint() const { return myCur ? myCur->size_hint() : util::size_hint::exact(0); }
+        void skip(size_t n) { if (myCur) { myCur->skip(n); } }
+
         dynamic_cursor& operator=(dynamic_cursor other)
         {
             std::swap(myCur, other.myCur);
@@ -281,6 +458,15 @@ namespace cpplinq {
         }
     };
 
+    namespace util
+    {
+        template <class T>
+        void advance(dynamic_cursor<T>& cur, size_t n)
+        {
+            cur.skip(n);
+        }
+    }
+
     template <class T>
     struct container_interface
     {
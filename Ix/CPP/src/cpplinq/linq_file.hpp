@@ -0,0 +1,463 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+// queries over the lines or records of a file, read in place from a
+//   memory mapping. this header includes the operating system headers for
+//   the mapping, so it is not included by linq.hpp.
+
+#if !defined(CPPLINQ_LINQ_FILE_HPP)
+#define CPPLINQ_LINQ_FILE_HPP
+#pragma once
+
+#include "linq.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#pragma push_macro("min")
+#pragma push_macro("max")
+#undef min
+#undef max
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(LINQ_USE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(LINQ_USE_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace cpplinq
+{
+    // a range of characters that are owned elsewhere, as std::string_view
+    class string_ref
+    {
+    public:
+        typedef const char* iterator;
+        typedef const char* const_iterator;
+
+        string_ref() : first(nullptr), length(0)
+        {
+        }
+        string_ref(const char* first, std::size_t length) : first(first), length(length)
+        {
+        }
+        string_ref(const char* first, const char* last) : first(first), length(last - first)
+        {
+        }
+        string_ref(const char* s) : first(s), length(std::strlen(s))
+        {
+        }
+        string_ref(const std::string& s) : first(s.data()), length(s.size())
+        {
+        }
+
+        const char* data() const { return first; }
+        std::size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        const char* begin() const { return first; }
+        const char* end() const { return first + length; }
+        char operator[](std::size_t i) const { return first[i]; }
+
+        std::string str() const { return std::string(first, length); }
+
+        string_ref substr(std::size_t pos, std::size_t n = std::size_t(-1)) const
+        {
+            if (pos > length) {
+                throw std::logic_error("substr out of bounds");
+            }
+            return string_ref(first + pos, n < length - pos ? n : length - pos);
+        }
+
+        friend bool operator==(string_ref a, string_ref b)
+        {
+            return a.length == b.length && (a.length == 0 || std::memcmp(a.first, b.first, a.length) == 0);
+        }
+        friend bool operator!=(string_ref a, string_ref b) { return !(a == b); }
+        friend bool operator<(string_ref a, string_ref b)
+        {
+            int c = std::memcmp(a.first, b.first, a.length < b.length ? a.length : b.length);
+            return c != 0 ? c < 0 : a.length < b.length;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, string_ref s)
+        {
+            return os.write(s.first, s.length);
+        }
+
+    private:
+        const char*     first;
+        std::size_t     length;
+    };
+
+    // numbers at the start of text, as std::strtol and std::strtod. the
+    //   text need not be null terminated.
+    inline long to_long(string_ref text)
+    {
+        char buffer[32];
+        std::size_t n = text.size() < sizeof(buffer) - 1 ? text.size() : sizeof(buffer) - 1;
+        std::memcpy(buffer, text.data(), n);
+        buffer[n] = '\0';
+        return std::strtol(buffer, nullptr, 10);
+    }
+    inline double to_double(string_ref text)
+    {
+        char buffer[64];
+        std::size_t n = text.size() < sizeof(buffer) - 1 ? text.size() : sizeof(buffer) - 1;
+        std::memcpy(buffer, text.data(), n);
+        buffer[n] = '\0';
+        return std::strtod(buffer, nullptr);
+    }
+
+    namespace detail
+    {
+        inline bool key_char(char c)
+        {
+            return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+        inline bool space_char(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+        inline const char* skip_space(const char* p, const char* last)
+        {
+            while (p != last && space_char(*p)) {
+                ++p;
+            }
+            return p;
+        }
+    }
+
+    // the value of key in text such as {'key': value}, ('key', value) or
+    //   key=value. the key is quoted or stands alone, and is followed by one
+    //   of :,= and the value. a quoted value is returned without its quotes,
+    //   any other value runs to the next space or one of ,;)]}.
+    //
+    // the value is part of text, nothing is copied.
+    inline string_ref key_value(string_ref text, string_ref key)
+    {
+        if (key.empty()) {
+            throw std::logic_error("empty key");
+        }
+        const char* const first = text.begin();
+        const char* const last = text.end();
+        for (const char* p = first; (p = std::search(p, last, key.begin(), key.end())) != last; ++p) {
+            const char* after = p + key.size();
+            if (p != first && (p[-1] == '\'' || p[-1] == '"')) {
+                if (after == last || *after != p[-1]) {
+                    continue;
+                }
+                ++after;
+            } else if ((p != first && detail::key_char(p[-1])) || (after != last && detail::key_char(*after))) {
+                continue;
+            }
+
+            const char* value = detail::skip_space(after, last);
+            if (value == last || (*value != ':' && *value != ',' && *value != '=')) {
+                continue;
+            }
+            value = detail::skip_space(value + 1, last);
+            if (value == last) {
+                continue;
+            }
+            if (*value == '\'' || *value == '"') {
+                const char* close = std::find(value + 1, last, *value);
+                if (close != last) {
+                    return string_ref(value + 1, close);
+                }
+                continue;
+            }
+            const char* end = value;
+            while (end != last && !detail::space_char(*end) && !std::strchr(",;)]}", *end)) {
+                ++end;
+            }
+            if (end != value) {
+                return string_ref(value, end);
+            }
+        }
+        throw std::logic_error("key not found");
+    }
+
+    // a whole file, mapped read only into memory
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const std::string& path) : first(nullptr), length(0)
+        {
+#if defined(_WIN32)
+            HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                throw std::logic_error("could not open file");
+            }
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(file, &size) || static_cast<unsigned long long>(size.QuadPart) > std::size_t(-1)) {
+                ::CloseHandle(file);
+                throw std::logic_error("could not map file");
+            }
+            length = static_cast<std::size_t>(size.QuadPart);
+            if (length != 0) {
+                // the view keeps the file open
+                HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping != nullptr) {
+                    first = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                    ::CloseHandle(mapping);
+                }
+            }
+            ::CloseHandle(file);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::logic_error("could not open file");
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || static_cast<unsigned long long>(st.st_size) > std::size_t(-1)) {
+                ::close(fd);
+                throw std::logic_error("could not map file");
+            }
+            length = static_cast<std::size_t>(st.st_size);
+            if (length != 0) {
+                // the mapping keeps the file open
+                void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    first = static_cast<const char*>(p);
+                }
+            }
+            ::close(fd);
+#endif
+            if (length != 0 && first == nullptr) {
+                throw std::logic_error("could not map file");
+            }
+        }
+
+        ~mapped_file()
+        {
+            if (first != nullptr) {
+#if defined(_WIN32)
+                ::UnmapViewOfFile(first);
+#else
+                ::munmap(const_cast<char*>(first), length);
+#endif
+            }
+        }
+
+        const char* data() const { return first; }
+        std::size_t size() const { return length; }
+
+    private:
+        mapped_file(const mapped_file&);
+        mapped_file& operator=(const mapped_file&);
+
+        const char*     first;
+        std::size_t     length;
+    };
+
+    namespace detail
+    {
+        inline unsigned lowest_bit(std::uint64_t mask)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long i;
+            _BitScanForward64(&i, mask);
+            return i;
+#elif defined(_MSC_VER)
+            unsigned long i;
+            if (_BitScanForward(&i, static_cast<unsigned long>(mask))) {
+                return i;
+            }
+            _BitScanForward(&i, static_cast<unsigned long>(mask >> 32));
+            return i + 32;
+#else
+            return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+        }
+
+        // calls fn(p) for each p in [first, last) that points to delimiter, in
+        //   order. 64 bytes are compared at a time, and only the blocks that
+        //   hold a delimiter are looked at again.
+        template <class Fn>
+        void for_each_delimiter(const char* first, const char* last, char delimiter, Fn fn)
+        {
+#if defined(LINQ_USE_AVX2)
+            const __m256i d = _mm256_set1_epi8(delimiter);
+            for (; last - first >= 64; first += 64) {
+                std::uint64_t mask =
+                    static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), d)))
+                    | static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + 32)), d)))) << 32;
+                for (; mask != 0; mask &= mask - 1) {
+                    fn(first + lowest_bit(mask));
+                }
+            }
+#elif defined(LINQ_USE_SSE2)
+            const __m128i d = _mm_set1_epi8(delimiter);
+            for (; last - first >= 64; first += 64) {
+                std::uint64_t mask = 0;
+                for (int i = 0; i != 4; ++i) {
+                    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 16 * i));
+                    mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, d)))) << (16 * i);
+                }
+                for (; mask != 0; mask &= mask - 1) {
+                    fn(first + lowest_bit(mask));
+                }
+            }
+#endif
+            for (; first != last; ++first) {
+                if (*first == delimiter) {
+                    fn(first);
+                }
+            }
+        }
+
+        // where the records of a mapped file end
+        struct record_index
+        {
+            std::shared_ptr<const mapped_file>  file;
+            // the offset of the delimiter after each record, or the size
+            //   of the file after the last one
+            std::vector<std::size_t>            ends;
+            // a line ending in \r\n is returned without the \r
+            bool                                trimCR;
+
+            string_ref record(std::size_t i) const
+            {
+                const char* data = file->data();
+                std::size_t start = i == 0 ? 0 : ends[i - 1] + 1;
+                std::size_t end = ends[i];
+                if (trimCR && end != start && data[end - 1] == '\r') {
+                    --end;
+                }
+                return string_ref(data + start, end - start);
+            }
+        };
+
+        inline std::shared_ptr<const record_index> index_records(const std::string& path, char delimiter, bool trimCR)
+        {
+            auto index = std::make_shared<record_index>();
+            index->file = std::make_shared<const mapped_file>(path);
+            index->trimCR = trimCR;
+
+            const char* data = index->file->data();
+            const std::size_t size = index->file->size();
+            auto& ends = index->ends;
+            for_each_delimiter(data, data + size, delimiter, [&](const char* p) {
+                ends.push_back(p - data);
+            });
+            // the last record need not end with a delimiter
+            if (size != 0 && (ends.empty() || ends.back() != size - 1)) {
+                ends.push_back(size);
+            }
+            return index;
+        }
+    }
+
+    // the records of a file, separated by a delimiter. the file is mapped
+    //   into memory and the records are found when the query is made. each
+    //   record is a string_ref into the mapping, which stays mapped while a
+    //   query or cursor over it is alive.
+    class linq_records
+    {
+    public:
+        class cursor
+        {
+        public:
+            typedef random_access_cursor_tag
+                cursor_category;
+            typedef string_ref
+                element_type;
+            typedef string_ref
+                reference_type;
+
+            explicit cursor(std::shared_ptr<const detail::record_index> index)
+            : index(std::move(index)), current(0), start(0), fin(this->index->ends.size())
+            {
+            }
+
+            void forget() { start = current; }
+            bool empty() const { return current == fin; }
+            void inc() {
+                if (current == fin) {
+                    throw std::logic_error("inc past end");
+                }
+                ++current;
+            }
+            reference_type get() const { return index->record(current); }
+
+            bool atbegin() const { return current == start; }
+            void dec() {
+                if (current == start) {
+                    throw std::logic_error("dec past begin");
+                }
+                --current;
+            }
+
+            void skip(ptrdiff_t n) { current += n; }
+            size_t size() const { return fin - start; }
+            size_t position() const { return current - start; }
+            void truncate(size_t n) {
+                if (n < fin - current) {
+                    fin = current + n;
+                }
+            }
+
+        private:
+            std::shared_ptr<const detail::record_index>     index;
+            size_t                                          current, start, fin;
+        };
+
+        explicit linq_records(std::shared_ptr<const detail::record_index> index) : index(std::move(index))
+        {
+        }
+
+        cursor get_cursor() const { return cursor(index); }
+
+    private:
+        std::shared_ptr<const detail::record_index> index;
+    };
+
+    // the lines of a file, without their \n or \r\n
+    inline linq_driver<linq_records> from_lines(const std::string& path)
+    {
+        return linq_records(detail::index_records(path, '\n', true));
+    }
+
+    // the records of a file, separated by delimiter
+    inline linq_driver<linq_records> from_records(const std::string& path, char delimiter)
+    {
+        return linq_records(detail::index_records(path, delimiter, false));
+    }
+}
+
+namespace std
+{
+    // fnv-1a
+    template <>
+    struct hash<cpplinq::string_ref>
+    {
+        size_t operator()(cpplinq::string_ref s) const
+        {
+            std::uint64_t h = 14695981039346656037ull;
+            for (char c : s) {
+                h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+}
+
+#pragma pop_macro("min")
+#pragma pop_macro("max")
+
+#endif // !defined(CPPLINQ_LINQ_FILE_HPP)
@@ -42,9 +42,250 @@ struct default_less
     }
 };
 
+// selects hashing for the keys of a groupby. keys are hashed with
+//   std::hash and compared with ==
+struct default_hash
+{
+    template <class T>
+    std::size_t operator()(const T& value) const {
+        return std::hash<T>()(value);
+    }
+};
+
+namespace detail
+{
+    // finds the group of each key. groups are numbered in the order
+    //   their keys were first seen. this form orders keys with Compare.
+    template <class Key, class Compare>
+    class group_index
+    {
+        typedef std::map<Key, std::uint32_t, Compare>
+            map_type;
+
+        map_type                index;
+        std::vector<const Key*> keys;
+
+    public:
+        explicit group_index(Compare comp) : index(comp)
+        {
+        }
+
+        // the group of key. a new key gets the group numbered size()
+        std::uint32_t find_or_insert(const Key& key)
+        {
+            auto pos = index.lower_bound(key);
+            if (pos != index.end() && !index.key_comp()(key, pos->first)) {
+                return pos->second;
+            }
+            auto group = static_cast<std::uint32_t>(keys.size());
+            pos = index.insert(pos, std::make_pair(key, group));
+            keys.push_back(&pos->first);
+            return group;
+        }
+
+        std::size_t size() const { return keys.size(); }
+        const Key& key(std::uint32_t group) const { return *keys[group]; }
+    };
+
+    // numbers keys in the order they were first inserted. open addressing
+    //   with linear probing, each slot keeps the hash of its key, so
+    //   probing only calls Equal when the hashes match and growing does not
+    //   hash again.
+    template <class Key, class Hash, class Equal>
+    class hash_index
+    {
+        static const std::uint32_t empty_slot = 0xFFFFFFFF;
+
+    public:
+        static const std::uint32_t npos = empty_slot;
+
+    private:
+        struct slot
+        {
+            std::size_t   hash;
+            std::uint32_t index;
+        };
+
+        std::vector<slot>       slots;
+        std::deque<Key>         keys;
+        int                     bits;
+        Hash                    hasher;
+        Equal                   equal;
+
+        // fibonacci hashing spreads hashes that only differ in high bits,
+        //   std::hash of an integer is often the integer itself
+        std::size_t position(std::size_t hash) const
+        {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        }
+
+        // the slot of key, or the empty slot where it belongs
+        std::size_t probe(const Key& key, std::size_t hash) const
+        {
+            const std::size_t mask = slots.size() - 1;
+            for (auto pos = position(hash);; pos = (pos + 1) & mask) {
+                const slot& s = slots[pos];
+                if (s.index == empty_slot || (s.hash == hash && equal(keys[s.index], key))) {
+                    return pos;
+                }
+            }
+        }
+
+        void grow(int newBits)
+        {
+            std::vector<slot> old(std::size_t(1) << newBits);
+            old.swap(slots);
+            bits = newBits;
+            const std::size_t mask = slots.size() - 1;
+            for (auto& s : slots) {
+                s.index = empty_slot;
+            }
+            for (auto& s : old) {
+                if (s.index == empty_slot) {
+                    continue;
+                }
+                auto pos = position(s.hash);
+                while (slots[pos].index != empty_slot) {
+                    pos = (pos + 1) & mask;
+                }
+                slots[pos] = s;
+            }
+        }
+
+    public:
+        // expected presizes the table for that many keys
+        hash_index(std::size_t expected, Hash hash, Equal eq)
+        : bits(0), hasher(std::move(hash)), equal(std::move(eq))
+        {
+            int size = 4;
+            while ((std::size_t(1) << size) < 2 * expected) {
+                ++size;
+            }
+            grow(size);
+        }
+
+        // the number of key. a new key gets the number size()
+        std::uint32_t find_or_insert(const Key& key)
+        {
+            const auto hash = hasher(key);
+            auto pos = probe(key, hash);
+            if (slots[pos].index != empty_slot) {
+                return slots[pos].index;
+            }
+            auto index = static_cast<std::uint32_t>(keys.size());
+            keys.push_back(key);
+            slots[pos].hash = hash;
+            slots[pos].index = index;
+            // keep at least half of the slots empty so probes stay short
+            if (keys.size() * 2 > slots.size()) {
+                grow(bits + 1);
+            }
+            return index;
+        }
+
+        // the number of key, or npos if it has none
+        std::uint32_t find(const Key& key) const
+        {
+            return slots[probe(key, hasher(key))].index;
+        }
+
+        std::size_t size() const { return keys.size(); }
+        const Key& key(std::uint32_t index) const { return keys[index]; }
+    };
+
+    // the hashed form, keys are hashed with std::hash and compared with ==
+    template <class Key>
+    class group_index<Key, default_hash>
+        : public hash_index<Key, default_hash, default_equality>
+    {
+    public:
+        explicit group_index(default_hash hash)
+        : hash_index<Key, default_hash, default_equality>(0, hash, default_equality())
+        {
+        }
+    };
+
+    // the elements of all groups, appended in input order to chunks that
+    //   never move. each element links to the next element of its group.
+    template <class T>
+    class group_arena
+    {
+        static const std::uint32_t chunk_bits = 12;
+        static const std::uint32_t chunk_size = 1 << chunk_bits;
+
+    public:
+        static const std::uint32_t npos = 0xFFFFFFFF;
+
+        struct node
+        {
+            template <class U>
+            explicit node(U&& value) : value(std::forward<U>(value)), next(npos)
+            {
+            }
+            T               value;
+            std::uint32_t   next;
+        };
+
+        template <class U>
+        std::uint32_t push_back(U&& value)
+        {
+            if (chunks.empty() || chunks.back().size() == chunk_size) {
+                chunks.push_back(std::vector<node>());
+                chunks.back().reserve(chunk_size);
+            }
+            chunks.back().emplace_back(std::forward<U>(value));
+            return count++;
+        }
+
+        node& at(std::uint32_t i) { return chunks[i >> chunk_bits][i & (chunk_size - 1)]; }
+
+        group_arena() : count(0)
+        {
+        }
+
+    private:
+        // a chunk is reserved up front, so its nodes are never reallocated
+        std::vector<std::vector<node>>  chunks;
+        std::uint32_t                   count;
+    };
+
+    // whether std::hash can hash a Key
+    template <class Key>
+    struct is_hashable
+    {
+        template <class K>
+        static auto test(int) -> decltype(std::hash<K>()(std::declval<const K&>()), std::true_type());
+        template <class K>
+        static std::false_type test(...);
+
+        static const bool value = decltype(test<Key>(0))::value;
+    };
+
+    // the group_index of a groupby. default_hash falls back to ordering
+    //   the keys with < when std::hash cannot hash them.
+    template <class Key, class Compare,
+              bool Ordered = std::is_same<Compare, default_hash>::value && !is_hashable<Key>::value>
+    struct group_index_for
+    {
+        typedef group_index<Key, Compare> type;
+        static Compare compare(Compare comp) { return comp; }
+    };
+    template <class Key, class Compare>
+    struct group_index_for<Key, Compare, true>
+    {
+        typedef group_index<Key, default_less> type;
+        static default_less compare(Compare) { return default_less(); }
+    };
+}
+
 // progressively constructs grouping as user iterates over groups and elements
-//   within each group. Performs this task by building a std::list of element 
-//   iterators with equal elements within each group.
+//   within each group. reads the input only as far as needed to find the next
+//   group, or the next element of a group. each element read is appended to
+//   a chunked arena and linked to the end of its group.
+//
+// keys are hashed by default (Compare = default_hash), or ordered with <
+//   when std::hash cannot hash them. any other Compare orders the keys in
+//   a std::map instead.
 // 
 // invariants:
 //   - relative order of groups corresponds to relative order of each group's first 
@@ -54,7 +295,8 @@ struct default_less
 // 
 // requires:
 //   Iter must be a forward iterator.
-template <class Collection, class KeyFn, class Compare = default_less>
+//   at most 2^32 - 1 elements.
+template <class Collection, class KeyFn, class Compare = default_hash>
 class linq_groupby
 {
     typedef typename Collection::cursor 
@@ -63,73 +305,117 @@ class linq_groupby
     typedef typename util::result_of<KeyFn(typename inner_cursor::element_type)>::type
         key_type;
 
-    typedef std::list<typename inner_cursor::element_type>
-        element_list_type;
+    typedef typename inner_cursor::element_type
+        element_type;
 
-    typedef group<typename element_list_type::iterator, key_type> 
-        group_type;
+    typedef detail::group_arena<element_type>
+        arena_type;
 
-    typedef std::list<group_type>
-        group_list_type;
+    struct impl_t;
 
-private:
-    struct impl_t
+public:
+    class element_iterator
+        : public std::iterator<std::forward_iterator_tag, element_type>
     {
-        // TODO: would be faster to use a chunked list, where
-        //   pointers are invalidated but iterators are not. Need 
-        //   benchmarks first
+        impl_t*         impl;
+        std::uint32_t   index;
+
+    public:
+        element_iterator() : impl(nullptr), index(arena_type::npos)
+        {
+        }
+        element_iterator(impl_t* impl, std::uint32_t index)
+        : impl(impl), index(index)
+        {
+        }
 
-        element_list_type                           elements;
-        std::list<group_type>                       groups;
-        std::map<key_type, group_type*, Compare>    groupIndex;
+        element_type& operator*() const { return impl->elements.at(index).value; }
+        element_type* operator->() const { return &impl->elements.at(index).value; }
 
+        element_iterator& operator++()
+        {
+            index = impl->next(index);
+            return *this;
+        }
+        element_iterator operator++(int)
+        {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
 
+        bool operator==(const element_iterator& other) const { return index == other.index; }
+        bool operator!=(const element_iterator& other) const { return index != other.index; }
+    };
+
+private:
+    typedef group<element_iterator, key_type> 
+        group_type;
+
+    struct impl_t
+    {
+        struct group_state
+        {
+            std::uint32_t first;
+            std::uint32_t last;
+        };
+
+        inner_cursor                                cur;
+        KeyFn                                       keySelector;
+        typename detail::group_index_for<key_type, Compare>::type
+                                                    groupIndex;
+        arena_type                                  elements;
+        std::vector<group_state>                    groups;
 
-        KeyFn keySelector;
-        Compare comp;
-        
         impl_t(inner_cursor cur,
                KeyFn keySelector,
                Compare comp = Compare()) 
-        : keySelector(keySelector)
-        , groupIndex(comp)
+        : cur(std::move(cur))
+        , keySelector(keySelector)
+        , groupIndex(detail::group_index_for<key_type, Compare>::compare(comp))
         {
-            // TODO: make lazy
-            insert_all(std::move(cur));
         }
 
-        void insert_all(inner_cursor cur)
+        // reads one element of the input into its group
+        bool pull()
         {
-            while(!cur.empty()) {
-                insert(cur.get());
-                cur.inc();
+            if (cur.empty()) {
+                return false;
             }
-        }
-        void insert(typename inner_cursor::reference_type element)
-        {
-            key_type key = keySelector(element);
-            auto groupPos = groupIndex.find(key);
-            if(groupPos == groupIndex.end()) {
+            auto e = elements.push_back(cur.get());
+            cur.inc();
+
+            auto g = groupIndex.find_or_insert(keySelector(elements.at(e).value));
+            if (g == groups.size()) {
                 // new group
-                bool firstGroup = groups.empty();
+                group_state newGroup = {e, e};
+                groups.push_back(newGroup);
+            } else {
+                // add to existing group at end
+                elements.at(groups[g].last).next = e;
+                groups[g].last = e;
+            }
+            return true;
+        }
 
-                elements.push_back(element);
-                if(!firstGroup) {
-                    // pop new element out of previous group
-                    --groups.back().fin; 
+        bool has_group(std::size_t g)
+        {
+            while (groups.size() <= g) {
+                if (!pull()) {
+                    return false;
                 }
+            }
+            return true;
+        }
 
-                // build new group
-                groups.push_back(group_type(key));
-                group_type& newGroup = groups.back();
-
-                groupIndex.insert( std::make_pair(key, &newGroup) );
-
-                newGroup.fin = elements.end();
-                --(newGroup.start = newGroup.fin);
-            } else {
-                // add to existing group at end
-                elements.insert(groupPos->second->end(), element);
+        // the element after e in its group, reading the input until it is found
+        std::uint32_t next(std::uint32_t e)
+        {
+            for (;;) {
+                auto n = elements.at(e).next;
+                if (n != arena_type::npos || !pull()) {
+                    return n;
+                }
             }
         }
     };
@@ -148,30 +434,30 @@ public:
         cursor(inner_cursor   cur, 
                KeyFn          keyFn,
                Compare        comp = Compare()) 
+        : impl(new impl_t(std::move(cur), keyFn, comp))
+        , current(0)
         {
-            impl.reset(new impl_t(cur, keyFn, comp));
-            inner   = impl->groups.begin();
-            fin     = impl->groups.end();
         }
 
         void forget() { } // nop on forward-only cursors
         bool empty() const {
-            return inner == fin;
+            return !impl->has_group(current);
         }
         void inc() {
-            if (inner == fin) {
+            if (empty()) {
                 throw std::logic_error("attempt to iterate past end of range");
             }
-            ++inner;
+            ++current;
         }
         reference_type get() const {
-            return *inner;
+            group_type result(impl->groupIndex.key(current));
+            result.start = element_iterator(impl.get(), impl->groups[current].first);
+            return result;
         }
         
     private:
         std::shared_ptr<impl_t> impl;
-        typename std::list<group_type>::iterator inner;
-        typename std::list<group_type>::iterator fin;
+        std::uint32_t current;
     };
 
     linq_groupby(Collection     c, 
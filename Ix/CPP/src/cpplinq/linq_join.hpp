@@ -0,0 +1,227 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#if !defined(CPPLINQ_LINQ_JOIN_HPP)
+#define CPPLINQ_LINQ_JOIN_HPP
+#pragma once
+
+namespace cpplinq
+{
+    template <class Collection>
+    class linq_driver;
+
+    namespace detail
+    {
+        // the elements of a sequence in one array, ordered by key. the
+        //   elements of a key are adjacent and keep their input order, so a
+        //   lookup is one probe of the hash table and one range of the array.
+        template <class Key, class T>
+        class join_index
+        {
+            typedef group_index<Key, default_hash>
+                index_type;
+
+            index_type                  groups;
+            // the elements of group g are [offsets[g], offsets[g + 1])
+            std::vector<std::uint32_t>  offsets;
+            std::vector<T>              elements;
+
+        public:
+            template <class Cursor, class KeyFn>
+            join_index(Cursor cur, const KeyFn& keyFn) : groups(default_hash())
+            {
+                std::vector<T> values;
+                std::vector<std::uint32_t> owners;
+                for (; !cur.empty(); cur.inc()) {
+                    values.push_back(cur.get());
+                    owners.push_back(groups.find_or_insert(keyFn(values.back())));
+                }
+
+                // a stable counting sort of the elements by group
+                offsets.assign(groups.size() + 1, 0);
+                for (auto g : owners) {
+                    ++offsets[g + 1];
+                }
+                for (std::size_t g = 0; g != groups.size(); ++g) {
+                    offsets[g + 1] += offsets[g];
+                }
+                std::vector<std::uint32_t> order(values.size());
+                std::vector<std::uint32_t> next(offsets.begin(), offsets.end() - 1);
+                for (std::uint32_t i = 0; i != values.size(); ++i) {
+                    order[next[owners[i]]++] = i;
+                }
+                elements.reserve(values.size());
+                for (auto i : order) {
+                    elements.push_back(std::move(values[i]));
+                }
+            }
+
+            // the elements of key, empty if there are none
+            std::pair<const T*, const T*> find(const Key& key) const
+            {
+                auto g = groups.find(key);
+                if (g == index_type::npos) {
+                    return std::pair<const T*, const T*>(nullptr, nullptr);
+                }
+                const T* first = elements.data();
+                return std::make_pair(first + offsets[g], first + offsets[g + 1]);
+            }
+        };
+    }
+
+    // pairs each element of the outer sequence with each element of the inner
+    //   sequence that has an equal key. the inner sequence is read into a
+    //   join_index when a cursor is made, the outer sequence is read as the
+    //   cursor moves.
+    //
+    // results are in the order of the outer sequence, and the matches of one
+    //   outer element are in the order of the inner sequence.
+    //
+    // requires:
+    //   keys are hashed with std::hash and compared with ==.
+    //   at most 2^32 - 1 inner elements.
+    template <class Outer, class Inner, class OuterKeyFn, class InnerKeyFn, class ResultFn>
+    class linq_join
+    {
+        typedef typename Outer::cursor
+            outer_cursor;
+        typedef typename std::remove_cv<typename Inner::cursor::element_type>::type
+            inner_element;
+        typedef typename std::decay<typename util::result_of<InnerKeyFn(inner_element)>::type>::type
+            key_type;
+        typedef detail::join_index<key_type, inner_element>
+            index_type;
+
+    public:
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename outer_cursor::cursor_category>::type
+                cursor_category;
+            typedef typename util::result_of<ResultFn(typename outer_cursor::element_type, inner_element)>::type
+                element_type;
+            typedef element_type
+                reference_type;
+
+            cursor(const outer_cursor& cur, std::shared_ptr<const index_type> index, const OuterKeyFn& outerKey, const ResultFn& resultFn)
+            : cur(cur), index(std::move(index)), outerKey(outerKey), resultFn(resultFn), match(nullptr, nullptr)
+            {
+                seek();
+            }
+
+            void forget() { cur.forget(); }
+            bool empty() const { return cur.empty(); }
+            void inc() {
+                if (++match.first == match.second) {
+                    cur.inc();
+                    seek();
+                }
+            }
+            reference_type get() const {
+                return resultFn(cur.get(), *match.first);
+            }
+
+        private:
+            // stops on the first outer element, from this one on, that has matches
+            void seek() {
+                for (; !cur.empty(); cur.inc()) {
+                    match = index->find(outerKey(cur.get()));
+                    if (match.first != match.second) {
+                        break;
+                    }
+                }
+            }
+
+            outer_cursor                            cur;
+            std::shared_ptr<const index_type>       index;
+            OuterKeyFn                              outerKey;
+            ResultFn                                resultFn;
+            std::pair<const inner_element*, const inner_element*> match;
+        };
+
+        linq_join(const Outer& outer, const Inner& inner, OuterKeyFn outerKey, InnerKeyFn innerKey, ResultFn resultFn)
+        : outer(outer), inner(inner), outerKey(std::move(outerKey)), innerKey(std::move(innerKey)), resultFn(std::move(resultFn))
+        {
+        }
+
+        cursor get_cursor() const {
+            auto index = std::make_shared<const index_type>(inner.get_cursor(), innerKey);
+            return cursor(outer.get_cursor(), std::move(index), outerKey, resultFn);
+        }
+
+    private:
+        Outer       outer;
+        Inner       inner;
+        OuterKeyFn  outerKey;
+        InnerKeyFn  innerKey;
+        ResultFn    resultFn;
+    };
+
+    // pairs each element of the outer sequence with a query of the elements
+    //   of the inner sequence that have an equal key. outer elements without
+    //   matches are paired with an empty query.
+    template <class Outer, class Inner, class OuterKeyFn, class InnerKeyFn, class ResultFn>
+    class linq_group_join
+    {
+        typedef typename Outer::cursor
+            outer_cursor;
+        typedef typename std::remove_cv<typename Inner::cursor::element_type>::type
+            inner_element;
+        typedef typename std::decay<typename util::result_of<InnerKeyFn(inner_element)>::type>::type
+            key_type;
+        typedef detail::join_index<key_type, inner_element>
+            index_type;
+
+    public:
+        typedef linq_driver<iter_cursor<const inner_element*>>
+            group_type;
+
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename outer_cursor::cursor_category>::type
+                cursor_category;
+            typedef typename util::result_of<ResultFn(typename outer_cursor::element_type, group_type)>::type
+                element_type;
+            typedef element_type
+                reference_type;
+
+            cursor(const outer_cursor& cur, std::shared_ptr<const index_type> index, const OuterKeyFn& outerKey, const ResultFn& resultFn)
+            : cur(cur), index(std::move(index)), outerKey(outerKey), resultFn(resultFn)
+            {
+            }
+
+            void forget() { cur.forget(); }
+            bool empty() const { return cur.empty(); }
+            void inc() { cur.inc(); }
+            reference_type get() const {
+                auto match = index->find(outerKey(cur.get()));
+                return resultFn(cur.get(), group_type(iter_cursor<const inner_element*>(match.first, match.second)));
+            }
+
+        private:
+            outer_cursor                            cur;
+            std::shared_ptr<const index_type>       index;
+            OuterKeyFn                              outerKey;
+            ResultFn                                resultFn;
+        };
+
+        linq_group_join(const Outer& outer, const Inner& inner, OuterKeyFn outerKey, InnerKeyFn innerKey, ResultFn resultFn)
+        : outer(outer), inner(inner), outerKey(std::move(outerKey)), innerKey(std::move(innerKey)), resultFn(std::move(resultFn))
+        {
+        }
+
+        cursor get_cursor() const {
+            auto index = std::make_shared<const index_type>(inner.get_cursor(), innerKey);
+            return cursor(outer.get_cursor(), std::move(index), outerKey, resultFn);
+        }
+
+    private:
+        Outer       outer;
+        Inner       inner;
+        OuterKeyFn  outerKey;
+        InnerKeyFn  innerKey;
+        ResultFn    resultFn;
+    };
+}
+
+#endif // !defined(CPPLINQ_LINQ_JOIN_HPP)
@@ -22,18 +22,26 @@ namespace cpplinq {
 
     // TODO: bidirectional iterator in constant time
 
+    // a cursor that knows its size moves straight to the last element.
+    //   otherwise a copy of the cursor is kept at the latest element. the
+    //   copy is constructed in place, so cursors need not be assignable.
     template <class Cursor>
     typename Cursor::reference_type
         linq_last_(Cursor c, forward_cursor_tag)
     {
         if (c.empty()) { throw std::logic_error("last() out of bounds"); }
-        Cursor best = c;
+        auto hint = util::get_size_hint(c);
+        if (hint.kind == util::size_hint::exact_size) {
+            util::advance(c, hint.count - 1);
+            return c.get();
+        }
+        util::maybe<Cursor> best(c);
         for(;;) {
             c.inc();
             if (c.empty()) break;
-            best = c;
+            best.replace(c);
         }
-        return best.get();
+        return best->get();
     }
 
     template <class Cursor>
@@ -41,7 +49,7 @@ namespace cpplinq {
         linq_last_(Cursor c, random_access_cursor_tag)
     {
         if (c.empty()) { throw std::logic_error("last() out of bounds"); }
-        c.skip(c.size()-1);
+        c.skip(c.size() - c.position() - 1);
         return c.get();
     }
 
@@ -61,14 +69,8 @@ namespace cpplinq {
     typename Cursor::element_type
         linq_last_or_default_(Cursor c, forward_cursor_tag)
     {
-        if (c.empty()) { throw std::logic_error("last() out of bounds"); }
-        Cursor best = c;
-        for(;;) {
-            c.inc();
-            if (c.empty()) break;
-            best = c;
-        }
-        return best.get();
+        if (c.empty()) { return typename Cursor::element_type(); }
+        return linq_last_(std::move(c), forward_cursor_tag());
     }
 
     template <class Cursor>
@@ -76,7 +78,7 @@ namespace cpplinq {
         linq_last_or_default_(Cursor c, random_access_cursor_tag)
     {
         if (c.empty()) { return typename Cursor::element_type(); }
-        c.skip(c.size()-1);
+        c.skip(c.size() - c.position() - 1);
         return c.get();
     }
 
@@ -0,0 +1,380 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#if !defined(CPPLINQ_LINQ_ORDERBY_HPP)
+#define CPPLINQ_LINQ_ORDERBY_HPP
+#pragma once
+
+namespace cpplinq
+{
+    namespace detail
+    {
+        // the keys of an ordering after the first, from then_by and
+        //   then_by_descending. each key only decides between elements
+        //   that are equal on all the keys before it.
+        template <class KeyFn, class Less, class Next>
+        struct order_key;
+
+        // the end of the keys, all elements are equal
+        struct order_end
+        {
+            template <class T>
+            int compare(const T&, const T&) const { return 0; }
+        };
+
+        // the keys with one more key at the end
+        template <class Keys, class KeyFn, class Less>
+        struct order_append;
+
+        template <class KeyFn, class Less>
+        struct order_append<order_end, KeyFn, Less>
+        {
+            typedef order_key<KeyFn, Less, order_end> type;
+
+            static type append(const order_end&, KeyFn keyFn, Less less, bool descending) {
+                return type(std::move(keyFn), std::move(less), descending, order_end());
+            }
+        };
+
+        template <class KeyFn1, class Less1, class Next, class KeyFn, class Less>
+        struct order_append<order_key<KeyFn1, Less1, Next>, KeyFn, Less>
+        {
+            typedef order_key<KeyFn1, Less1, typename order_append<Next, KeyFn, Less>::type> type;
+
+            static type append(const order_key<KeyFn1, Less1, Next>& keys, KeyFn keyFn, Less less, bool descending) {
+                return type(keys.keyFn, keys.less, keys.descending,
+                    order_append<Next, KeyFn, Less>::append(keys.next, std::move(keyFn), std::move(less), descending));
+            }
+        };
+
+        template <class KeyFn, class Less, class Next>
+        struct order_key
+        {
+            order_key(KeyFn keyFn, Less less, bool descending, Next next)
+            : keyFn(std::move(keyFn)), less(std::move(less)), descending(descending), next(std::move(next))
+            {
+            }
+
+            // < 0 when a comes first, > 0 when b comes first, 0 when they are equal
+            template <class T>
+            int compare(const T& a, const T& b) const {
+                auto ka = keyFn(a);
+                auto kb = keyFn(b);
+                if (less(ka, kb)) { return descending ? 1 : -1; }
+                if (less(kb, ka)) { return descending ? -1 : 1; }
+                return next.compare(a, b);
+            }
+
+            KeyFn   keyFn;
+            Less    less;
+            bool    descending;
+            Next    next;
+        };
+
+        // the number of elements each thread of a parallel sort gets at least
+        static const size_t parallel_sort_min = 1 << 14;
+
+        // the largest limit that is selected with a heap while reading the input
+        static const size_t order_heap_max = 1024;
+    }
+
+    // sorts the input when a cursor is made. the elements are read into an
+    //   array once and are not moved after that, the sort orders their
+    //   positions. the first key of each element is computed once, the
+    //   keys of then_by only to break ties.
+    //
+    // a limit, set by take(n) and first(), only sorts the first n elements.
+    //   a small limit keeps them in a heap as the input is read, a larger one
+    //   selects them with std::nth_element.
+    //
+    // the order is stable, elements with equal keys keep their input order.
+    //
+    // requires:
+    //   at most 2^32 - 1 elements.
+    template <class Collection, class KeyFn, class Less, class Next = detail::order_end>
+    class linq_order_by
+    {
+        typedef typename Collection::cursor
+            inner_cursor;
+        typedef typename std::remove_cv<typename inner_cursor::element_type>::type
+            value_type;
+        typedef typename std::decay<typename util::result_of<KeyFn(value_type)>::type>::type
+            key_type;
+
+        struct state_type
+        {
+            std::vector<value_type>     elements;
+            std::vector<std::uint32_t>  order;
+        };
+
+    public:
+        class cursor
+        {
+        public:
+            typedef random_access_cursor_tag
+                cursor_category;
+            typedef value_type
+                element_type;
+            typedef value_type
+                reference_type;
+
+            explicit cursor(std::shared_ptr<const state_type> state)
+            : state(std::move(state)), current(0), start(0), fin(this->state->order.size())
+            {
+            }
+
+            void forget() { start = current; }
+            bool empty() const { return current == fin; }
+            void inc() {
+                if (current == fin) {
+                    throw std::logic_error("inc past end");
+                }
+                ++current;
+            }
+            reference_type get() const { return state->elements[state->order[current]]; }
+
+            bool atbegin() const { return current == start; }
+            void dec() {
+                if (current == start) {
+                    throw std::logic_error("dec past begin");
+                }
+                --current;
+            }
+
+            void skip(ptrdiff_t n) { current += n; }
+            size_t size() const { return fin - start; }
+            size_t position() const { return current - start; }
+            void truncate(size_t n) {
+                if (n < fin - current) {
+                    fin = current + n;
+                }
+            }
+
+        private:
+            std::shared_ptr<const state_type>   state;
+            size_t                              current, start, fin;
+        };
+
+        template <class KeyFn2, class Less2>
+        struct then_by_result
+        {
+            typedef linq_order_by<Collection, KeyFn, Less, typename detail::order_append<Next, KeyFn2, Less2>::type>
+                type;
+        };
+
+        linq_order_by(const Collection& c, KeyFn keyFn, Less less, bool descending,
+                      Next next = Next(), size_t limit = size_t(-1), size_t threads = 1)
+        : c(c), keyFn(std::move(keyFn)), less(std::move(less)), descending(descending)
+        , next(std::move(next)), limit(limit), threads(threads)
+        {
+        }
+
+        template <class KeyFn2, class Less2>
+        typename then_by_result<KeyFn2, Less2>::type then_by(KeyFn2 keyFn2, Less2 less2, bool descending2) const {
+            return typename then_by_result<KeyFn2, Less2>::type(c, keyFn, less, descending,
+                detail::order_append<Next, KeyFn2, Less2>::append(next, std::move(keyFn2), std::move(less2), descending2),
+                limit, threads);
+        }
+
+        // only the first n elements will be read
+        linq_order_by limited(size_t n) const {
+            auto result = *this;
+            result.limit = std::min(limit, n);
+            return result;
+        }
+
+        // sorts on several threads, 0 for one per hardware thread
+        linq_order_by parallel_sort(size_t n) const {
+            auto result = *this;
+            result.threads = n != 0 ? n : std::max<size_t>(1, std::thread::hardware_concurrency());
+            return result;
+        }
+
+        cursor get_cursor() const {
+            return cursor(sort());
+        }
+
+    private:
+        typedef std::pair<key_type, std::uint32_t>
+            entry_type;
+
+        // < 0 when the element with key ka comes before the one with key kb
+        int compare_keys(const key_type& ka, const key_type& kb) const
+        {
+            if (less(ka, kb)) { return descending ? 1 : -1; }
+            if (less(kb, ka)) { return descending ? -1 : 1; }
+            return 0;
+        }
+
+        std::shared_ptr<const state_type> sort() const
+        {
+            if (limit <= detail::order_heap_max) {
+                return top();
+            }
+
+            auto state = std::make_shared<state_type>();
+            auto& elements = state->elements;
+            auto cur = c.get_cursor();
+            reserve(elements, cur, typename inner_cursor::cursor_category());
+            for (; !cur.empty(); cur.inc()) {
+                elements.push_back(cur.get());
+            }
+            const size_t n = elements.size();
+
+            // the keys are sorted next to the positions they belong to
+            std::vector<entry_type> entries;
+            entries.reserve(n);
+            for (std::uint32_t i = 0; i != n; ++i) {
+                entries.push_back(entry_type(keyFn(elements[i]), i));
+            }
+
+            // ties on all keys are broken by input position, which keeps the order stable
+            auto before = [&](const entry_type& a, const entry_type& b) -> bool {
+                int cmp = compare_keys(a.first, b.first);
+                if (cmp == 0) {
+                    cmp = next.compare(elements[a.second], elements[b.second]);
+                }
+                return cmp != 0 ? cmp < 0 : a.second < b.second;
+            };
+
+            if (limit < n) {
+                std::nth_element(entries.begin(), entries.begin() + limit, entries.end(), before);
+                entries.resize(limit);
+                std::sort(entries.begin(), entries.end(), before);
+            } else if (threads > 1 && n >= 2 * detail::parallel_sort_min) {
+                parallel_sort_(entries, before);
+            } else {
+                std::sort(entries.begin(), entries.end(), before);
+            }
+
+            auto& order = state->order;
+            order.reserve(entries.size());
+            for (auto& e : entries) {
+                order.push_back(e.second);
+            }
+            return state;
+        }
+
+        // keeps the first limit elements as the input is read, so only the
+        //   elements that are kept are copied. the elements stay in their
+        //   slots, the heap only moves keys and slot numbers.
+        std::shared_ptr<const state_type> top() const
+        {
+            struct heap_entry
+            {
+                key_type        key;
+                std::uint32_t   position;
+                std::uint32_t   slot;
+            };
+
+            auto state = std::make_shared<state_type>();
+            auto& elements = state->elements;
+            elements.reserve(limit);
+
+            auto before = [&](const heap_entry& a, const heap_entry& b) -> bool {
+                int cmp = compare_keys(a.key, b.key);
+                if (cmp == 0) {
+                    cmp = next.compare(elements[a.slot], elements[b.slot]);
+                }
+                return cmp != 0 ? cmp < 0 : a.position < b.position;
+            };
+
+            // the last of the elements kept is at the front
+            std::vector<heap_entry> heap;
+            heap.reserve(limit);
+            std::uint32_t position = 0;
+            for (auto cur = c.get_cursor(); !cur.empty() && limit != 0; cur.inc(), ++position) {
+                auto&& element = cur.get();
+                auto key = keyFn(element);
+                if (heap.size() == limit) {
+                    // a later element that ties with the last one kept comes after it
+                    const heap_entry& last = heap.front();
+                    int cmp = compare_keys(key, last.key);
+                    if (cmp == 0) {
+                        cmp = next.compare(element, elements[last.slot]);
+                    }
+                    if (cmp >= 0) {
+                        continue;
+                    }
+                    // the element takes the slot of the one it replaces
+                    std::uint32_t slot = last.slot;
+                    std::pop_heap(heap.begin(), heap.end(), before);
+                    heap.pop_back();
+                    elements[slot] = std::forward<decltype(element)>(element);
+                    heap_entry e = { std::move(key), position, slot };
+                    heap.push_back(std::move(e));
+                } else {
+                    heap_entry e = { std::move(key), position, static_cast<std::uint32_t>(elements.size()) };
+                    elements.push_back(std::forward<decltype(element)>(element));
+                    heap.push_back(std::move(e));
+                }
+                std::push_heap(heap.begin(), heap.end(), before);
+            }
+            std::sort_heap(heap.begin(), heap.end(), before);
+
+            state->order.reserve(heap.size());
+            for (auto& e : heap) {
+                state->order.push_back(e.slot);
+            }
+            return state;
+        }
+
+        template <class Cursor>
+        static void reserve(std::vector<value_type>& elements, const Cursor& cur, random_access_cursor_tag)
+        {
+            elements.reserve(cur.size() - cur.position());
+        }
+        template <class Cursor>
+        static void reserve(std::vector<value_type>&, const Cursor&, onepass_cursor_tag)
+        {
+        }
+
+        // sorts one run per thread, then merges pairs of runs, each merge
+        //   on its own thread, until one run is left
+        template <class Before>
+        void parallel_sort_(std::vector<entry_type>& entries, Before before) const
+        {
+            const size_t n = entries.size();
+            const size_t runs = std::min(threads, n / detail::parallel_sort_min);
+            std::vector<size_t> bounds(runs + 1);
+            for (size_t i = 0; i <= runs; ++i) {
+                bounds[i] = n * i / runs;
+            }
+
+            auto first = entries.begin();
+            detail::parallel_for(runs, [&](size_t i) {
+                std::sort(first + bounds[i], first + bounds[i + 1], before);
+            });
+
+            for (size_t width = 1; width < runs; width *= 2) {
+                const size_t merges = (runs + 2 * width - 1) / (2 * width);
+                detail::parallel_for(merges, [&](size_t m) {
+                    const size_t lo = 2 * width * m;
+                    const size_t mid = std::min(lo + width, runs);
+                    const size_t hi = std::min(lo + 2 * width, runs);
+                    if (mid < hi) {
+                        std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], before);
+                    }
+                });
+            }
+        }
+
+        Collection  c;
+        KeyFn       keyFn;
+        Less        less;
+        bool        descending;
+        Next        next;
+        size_t      limit;
+        size_t      threads;
+    };
+
+    namespace detail
+    {
+        template <class Collection, class KeyFn, class Less, class Next>
+        linq_order_by<Collection, KeyFn, Less, Next> take_limit(const linq_order_by<Collection, KeyFn, Less, Next>& c, size_t n)
+        {
+            return c.limited(n);
+        }
+    }
+}
+
+#endif // !defined(CPPLINQ_LINQ_ORDERBY_HPP)
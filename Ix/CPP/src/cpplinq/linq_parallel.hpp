@@ -0,0 +1,351 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#if !defined(CPPLINQ_LINQ_PARALLEL_HPP)
+#define CPPLINQ_LINQ_PARALLEL_HPP
+#pragma once
+
+namespace cpplinq
+{
+    template <class Collection>
+    class linq_driver;
+
+    namespace detail
+    {
+        // calls fn(i) for each i in [0, n), each on its own thread. fn(0)
+        //   runs on the calling thread. the first exception, in the order
+        //   of i, is rethrown once all calls are done.
+        template <class Fn>
+        void parallel_for(size_t n, Fn fn)
+        {
+            std::vector<std::exception_ptr> errors(n);
+            auto run = [&](size_t i) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            workers.reserve(n - 1);
+            for (size_t i = 1; i < n; ++i) {
+                workers.push_back(std::thread(run, i));
+            }
+            run(0);
+            for (auto& w : workers) {
+                w.join();
+            }
+            for (auto& e : errors) {
+                if (e) {
+                    std::rethrow_exception(e);
+                }
+            }
+        }
+
+        // the elements [offset, offset + count) of a random access collection
+        template <class Collection>
+        class parallel_slice
+        {
+            typedef typename Collection::cursor
+                inner_cursor;
+        public:
+            typedef linq_take_cursor<inner_cursor>
+                cursor;
+
+            parallel_slice(const Collection& c, size_t offset, size_t count)
+            : c(c), offset(offset), count(count)
+            {
+            }
+
+            cursor get_cursor() const {
+                auto cur = c.get_cursor();
+                cur.skip(offset);
+                return cursor(cur, count);
+            }
+
+        private:
+            Collection  c;
+            size_t      offset;
+            size_t      count;
+        };
+
+        // the operators applied to each slice. a chain builds the query for
+        //   one slice, so that select and where run fused within each thread.
+        struct parallel_identity
+        {
+            template <class Collection>
+            struct result { typedef Collection type; };
+
+            template <class Collection>
+            Collection operator()(const Collection& c) const { return c; }
+        };
+
+        template <class Inner, class Selector>
+        struct parallel_select
+        {
+            template <class Collection>
+            struct result { typedef linq_select<typename Inner::template result<Collection>::type, Selector> type; };
+
+            parallel_select(Inner inner, Selector sel) : inner(std::move(inner)), sel(std::move(sel)) {}
+
+            template <class Collection>
+            typename result<Collection>::type operator()(const Collection& c) const {
+                return typename result<Collection>::type(inner(c), sel);
+            }
+
+            Inner       inner;
+            Selector    sel;
+        };
+
+        template <class Inner, class Predicate>
+        struct parallel_where
+        {
+            template <class Collection>
+            struct result { typedef linq_where<typename Inner::template result<Collection>::type, Predicate> type; };
+
+            parallel_where(Inner inner, Predicate pred) : inner(std::move(inner)), pred(std::move(pred)) {}
+
+            template <class Collection>
+            typename result<Collection>::type operator()(const Collection& c) const {
+                return typename result<Collection>::type(inner(c), pred);
+            }
+
+            Inner       inner;
+            Predicate   pred;
+        };
+    }
+
+    // splits a random access collection into one slice per thread. select and
+    //   where are applied to each slice on its own thread, and the results of
+    //   each slice are merged in the order of the slices.
+    //
+    // requires:
+    //   the source must be random access.
+    //   selectors and predicates must be safe to call from several threads.
+    //   the functions passed to aggregate, min and max must be associative.
+    template <class Collection, class Chain = detail::parallel_identity>
+    class linq_parallel
+    {
+        static_assert(std::is_convertible<typename Collection::cursor::cursor_category, random_access_cursor_tag>::value,
+            "parallel() requires a random access source");
+
+        typedef detail::parallel_slice<Collection>
+            slice_type;
+        typedef typename Chain::template result<slice_type>::type
+            range_type;
+        typedef linq_driver<range_type>
+            range_driver;
+        typedef typename range_type::cursor::element_type
+            element_type;
+
+    public:
+        linq_parallel(Collection c, size_t threads, Chain chain = Chain())
+        : c(std::move(c)), threads(threads), chain(std::move(chain))
+        {
+            if (this->threads == 0) {
+                this->threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+        }
+
+        // -------------------- operators --------------------
+
+        template <class Selector>
+        linq_parallel<Collection, detail::parallel_select<Chain, Selector>> select(Selector sel) const {
+            return linq_parallel<Collection, detail::parallel_select<Chain, Selector>>(
+                c, threads, detail::parallel_select<Chain, Selector>(chain, std::move(sel)));
+        }
+
+        template <class Predicate>
+        linq_parallel<Collection, detail::parallel_where<Chain, Predicate>> where(Predicate p) const {
+            return linq_parallel<Collection, detail::parallel_where<Chain, Predicate>>(
+                c, threads, detail::parallel_where<Chain, Predicate>(chain, std::move(p)));
+        }
+
+        // -------------------- merged results --------------------
+
+        template <class Fn>
+        element_type aggregate(Fn fn) const
+        {
+            return fold(fn, nullptr);
+        }
+
+        // each slice starts from initialValue, so it must be an identity of merge
+        template <class T, class Fn, class Merge>
+        T aggregate(T initialValue, Fn fn, Merge merge) const
+        {
+            const size_t n = range_count();
+            std::vector<T> partial(n, initialValue);
+            for_each_range(n, [&](size_t i, const range_type& r) {
+                auto d = range_driver(r);
+                partial[i] = std::accumulate(d.begin(), d.end(), partial[i], fn);
+            });
+            return std::accumulate(partial.begin() + 1, partial.end(), partial[0], merge);
+        }
+
+        bool any() const
+        {
+            return any([](const element_type&) { return true; });
+        }
+
+        // stops every slice once one of them finds a match
+        template <class Predicate>
+        bool any(Predicate p) const
+        {
+            std::atomic<bool> found(false);
+            for_each_range(range_count(), [&](size_t, const range_type& r) {
+                for (auto cur = r.get_cursor(); !cur.empty() && !found.load(std::memory_order_relaxed); cur.inc()) {
+                    if (p(cur.get())) {
+                        found = true;
+                        break;
+                    }
+                }
+            });
+            return found;
+        }
+
+        template <class Predicate>
+        bool all(Predicate p) const
+        {
+            return !any([&](const element_type& value) { return !p(value); });
+        }
+
+        size_t count() const
+        {
+            const size_t n = range_count();
+            std::vector<size_t> partial(n);
+            for_each_range(n, [&](size_t i, const range_type& r) {
+                size_t count = 0;
+                for (auto cur = r.get_cursor(); !cur.empty(); cur.inc()) {
+                    ++count;
+                }
+                partial[i] = count;
+            });
+            return std::accumulate(partial.begin(), partial.end(), size_t(0));
+        }
+
+        template <class Predicate>
+        size_t count(Predicate p) const
+        {
+            return this->where(p).count();
+        }
+
+        element_type max() const
+        {
+            return max(std::less<element_type>());
+        }
+
+        // the first of equal maximums, as with std::max_element
+        template <class Compare>
+        element_type max(Compare less) const
+        {
+            return fold([&](const element_type& a, const element_type& b) { return less(a, b) ? b : a; },
+                "max performed on empty range");
+        }
+
+        element_type min() const
+        {
+            return min(std::less<element_type>());
+        }
+
+        // the first of equal minimums, as with std::min_element
+        template <class Compare>
+        element_type min(Compare less) const
+        {
+            return fold([&](const element_type& a, const element_type& b) { return less(b, a) ? b : a; },
+                "min performed on empty range");
+        }
+
+        element_type sum() const
+        {
+            const size_t n = range_count();
+            std::vector<element_type> partial(n);
+            for_each_range(n, [&](size_t i, const range_type& r) {
+                partial[i] = range_driver(r).sum();
+            });
+            return std::accumulate(partial.begin(), partial.end(), element_type());
+        }
+
+        // keeps the order of the source
+        std::vector<element_type> to_vector() const
+        {
+            const size_t n = range_count();
+            std::vector<std::vector<element_type>> partial(n);
+            for_each_range(n, [&](size_t i, const range_type& r) {
+                partial[i] = range_driver(r).to_vector();
+            });
+
+            size_t total = 0;
+            for (auto& p : partial) {
+                total += p.size();
+            }
+            std::vector<element_type> result;
+            result.reserve(total);
+            for (auto& p : partial) {
+                std::move(p.begin(), p.end(), std::back_inserter(result));
+            }
+            return result;
+        }
+
+    private:
+        size_t range_count() const
+        {
+            auto cur = c.get_cursor();
+            return std::max<size_t>(1, std::min<size_t>(threads, cur.size() - cur.position()));
+        }
+
+        // calls fn(i, range) for each of the n slices
+        template <class Fn>
+        void for_each_range(size_t n, Fn fn) const
+        {
+            auto cur = c.get_cursor();
+            const size_t size = cur.size() - cur.position();
+            detail::parallel_for(n, [&](size_t i) {
+                const size_t first = size * i / n;
+                const size_t last = size * (i + 1) / n;
+                fn(i, chain(slice_type(c, first, last - first)));
+            });
+        }
+
+        // folds each slice with fn from its first element, then folds the
+        //   results of the slices that were not empty. an empty input
+        //   throws emptyError, or has the default value when that is null.
+        template <class Fn>
+        element_type fold(Fn fn, const char* emptyError) const
+        {
+            const size_t n = range_count();
+            std::vector<element_type> partial(n);
+            std::vector<char> found(n);
+            for_each_range(n, [&](size_t i, const range_type& r) {
+                auto cur = r.get_cursor();
+                if (cur.empty()) {
+                    return;
+                }
+                element_type result = cur.get();
+                for (cur.inc(); !cur.empty(); cur.inc()) {
+                    result = fn(result, cur.get());
+                }
+                partial[i] = std::move(result);
+                found[i] = 1;
+            });
+
+            auto result = element_type();
+            bool seen = false;
+            for (size_t i = 0; i < n; ++i) {
+                if (found[i]) {
+                    result = seen ? fn(result, partial[i]) : partial[i];
+                    seen = true;
+                }
+            }
+            if (!seen && emptyError) {
+                throw std::logic_error(emptyError);
+            }
+            return result;
+        }
+
+        Collection  c;
+        size_t      threads;
+        Chain       chain;
+    };
+}
+
+#endif // !defined(CPPLINQ_LINQ_PARALLEL_HPP)
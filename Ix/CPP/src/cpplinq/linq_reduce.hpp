@@ -0,0 +1,338 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#if !defined(CPPLINQ_LINQ_REDUCE_HPP)
+#define CPPLINQ_LINQ_REDUCE_HPP
+#pragma once
+
+#if defined(LINQ_USE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(LINQ_USE_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace cpplinq
+{
+    namespace detail
+    {
+        // how linq_driver reduces a collection:
+        //   generic      - through the cursor, one element at a time
+        //   contiguous   - an array of arithmetic values, with the kernels below
+        //   projected    - select over an array, with a loop over the array
+        struct generic_source_tag {};
+        struct contiguous_source_tag {};
+        struct projected_source_tag {};
+
+        template <class Collection>
+        struct reduce_source
+        {
+            typedef generic_source_tag type;
+        };
+
+        template <class Iter>
+        struct reduce_source<iter_cursor<Iter>>
+            : std::conditional<
+                util::is_contiguous_iterator<Iter>::value
+                && std::is_arithmetic<typename std::iterator_traits<Iter>::value_type>::value,
+                contiguous_source_tag,
+                generic_source_tag>
+        {
+        };
+
+        template <class Iter, class Selector>
+        struct reduce_source<linq_select<iter_cursor<Iter>, Selector>>
+            : std::conditional<
+                util::is_contiguous_iterator<Iter>::value
+                && std::is_arithmetic<typename linq_select<iter_cursor<Iter>, Selector>::cursor::reference_type>::value,
+                projected_source_tag,
+                generic_source_tag>
+        {
+        };
+
+        // the remaining elements of the cursor, as a pointer range
+        template <class Iter>
+        auto contiguous_range(const iter_cursor<Iter>& c)
+            -> decltype(c.span())
+        {
+            return c.get_cursor().span();
+        }
+
+        // vector instructions for one element type. simd<T>::enabled is
+        //   false when there are none, and the kernels use scalar loops.
+        template <class T>
+        struct simd
+        {
+            static const bool enabled = false;
+        };
+
+#if defined(LINQ_USE_AVX2)
+        template <>
+        struct simd<double>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 4;
+            typedef __m256d type;
+            static type load(const double* p) { return _mm256_loadu_pd(p); }
+            static void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+            static type zero() { return _mm256_setzero_pd(); }
+            static type add(type a, type b) { return _mm256_add_pd(a, b); }
+            static type min(type a, type b) { return _mm256_min_pd(a, b); }
+            static type max(type a, type b) { return _mm256_max_pd(a, b); }
+            static type unordered(type a, type v) { return _mm256_or_pd(a, _mm256_cmp_pd(v, v, _CMP_UNORD_Q)); }
+            static bool none(type a) { return _mm256_movemask_pd(a) == 0; }
+        };
+        template <>
+        struct simd<float>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 8;
+            typedef __m256 type;
+            static type load(const float* p) { return _mm256_loadu_ps(p); }
+            static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+            static type zero() { return _mm256_setzero_ps(); }
+            static type add(type a, type b) { return _mm256_add_ps(a, b); }
+            static type min(type a, type b) { return _mm256_min_ps(a, b); }
+            static type max(type a, type b) { return _mm256_max_ps(a, b); }
+            static type unordered(type a, type v) { return _mm256_or_ps(a, _mm256_cmp_ps(v, v, _CMP_UNORD_Q)); }
+            static bool none(type a) { return _mm256_movemask_ps(a) == 0; }
+        };
+        template <>
+        struct simd<std::int32_t>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 8;
+            typedef __m256i type;
+            static type load(const std::int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+            static void store(std::int32_t* p, type v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+            static type zero() { return _mm256_setzero_si256(); }
+            static type add(type a, type b) { return _mm256_add_epi32(a, b); }
+            static type min(type a, type b) { return _mm256_min_epi32(a, b); }
+            static type max(type a, type b) { return _mm256_max_epi32(a, b); }
+            static type unordered(type a, type) { return a; }
+            static bool none(type) { return true; }
+        };
+#elif defined(LINQ_USE_SSE2)
+        template <>
+        struct simd<double>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 2;
+            typedef __m128d type;
+            static type load(const double* p) { return _mm_loadu_pd(p); }
+            static void store(double* p, type v) { _mm_storeu_pd(p, v); }
+            static type zero() { return _mm_setzero_pd(); }
+            static type add(type a, type b) { return _mm_add_pd(a, b); }
+            static type min(type a, type b) { return _mm_min_pd(a, b); }
+            static type max(type a, type b) { return _mm_max_pd(a, b); }
+            static type unordered(type a, type v) { return _mm_or_pd(a, _mm_cmpunord_pd(v, v)); }
+            static bool none(type a) { return _mm_movemask_pd(a) == 0; }
+        };
+        template <>
+        struct simd<float>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 4;
+            typedef __m128 type;
+            static type load(const float* p) { return _mm_loadu_ps(p); }
+            static void store(float* p, type v) { _mm_storeu_ps(p, v); }
+            static type zero() { return _mm_setzero_ps(); }
+            static type add(type a, type b) { return _mm_add_ps(a, b); }
+            static type min(type a, type b) { return _mm_min_ps(a, b); }
+            static type max(type a, type b) { return _mm_max_ps(a, b); }
+            static type unordered(type a, type v) { return _mm_or_ps(a, _mm_cmpunord_ps(v, v)); }
+            static bool none(type a) { return _mm_movemask_ps(a) == 0; }
+        };
+        template <>
+        struct simd<std::int32_t>
+        {
+            static const bool enabled = true;
+            static const ptrdiff_t width = 4;
+            typedef __m128i type;
+            static type load(const std::int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+            static void store(std::int32_t* p, type v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+            static type zero() { return _mm_setzero_si128(); }
+            static type add(type a, type b) { return _mm_add_epi32(a, b); }
+            // sse2 has no 32 bit min/max, select with a compare instead
+            static type min(type a, type b) {
+                auto less = _mm_cmplt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+            }
+            static type max(type a, type b) {
+                auto greater = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+            }
+            static type unordered(type a, type) { return a; }
+            static bool none(type) { return true; }
+        };
+#endif
+
+        struct min_op
+        {
+            template <class T>
+            static T apply(const T& a, const T& b) { return b < a ? b : a; }
+        };
+        struct max_op
+        {
+            template <class T>
+            static T apply(const T& a, const T& b) { return a < b ? b : a; }
+        };
+
+        // several accumulators let additions that do not depend on each
+        //   other overlap, and let the compiler vectorize the loop
+        template <class T, class Selector>
+        typename std::remove_cv<typename std::remove_reference<typename util::result_of<Selector(T&)>::type>::type>::type
+            sum_scalar(T* first, T* last, const Selector& sel)
+        {
+            typedef typename std::remove_cv<typename std::remove_reference<typename util::result_of<Selector(T&)>::type>::type>::type
+                result_type;
+            result_type a0 = result_type(), a1 = result_type(), a2 = result_type(), a3 = result_type();
+            for (; last - first >= 4; first += 4) {
+                a0 += sel(first[0]);
+                a1 += sel(first[1]);
+                a2 += sel(first[2]);
+                a3 += sel(first[3]);
+            }
+            for (; first != last; ++first) {
+                a0 += sel(*first);
+            }
+            return (a0 + a1) + (a2 + a3);
+        }
+
+        struct identity_selector
+        {
+            template <class T>
+            const T& operator()(const T& value) const { return value; }
+        };
+
+        template <class T>
+        T sum_(const T* first, const T* last, std::false_type)
+        {
+            return sum_scalar(first, last, identity_selector());
+        }
+
+        template <class T>
+        T sum_(const T* first, const T* last, std::true_type)
+        {
+            typedef simd<T> s;
+            auto a0 = s::zero(), a1 = s::zero();
+            for (; last - first >= 2 * s::width; first += 2 * s::width) {
+                a0 = s::add(a0, s::load(first));
+                a1 = s::add(a1, s::load(first + s::width));
+            }
+            T lanes[s::width];
+            s::store(lanes, s::add(a0, a1));
+            const T* lanesEnd = lanes + s::width;
+            return sum_scalar(static_cast<const T*>(lanes), lanesEnd, identity_selector())
+                + sum_scalar(first, last, identity_selector());
+        }
+
+        // the sum of an array. floating point values are added in a
+        //   different order than std::accumulate, so the last bits may differ.
+        template <class T>
+        typename std::remove_cv<T>::type sum(T* first, T* last)
+        {
+            typedef typename std::remove_cv<T>::type value_type;
+            return sum_(static_cast<const value_type*>(first), static_cast<const value_type*>(last),
+                std::integral_constant<bool, simd<value_type>::enabled>());
+        }
+
+        // counts into several accumulators, as sum_scalar does
+        template <class T, class Predicate>
+        ptrdiff_t count_if(T* first, T* last, const Predicate& pred)
+        {
+            ptrdiff_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+            for (; last - first >= 4; first += 4) {
+                n0 += pred(first[0]) ? 1 : 0;
+                n1 += pred(first[1]) ? 1 : 0;
+                n2 += pred(first[2]) ? 1 : 0;
+                n3 += pred(first[3]) ? 1 : 0;
+            }
+            for (; first != last; ++first) {
+                n0 += pred(*first) ? 1 : 0;
+            }
+            return (n0 + n1) + (n2 + n3);
+        }
+
+        template <class T, class Op, class Simd>
+        bool extreme_(const T*, const T*, T&, Op, Simd, std::false_type)
+        {
+            return false;
+        }
+
+        template <class T, class Op, class Simd>
+        bool extreme_(const T* first, const T* last, T& result, Op, Simd simdOp, std::true_type)
+        {
+            typedef simd<T> s;
+            if (last - first < s::width) {
+                return false;
+            }
+            // two accumulators, so that each compare does not wait for the one before
+            auto best0 = s::load(first);
+            auto best1 = best0;
+            auto nan = s::unordered(s::zero(), best0);
+            for (first += s::width; last - first >= 2 * s::width; first += 2 * s::width) {
+                auto v0 = s::load(first);
+                auto v1 = s::load(first + s::width);
+                nan = s::unordered(s::unordered(nan, v0), v1);
+                best0 = simdOp(best0, v0);
+                best1 = simdOp(best1, v1);
+            }
+            auto best = simdOp(best0, best1);
+            if (!s::none(nan)) {
+                return false;
+            }
+            T lanes[s::width];
+            s::store(lanes, best);
+            result = lanes[0];
+            for (ptrdiff_t i = 1; i < s::width; ++i) {
+                result = Op::apply(result, lanes[i]);
+            }
+            for (; first != last; ++first) {
+                result = Op::apply(result, *first);
+            }
+            return true;
+        }
+
+        template <class T>
+        struct simd_min
+        {
+            template <class V>
+            V operator()(V a, V b) const { return simd<T>::min(a, b); }
+        };
+        template <class T>
+        struct simd_max
+        {
+            template <class V>
+            V operator()(V a, V b) const { return simd<T>::max(a, b); }
+        };
+
+        // the first minimum of a non-empty array, as with std::min_element
+        template <class T>
+        T* min_element(T* first, T* last)
+        {
+            typedef typename std::remove_cv<T>::type value_type;
+            value_type value;
+            // a NaN makes the order of the vector min differ from std::less
+            if (extreme_(static_cast<const value_type*>(first), static_cast<const value_type*>(last), value,
+                    min_op(), simd_min<value_type>(), std::integral_constant<bool, simd<value_type>::enabled>())) {
+                return std::find(first, last, value);
+            }
+            return std::min_element(first, last);
+        }
+
+        // the first maximum of a non-empty array, as with std::max_element
+        template <class T>
+        T* max_element(T* first, T* last)
+        {
+            typedef typename std::remove_cv<T>::type value_type;
+            value_type value;
+            if (extreme_(static_cast<const value_type*>(first), static_cast<const value_type*>(last), value,
+                    max_op(), simd_max<value_type>(), std::integral_constant<bool, simd<value_type>::enabled>())) {
+                return std::find(first, last, value);
+            }
+            return std::max_element(first, last);
+        }
+    }
+}
+
+#endif // !defined(CPPLINQ_LINQ_REDUCE_HPP)
@@ -19,6 +19,11 @@ namespace cpplinq
                 element_type;
             typedef typename inner_cursor::cursor_category
                 cursor_category;
+            typedef typename std::conditional<
+                    std::is_convertible<typename util::batch_category<inner_cursor>::type, span_cursor_tag>::value,
+                    batch_cursor_tag,
+                    no_batch_tag>::type
+                batch_category;
             
             cursor(const inner_cursor& cur, Selector sel) : cur(cur), sel(std::move(sel)) {}
 
@@ -33,6 +38,20 @@ namespace cpplinq
             void skip(size_t n) { cur.skip(n); }
             size_t position() const { return cur.position(); }
             size_t size() const { return cur.size(); }
+            void truncate(size_t n) { cur.truncate(n); }
+
+            util::size_hint size_hint() const { return util::get_size_hint(cur); }
+
+            // selects straight from the array of the input
+            size_t get_batch(typename util::batch_value<cursor>::type* out, size_t max) {
+                auto in = cur.span();
+                size_t n = std::min(max, size_t(in.second - in.first));
+                for (size_t i = 0; i != n; ++i) {
+                    out[i] = sel(in.first[i]);
+                }
+                cur.skip(n);
+                return n;
+            }
         private:
             inner_cursor    cur;
             Selector        sel;
@@ -42,6 +61,9 @@ namespace cpplinq
 
         cursor get_cursor() const { return cursor(c.get_cursor(), sel); }
 
+        const Collection& source() const { return c; }
+        const Selector& selector() const { return sel; }
+
     private:
         Collection c;
         Selector sel;
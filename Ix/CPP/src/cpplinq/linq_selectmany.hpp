@@ -5,9 +5,12 @@
 #include "util.hpp"
 #include "linq_cursor.hpp"
 
-namespace cpplinq 
+namespace cpplinq
 {
-    namespace detail 
+    template <class Collection>
+    class linq_driver;
+
+    namespace detail
     {
         struct default_select_many_selector
         {
@@ -18,21 +21,118 @@ namespace cpplinq
                 return std::forward<T2>(t2);
             }
         };
+
+        // the cursor over the inner collection of one outer element. R is
+        //   what the selector returns, one of:
+        //   - a container by value. the cursor owns the container, and
+        //     returns copies of its elements, which do not outlive it.
+        //   - a reference to a container, read in place.
+        //   - a query, read through its own cursor.
+        template <class R, class D = typename std::decay<R>::type>
+        class select_many_inner
+        {
+            typedef typename util::container_traits<D>::iterator
+                iterator;
+
+        public:
+            typedef typename util::container_traits<D>::value_type
+                element_type;
+            typedef element_type
+                reference_type;
+            typedef forward_cursor_tag
+                cursor_category;
+
+            explicit select_many_inner(D values)
+            : values(std::move(values)), current(std::begin(this->values)), index(0)
+            {
+            }
+            // the iterator is into the copy
+            select_many_inner(const select_many_inner& other)
+            : values(other.values), current(std::next(std::begin(values), other.index)), index(other.index)
+            {
+            }
+            select_many_inner(select_many_inner&& other)
+            : values(std::move(other.values)), current(std::next(std::begin(values), other.index)), index(other.index)
+            {
+            }
+            select_many_inner& operator=(select_many_inner other)
+            {
+                values = std::move(other.values);
+                current = std::next(std::begin(values), other.index);
+                index = other.index;
+                return *this;
+            }
+
+            bool empty() const { return current == std::end(values); }
+            void inc() { ++current; ++index; }
+            reference_type get() const { return *current; }
+
+        private:
+            D           values;
+            iterator    current;
+            size_t      index;
+        };
+
+        template <class R, class D>
+        class select_many_inner<R&, D>
+            : public iter_cursor<typename util::container_traits<R>::iterator>
+        {
+            typedef iter_cursor<typename util::container_traits<R>::iterator>
+                base;
+        public:
+            explicit select_many_inner(R& values) : base(std::begin(values), std::end(values))
+            {
+            }
+        };
+
+        template <class R, class Collection>
+        class select_many_inner<R, linq_driver<Collection>>
+            : public Collection::cursor
+        {
+        public:
+            explicit select_many_inner(const linq_driver<Collection>& query) : Collection::cursor(query.get_cursor())
+            {
+            }
+        };
+
+        template <class R, class Collection>
+        class select_many_inner<R&, linq_driver<Collection>>
+            : public select_many_inner<linq_driver<Collection>>
+        {
+        public:
+            explicit select_many_inner(const linq_driver<Collection>& query) : select_many_inner<linq_driver<Collection>>(query)
+            {
+            }
+        };
+
+        // the type of an element of select_many. without a result selector
+        //   it is the element of the inner collection.
+        template <class Fn2, class Outer, class Inner>
+        struct select_many_result
+        {
+            typedef typename util::result_of<Fn2(Outer, Inner)>::type type;
+        };
+        template <class Outer, class Inner>
+        struct select_many_result<default_select_many_selector, Outer, Inner>
+        {
+            typedef Inner type;
+        };
     }
 
     // cur<T> -> (T -> cur<element_type>) -> cur<element_type>
+    //
+    // the inner collection of each outer element is made when the cursor
+    //   reaches that element, into storage in the cursor, so flattening
+    //   does not allocate unless the selector does.
     template <class Container1, class Fn, class Fn2>
     class linq_select_many
     {
-        template <class T> static T instance(); // for type inference
-
         Container1      c1;
         Fn              fn;
         Fn2             fn2;
 
         typedef typename Container1::cursor Cur1;
-        typedef decltype(from(instance<Fn>()(instance<Cur1>().get()))) Container2;
-        typedef typename Container2::cursor Cur2;
+        typedef detail::select_many_inner<typename util::result_of<Fn(typename Cur1::reference_type)>::type> Cur2;
 
     public:
         class cursor
@@ -42,56 +142,77 @@ namespace cpplinq
                                                        typename Cur2::cursor_category,
                                                        forward_cursor_tag>::type
                 cursor_category;
-            typedef typename Cur2::reference_type reference_type;
-            typedef typename Cur2::element_type element_type;
+            typedef typename detail::select_many_result<Fn2, typename Cur1::reference_type, typename Cur2::reference_type>::type
+                reference_type;
+            typedef typename std::remove_cv<typename std::remove_reference<reference_type>::type>::type
+                element_type;
 
         private:
-            // TODO: we need to lazy eval somehow, but this feels wrong.
-            Cur1                            cur1;
-            dynamic_cursor<reference_type>  cur2;
-            Fn                              fn;
-            Fn2                             fn2;
+            Cur1                    cur1;
+            util::maybe<Cur2>       cur2;
+            Fn                      fn;
+            Fn2                     fn2;
 
         public:
             cursor(Cur1 cur1, const Fn& fn, const Fn2& fn2)
             : cur1(std::move(cur1)), fn(fn), fn2(fn2)
             {
-                auto container2 = fn(cur1.get());
-                cur2 = from(container2).get_cursor();
+                if (!this->cur1.empty()) {
+                    open();
+                    thunk();
+                }
             }
 
-            bool empty() const 
+            void forget() { cur1.forget(); }
+
+            // cur2 is set, and not empty, until cur1 is
+            bool empty() const
             {
-                return cur2.empty();
+                return cur1.empty();
             }
 
-            void inc() 
+            void inc()
             {
-                cur2.inc();
+                cur2->inc();
                 thunk();
             }
 
-            reference_type get() const 
+            reference_type get() const
             {
-                return fn2(cur1.get(), cur2.get());
+                return get_(std::is_same<Fn2, detail::default_select_many_selector>());
             }
 
         private:
-            void thunk() 
+            reference_type get_(std::true_type) const
+            {
+                return cur2->get();
+            }
+            reference_type get_(std::false_type) const
+            {
+                return fn2(cur1.get(), cur2->get());
+            }
+
+            // the inner collection of the current outer element
+            void open()
+            {
+                cur2.replace(Cur2(fn(cur1.get())));
+            }
+
+            void thunk()
             {
                 // refill cur2
-                while (cur2.empty() && !cur1.empty()) {
+                while (cur2->empty()) {
                     cur1.inc();
-                    if (cur1.empty()) 
+                    if (cur1.empty()) {
+                        cur2.reset();
                         break;
-
-                    auto container2 = fn(cur1.get());
-                    cur2 = from(container2).get_cursor();
+                    }
+                    open();
                 }
             }
         };
 
-        linq_select_many(Container1 c1, Fn fn, Fn2 fn2) 
+        linq_select_many(Container1 c1, Fn fn, Fn2 fn2)
         : c1(std::move(c1)), fn(std::move(fn)), fn2(std::move(fn2))
         {
         }
@@ -102,6 +223,3 @@ namespace cpplinq
         }
     };
 }
-
-
-
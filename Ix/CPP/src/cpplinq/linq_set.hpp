@@ -0,0 +1,377 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#if !defined(CPPLINQ_LINQ_SET_HPP)
+#define CPPLINQ_LINQ_SET_HPP
+#pragma once
+
+namespace cpplinq
+{
+    namespace detail
+    {
+        // the position in the input of the first occurrence of each
+        //   element. copies of a cursor share it: an element is first at
+        //   a position whichever copy reads it first.
+        template <class T, class Hash, class Equal>
+        class first_seen
+        {
+            hash_index<T, Hash, Equal>  index;
+            std::vector<std::size_t>    first;
+
+        public:
+            first_seen(std::size_t expected, Hash hash, Equal eq)
+            : index(expected, std::move(hash), std::move(eq))
+            {
+                first.reserve(expected);
+            }
+
+            // true if value, read at position, is its first occurrence
+            bool is_first(const T& value, std::size_t position)
+            {
+                auto i = index.find_or_insert(value);
+                if (i == first.size()) {
+                    first.push_back(position);
+                }
+                return first[i] == position;
+            }
+        };
+    }
+
+    // the first occurrence of each element, in input order. the input is
+    //   read only as far as the next new element.
+    //
+    // the cursor keeps one copy of each distinct element it has passed,
+    //   shared with its copies.
+    template <class Collection, class Hash, class Equal>
+    class linq_distinct
+    {
+        typedef typename Collection::cursor
+            inner_cursor;
+        typedef detail::first_seen<typename std::remove_cv<typename inner_cursor::element_type>::type, Hash, Equal>
+            set_type;
+    public:
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename inner_cursor::cursor_category>::type
+                cursor_category;
+            typedef typename inner_cursor::element_type
+                element_type;
+            typedef typename inner_cursor::reference_type
+                reference_type;
+
+            cursor(const inner_cursor& cur, std::shared_ptr<set_type> seen)
+            : cur(cur), seen(std::move(seen)), position(0)
+            {
+                if (!this->cur.empty()) {
+                    this->seen->is_first(this->cur.get(), position);
+                }
+            }
+
+            void forget() { cur.forget(); }
+            bool empty() const { return cur.empty(); }
+            void inc() {
+                for (;;) {
+                    cur.inc();
+                    ++position;
+                    if (cur.empty() || seen->is_first(cur.get(), position)) break;
+                }
+            }
+            reference_type get() const {
+                return cur.get();
+            }
+
+        private:
+            inner_cursor                cur;
+            std::shared_ptr<set_type>   seen;
+            // the position of cur in the input
+            std::size_t                 position;
+        };
+
+        linq_distinct(const Collection& c, Hash hash, Equal eq, size_t expected)
+        : c(c), hash(std::move(hash)), eq(std::move(eq)), expected(expected)
+        {
+        }
+
+        cursor get_cursor() const {
+            return cursor(c.get_cursor(), std::make_shared<set_type>(expected, hash, eq));
+        }
+
+    private:
+        Collection  c;
+        Hash        hash;
+        Equal       eq;
+        size_t      expected;
+    };
+
+    // the first occurrence of each element of the first sequence and then
+    //   of the second, as distinct over both.
+    template <class Collection, class Collection2, class Hash, class Equal>
+    class linq_union
+    {
+        typedef typename Collection::cursor
+            inner_cursor;
+        typedef typename Collection2::cursor
+            inner_cursor2;
+        typedef detail::first_seen<typename std::remove_cv<typename inner_cursor::element_type>::type, Hash, Equal>
+            set_type;
+    public:
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename util::min_iterator_category<
+                        typename inner_cursor::cursor_category,
+                        typename inner_cursor2::cursor_category>::type>::type
+                cursor_category;
+            typedef typename inner_cursor::element_type
+                element_type;
+            typedef typename std::conditional<
+                    std::is_same<typename inner_cursor::reference_type, typename inner_cursor2::reference_type>::value,
+                    typename inner_cursor::reference_type,
+                    element_type>::type
+                reference_type;
+
+            cursor(const inner_cursor& cur, const inner_cursor2& cur2, std::shared_ptr<set_type> seen)
+            : cur(cur), cur2(cur2), seen(std::move(seen)), position(0)
+            {
+                if (!this->cur.empty()) {
+                    this->seen->is_first(this->cur.get(), position);
+                } else {
+                    seek2();
+                }
+            }
+
+            void forget() { cur.forget(); cur2.forget(); }
+            bool empty() const { return cur.empty() && cur2.empty(); }
+            void inc() {
+                if (cur.empty()) {
+                    cur2.inc();
+                    ++position;
+                } else {
+                    for (;;) {
+                        cur.inc();
+                        ++position;
+                        if (cur.empty()) break;
+                        if (seen->is_first(cur.get(), position)) return;
+                    }
+                }
+                seek2();
+            }
+            reference_type get() const {
+                return !cur.empty() ? cur.get() : cur2.get();
+            }
+
+        private:
+            // stops on the first new element of the second sequence, from this one on
+            void seek2() {
+                while (!cur2.empty() && !seen->is_first(cur2.get(), position)) {
+                    cur2.inc();
+                    ++position;
+                }
+            }
+
+            inner_cursor                cur;
+            inner_cursor2               cur2;
+            std::shared_ptr<set_type>   seen;
+            // the position of the current element in the input followed
+            //   by the second sequence
+            std::size_t                 position;
+        };
+
+        linq_union(const Collection& c, const Collection2& c2, Hash hash, Equal eq, size_t expected)
+        : c(c), c2(c2), hash(std::move(hash)), eq(std::move(eq)), expected(expected)
+        {
+        }
+
+        cursor get_cursor() const {
+            return cursor(c.get_cursor(), c2.get_cursor(), std::make_shared<set_type>(expected, hash, eq));
+        }
+
+    private:
+        Collection  c;
+        Collection2 c2;
+        Hash        hash;
+        Equal       eq;
+        size_t      expected;
+    };
+
+    namespace detail
+    {
+        // the hash_index of a whole sequence, read when a cursor is made
+        template <class Index, class Cursor>
+        std::shared_ptr<const Index> make_set(Cursor cur, Index index)
+        {
+            for (; !cur.empty(); cur.inc()) {
+                index.find_or_insert(cur.get());
+            }
+            return std::make_shared<const Index>(std::move(index));
+        }
+    }
+
+    // the first occurrence of each element of the first sequence that is
+    //   also in the second. the second sequence is read into a hash_index
+    //   when a cursor is made, the first is read as the cursor moves.
+    template <class Collection, class Collection2, class Hash, class Equal>
+    class linq_intersect
+    {
+        typedef typename Collection::cursor
+            inner_cursor;
+        typedef detail::hash_index<typename std::remove_cv<typename inner_cursor::element_type>::type, Hash, Equal>
+            set_type;
+    public:
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename inner_cursor::cursor_category>::type
+                cursor_category;
+            typedef typename inner_cursor::element_type
+                element_type;
+            typedef typename inner_cursor::reference_type
+                reference_type;
+
+            cursor(const inner_cursor& cur, std::shared_ptr<const set_type> second)
+            : cur(cur), second(std::move(second))
+            , taken(std::make_shared<std::vector<std::size_t>>(this->second->size(), not_taken))
+            , position(0)
+            {
+                if (!this->cur.empty() && !take()) {
+                    inc();
+                }
+            }
+
+            void forget() { cur.forget(); }
+            bool empty() const { return cur.empty(); }
+            void inc() {
+                for (;;) {
+                    cur.inc();
+                    ++position;
+                    if (cur.empty() || take()) break;
+                }
+            }
+            reference_type get() const {
+                return cur.get();
+            }
+
+        private:
+            static const std::size_t not_taken = std::size_t(-1);
+
+            // true if the current element is the first found of its element
+            //   of the second sequence
+            bool take() {
+                auto i = second->find(cur.get());
+                if (i == set_type::npos) {
+                    return false;
+                }
+                auto& first = (*taken)[i];
+                if (first == not_taken) {
+                    first = position;
+                }
+                return first == position;
+            }
+
+            inner_cursor                                cur;
+            std::shared_ptr<const set_type>             second;
+            // the position where each element of the second sequence was
+            //   first found, shared with the copies of the cursor
+            std::shared_ptr<std::vector<std::size_t>>   taken;
+            // the position of cur in the input
+            std::size_t                                 position;
+        };
+
+        linq_intersect(const Collection& c, const Collection2& c2, Hash hash, Equal eq, size_t expected)
+        : c(c), c2(c2), hash(std::move(hash)), eq(std::move(eq)), expected(expected)
+        {
+        }
+
+        cursor get_cursor() const {
+            return cursor(c.get_cursor(), detail::make_set(c2.get_cursor(), set_type(expected, hash, eq)));
+        }
+
+    private:
+        Collection  c;
+        Collection2 c2;
+        Hash        hash;
+        Equal       eq;
+        size_t      expected;
+    };
+
+    template <class Collection, class Collection2, class Hash, class Equal>
+    const std::size_t linq_intersect<Collection, Collection2, Hash, Equal>::cursor::not_taken;
+
+    // the first occurrence of each element of the first sequence that is
+    //   not in the second. the second sequence is read into a hash_index when
+    //   a cursor is made, the first is read as the cursor moves.
+    template <class Collection, class Collection2, class Hash, class Equal>
+    class linq_except
+    {
+        typedef typename Collection::cursor
+            inner_cursor;
+        typedef typename std::remove_cv<typename inner_cursor::element_type>::type
+            value_type;
+        typedef detail::hash_index<value_type, Hash, Equal>
+            set_type;
+        typedef detail::first_seen<value_type, Hash, Equal>
+            seen_type;
+    public:
+        struct cursor {
+            typedef typename util::min_iterator_category<
+                    forward_cursor_tag,
+                    typename inner_cursor::cursor_category>::type
+                cursor_category;
+            typedef typename inner_cursor::element_type
+                element_type;
+            typedef typename inner_cursor::reference_type
+                reference_type;
+
+            cursor(const inner_cursor& cur, std::shared_ptr<const set_type> second, std::shared_ptr<seen_type> seen)
+            : cur(cur), second(std::move(second)), seen(std::move(seen)), position(0)
+            {
+                if (!this->cur.empty() && !take()) {
+                    inc();
+                }
+            }
+
+            void forget() { cur.forget(); }
+            bool empty() const { return cur.empty(); }
+            void inc() {
+                for (;;) {
+                    cur.inc();
+                    ++position;
+                    if (cur.empty() || take()) break;
+                }
+            }
+            reference_type get() const {
+                return cur.get();
+            }
+
+        private:
+            bool take() {
+                auto&& value = cur.get();
+                return second->find(value) == set_type::npos && seen->is_first(value, position);
+            }
+
+            inner_cursor                        cur;
+            std::shared_ptr<const set_type>     second;
+            std::shared_ptr<seen_type>          seen;
+            // the position of cur in the input
+            std::size_t                         position;
+        };
+
+        linq_except(const Collection& c, const Collection2& c2, Hash hash, Equal eq, size_t expected)
+        : c(c), c2(c2), hash(std::move(hash)), eq(std::move(eq)), expected(expected)
+        {
+        }
+
+        cursor get_cursor() const {
+            return cursor(c.get_cursor(), detail::make_set(c2.get_cursor(), set_type(expected, hash, eq)), std::make_shared<seen_type>(0, hash, eq));
+        }
+
+    private:
+        Collection  c;
+        Collection2 c2;
+        Hash        hash;
+        Equal       eq;
+        size_t      expected;
+    };
+}
+
+#endif // !defined(CPPLINQ_LINQ_SET_HPP)
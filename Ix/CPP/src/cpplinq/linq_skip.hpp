@@ -14,15 +14,12 @@ namespace cpplinq
 
         linq_skip(const Collection& c, size_t n) : c(c), n(n) {}
 
+        // random access cursors skip the first n elements instead of reading them
         cursor get_cursor() const {
-            size_t rem = n;
-
             auto cur = c.get_cursor();
-            while(rem-- && !cur.empty()) {
-                cur.inc();
-            }
+            util::advance(cur, n);
             cur.forget();
-            return std::move(cur);
+            return cur;
         }
 
     private:
@@ -12,6 +12,7 @@ namespace cpplinq
         typedef typename InnerCursor::element_type element_type;
         typedef typename InnerCursor::reference_type reference_type;
         typedef typename InnerCursor::cursor_category cursor_category;
+        typedef typename util::batch_category<InnerCursor>::type batch_category;
 
         linq_take_cursor(const InnerCursor& cur, size_t rem) : cur(cur), rem(rem) {}
 
@@ -21,11 +22,37 @@ namespace cpplinq
         reference_type get() const { return cur.get(); }
 
         bool atbegin() const { return cur.atbegin(); }
-        void dec() { cur.dec(); --rem; }
+        void dec() { cur.dec(); ++rem; }
 
         void skip(size_t n) { cur.skip(n); rem -= n; }
         size_t position() const { return cur.position(); }
-        size_t size() const { return cur.size(); }
+        // ends rem elements past the position, or where the input ends
+        size_t size() const { return cur.position() + std::min(rem, cur.size() - cur.position()); }
+
+        // at most rem elements, exactly that many if the input has more
+        util::size_hint size_hint() const {
+            auto hint = util::get_size_hint(cur);
+            if (hint.kind == util::size_hint::unknown_size) {
+                return util::size_hint::at_most(rem);
+            }
+            hint.count = std::min(hint.count, rem);
+            return hint;
+        }
+
+        size_t get_batch(typename util::batch_value<linq_take_cursor>::type* out, size_t max) {
+            size_t n = cur.get_batch(out, std::min(max, rem));
+            rem -= n;
+            return n;
+        }
+
+        template <class C = InnerCursor>
+        auto span() const -> decltype(std::declval<const C&>().span()) {
+            auto in = cur.span();
+            if (size_t(in.second - in.first) > rem) {
+                in.second = in.first + rem;
+            }
+            return in;
+        }
             
     private:
         InnerCursor cur;
@@ -33,6 +60,14 @@ namespace cpplinq
     };
 
     namespace detail {
+        // the collection to read when only its first n elements are needed.
+        //   collections that can do less work then overload this.
+        template <class Collection>
+        const Collection& take_limit(const Collection& c, size_t)
+        {
+            return c;
+        }
+
         template <class Collection>
         linq_take_cursor<typename Collection::cursor> 
             take_get_cursor_(
@@ -201,6 +201,14 @@ namespace cpplinq { namespace util {
             }
         }
 
+        // destroys the value and constructs the new one in its place, so
+        //   T need not be assignable
+        void replace(T value) {
+            reset();
+            new (reinterpret_cast<T*>(&storage)) T(std::move(value));
+            is_set = true;
+        }
+
         T& operator*() { return *get(); }
         const T& operator*() const { return *get(); }
         T* operator->() { return get(); }
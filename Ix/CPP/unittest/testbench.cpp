@@ -3,11 +3,17 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <list>
 #include <functional>
 #include <algorithm>
 #include <numeric>
 #include <iterator>
 #include <string>
+#include <unordered_set>
+#include <cctype>
+#include <fstream>
+#include <cstdio>
+#include <regex>
 
 #include <ctime>
 
@@ -16,6 +22,7 @@
 #include <boost/iterator.hpp>
 
 #include "cpplinq/linq.hpp"
+#include "cpplinq/linq_file.hpp"
 
 #include "testbench.hpp"
 
@@ -259,6 +266,465 @@ TEST(test_groupby)
     }
 }
 
+TEST(test_groupby_order)
+{
+    int data[] = {13, 4, 21, 7, 33, 14, 1, 24};
+    vector<int> xs(begin(data), end(data));
+
+    // groups appear in the order of their first element, and elements
+    // keep their input order within each group
+    auto hashed = from(xs).groupby([](int i){ return i % 10; });
+    VERIFY_EQ(4, from(hashed).count());
+
+    auto group = begin(hashed);
+    VERIFY_EQ(3, group->key);
+    VERIFY(vector<int>(group->begin(), group->end()) == from(xs).where([](int i){ return i % 10 == 3; }).to_vector());
+    ++group;
+    VERIFY_EQ(4, group->key);
+    VERIFY(vector<int>(group->begin(), group->end()) == from(xs).where([](int i){ return i % 10 == 4; }).to_vector());
+    ++group;
+    VERIFY_EQ(1, group->key);
+    ++group;
+    VERIFY_EQ(7, group->key);
+
+    // an ordering comparator groups the same way
+    auto ordered = from(xs).groupby([](int i){ return i % 10; }, std::greater<int>());
+    VERIFY_EQ(4, from(ordered).count());
+    auto hashedGroup = begin(hashed);
+    for (auto group = begin(ordered); group != end(ordered); ++group, ++hashedGroup) {
+        VERIFY_EQ(hashedGroup->key, group->key);
+        VERIFY(vector<int>(group->begin(), group->end()) == vector<int>(hashedGroup->begin(), hashedGroup->end()));
+    }
+
+    // keys that std::hash cannot hash are ordered with < instead
+    auto paired = from(xs).groupby([](int i){ return std::make_pair(i % 2, i % 10 > 3); });
+    VERIFY_EQ(3, from(paired).count());
+    auto pairGroup = begin(paired);
+    VERIFY(std::make_pair(1, false) == pairGroup->key);
+    VERIFY(vector<int>(pairGroup->begin(), pairGroup->end()) == from(xs).where([](int i){ return i % 10 == 1 || i % 10 == 3; }).to_vector());
+    ++pairGroup;
+    VERIFY(std::make_pair(0, true) == pairGroup->key);
+    ++pairGroup;
+    VERIFY(std::make_pair(1, true) == pairGroup->key);
+}
+
+TEST(test_groupby_lazy)
+{
+    int pulled = 0;
+    auto xs = int_range(0, 1000);
+    auto grouped = 
+        from(xs)
+        .select([&](int i){ ++pulled; return i; })
+        .groupby([](int i){ return i % 3; });
+
+    // the first group only needs the first element
+    auto group = begin(grouped);
+    VERIFY_EQ(0, group->key);
+    VERIFY_EQ(1, pulled);
+
+    // walking a group reads the input up to its next element
+    auto elem = group->begin();
+    ++elem;
+    VERIFY_EQ(3, *elem);
+    VERIFY_EQ(4, pulled);
+
+    // later groups were already found on the way
+    ++group;
+    ++group;
+    VERIFY_EQ(2, group->key);
+    VERIFY_EQ(4, pulled);
+}
+
+namespace {
+    struct customer { int id; string name; };
+    struct order { int customer; int amount; };
+}
+
+TEST(test_join)
+{
+    vector<customer> customers;
+    customer cs[] = { {1, "ann"}, {2, "bob"}, {3, "cat"} };
+    customers.assign(begin(cs), end(cs));
+    vector<order> orders;
+    order os[] = { {2, 10}, {9, 99}, {1, 20}, {2, 30}, {1, 40} };
+    orders.assign(begin(os), end(os));
+
+    // in the order of the outer sequence, orders without a customer are dropped
+    auto named = from(orders)
+        .join(from(customers),
+            [](const order& o){ return o.customer; },
+            [](const customer& c){ return c.id; },
+            [](const order& o, const customer& c){ return c.name + ":" + std::to_string(o.amount); })
+        .to_vector();
+    string expected[] = { "bob:10", "ann:20", "bob:30", "ann:40" };
+    VERIFY(named == vector<string>(begin(expected), end(expected)));
+
+    // several matches keep the order of the inner sequence
+    vector<int> keys = vector_range(1, 4);
+    int values[] = {21, 11, 22, 31, 23};
+    auto tens = [](int v){ return v / 10; };
+    auto identity = [](int k){ return k; };
+    auto joined = from(keys).join(from(values, values + 5), identity, tens, [](int k, int v){ return k * 100 + v; }).to_vector();
+    int expectedJoined[] = {111, 221, 222, 223, 331};
+    VERIFY(joined == vector<int>(begin(expectedJoined), end(expectedJoined)));
+
+    // every outer element appears once, with the query of its matches
+    auto counts = from(customers)
+        .group_join(from(orders),
+            [](const customer& c){ return c.id; },
+            [](const order& o){ return o.customer; },
+            [](const customer& c, linq_driver<iter_cursor<const order*>> matches){ return c.name + ":" + std::to_string(matches.count()); })
+        .to_vector();
+    string expectedCounts[] = { "ann:2", "bob:2", "cat:0" };
+    VERIFY(counts == vector<string>(begin(expectedCounts), end(expectedCounts)));
+
+    vector<int> none;
+    VERIFY_EQ(0, from(none).join(from(values, values + 5), identity, tens, std::plus<int>()).count());
+    VERIFY_EQ(0, from(keys).join(from(none), identity, identity, std::plus<int>()).count());
+
+    // the outer sequence is read only as far as needed
+    int furthest = 0;
+    auto lazy = from(keys)
+        .select([&](int k){ furthest = std::max(furthest, k); return k; })
+        .join(from(values, values + 5), identity, tens, [](int k, int v){ return k * 100 + v; });
+    VERIFY_EQ(111, *lazy.begin());
+    VERIFY_EQ(1, furthest);
+}
+
+TEST(test_order_by)
+{
+    struct person { string name; int age; };
+    person ps[] = { {"dan", 30}, {"ann", 25}, {"cat", 30}, {"bob", 25}, {"eve", 40} };
+    vector<person> people(begin(ps), end(ps));
+    auto age = [](const person& p){ return p.age; };
+    auto name = [](const person& p){ return p.name; };
+    auto names = [&](const vector<person>& v){ return from(v).select(name).to_vector(); };
+
+    // equal keys keep the input order
+    string byAge[] = {"ann", "bob", "dan", "cat", "eve"};
+    VERIFY(names(from(people).order_by(age).to_vector()) == vector<string>(begin(byAge), end(byAge)));
+    string byAgeDescending[] = {"eve", "dan", "cat", "ann", "bob"};
+    VERIFY(names(from(people).order_by_descending(age).to_vector()) == vector<string>(begin(byAgeDescending), end(byAgeDescending)));
+    string byAgeName[] = {"ann", "bob", "cat", "dan", "eve"};
+    VERIFY(names(from(people).order_by(age).then_by(name).to_vector()) == vector<string>(begin(byAgeName), end(byAgeName)));
+    string byAgeNameDescending[] = {"bob", "ann", "dan", "cat", "eve"};
+    VERIFY(names(from(people).order_by(age).then_by_descending(name).to_vector()) == vector<string>(begin(byAgeNameDescending), end(byAgeNameDescending)));
+    string byLess[] = {"eve", "dan", "cat", "bob", "ann"};
+    VERIFY(names(from(people).order_by(age, std::greater<int>()).then_by(name, std::greater<string>()).to_vector()) == vector<string>(begin(byLess), end(byLess)));
+
+    VERIFY(names(from(people).order_by(age).then_by(name).take(3).to_vector()) == vector<string>(begin(byAgeName), begin(byAgeName) + 3));
+    VERIFY_EQ("eve", from(people).order_by_descending(age).first().name);
+    VERIFY_EQ("cat", from(people).order_by(age).then_by(name).skip(2).first().name);
+    VERIFY_EQ(5, from(people).order_by(age).take(20).count());
+    VERIFY_EQ(0, from(people).order_by(age).take(0).count());
+
+    // many ties, against std::stable_sort, for the heap, nth_element and full sorts
+    vector<int> xs;
+    unsigned int seed = 7;
+    for (int i = 0; i < 100000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        xs.push_back(int((seed >> 8) % 1000));
+    }
+    auto mod = [](int x){ return x % 100; };
+    vector<int> expected = xs;
+    std::stable_sort(expected.begin(), expected.end(), [&](int a, int b){ return mod(a) < mod(b); });
+    size_t limits[] = {1, 10, 1000, 5000, 99999, 100000};
+    for (size_t k : limits) {
+        VERIFY(from(xs).order_by(mod).take(k).to_vector() == vector<int>(expected.begin(), expected.begin() + k));
+    }
+    VERIFY(from(xs).order_by(mod).parallel_sort(3).to_vector() == expected);
+
+    // the heap breaks ties on the first key with then_by, as elements replace each other
+    auto tens = [](int x){ return x / 100; };
+    vector<int> byModTens = xs;
+    std::stable_sort(byModTens.begin(), byModTens.end(), [&](int a, int b){ return mod(a) != mod(b) ? mod(a) < mod(b) : tens(a) > tens(b); });
+    VERIFY(from(xs).order_by(mod).then_by_descending(tens).take(500).to_vector() == vector<int>(byModTens.begin(), byModTens.begin() + 500));
+
+    // nothing is read until the query is enumerated
+    int reads = 0;
+    auto lazy = from(xs).select([&](int x){ ++reads; return x; }).order_by(mod);
+    VERIFY_EQ(0, reads);
+    VERIFY_EQ(expected[0], lazy.first());
+}
+
+namespace {
+    // the elements from the second on, read first by an iterator and then
+    //   by a copy made before the iterator moved
+    template <class Query>
+    bool copy_reads_same(Query q)
+    {
+        auto it = q.begin();
+        ++it;
+        auto copy = it;
+        vector<int> original, copied;
+        for (; it != q.end(); ++it) original.push_back(*it);
+        for (; copy != q.end(); ++copy) copied.push_back(*copy);
+        return !original.empty() && original == copied;
+    }
+}
+
+TEST(test_set_operators)
+{
+    int xs[] = {3, 1, 3, 2, 1, 5, 2};
+    int ys[] = {2, 6, 5, 6, 4};
+    auto first = from(xs, xs + 7);
+    auto second = from(ys, ys + 5);
+
+    // first occurrences, in input order
+    int distinct[] = {3, 1, 2, 5};
+    VERIFY(first.distinct().to_vector() == vector<int>(begin(distinct), end(distinct)));
+    int unioned[] = {3, 1, 2, 5, 6, 4};
+    VERIFY(first.union_with(second).to_vector() == vector<int>(begin(unioned), end(unioned)));
+    int intersected[] = {2, 5};
+    VERIFY(first.intersect(second).to_vector() == vector<int>(begin(intersected), end(intersected)));
+    int excepted[] = {3, 1};
+    VERIFY(first.except(second).to_vector() == vector<int>(begin(excepted), end(excepted)));
+    VERIFY_EQ(4, first.distinct().count());
+
+    vector<int> none;
+    VERIFY(from(none).distinct().to_vector().empty());
+    VERIFY_EQ(4, from(none).union_with(second).count());
+    VERIFY_EQ(4, first.union_with(from(none)).count());
+    VERIFY(first.intersect(from(none)).to_vector().empty());
+    VERIFY_EQ(4, first.except(from(none)).count());
+
+    // copies of a cursor share its set, and each still reads every element
+    VERIFY(copy_reads_same(first.distinct()));
+    VERIFY(copy_reads_same(first.union_with(second)));
+    VERIFY(copy_reads_same(first.intersect(second)));
+    VERIFY(copy_reads_same(first.except(second)));
+
+    // a custom hash and equality, case insensitive
+    string ws[] = {"Apple", "apple", "Pear", "APPLE", "pear", "fig"};
+    vector<string> words(begin(ws), end(ws));
+    auto lower = [](string s){ for (auto& ch : s) ch = char(tolower(ch)); return s; };
+    auto hash = [&](const string& s){ return std::hash<string>()(lower(s)); };
+    auto eq = [&](const string& x, const string& y){ return lower(x) == lower(y); };
+    string fruit[] = {"Apple", "Pear", "fig"};
+    VERIFY(from(words).distinct(hash, eq).to_vector() == vector<string>(begin(fruit), end(fruit)));
+    VERIFY(from(words).distinct(hash, eq, 100).to_vector() == vector<string>(begin(fruit), end(fruit)));
+    string os[] = {"PEAR", "kiwi"};
+    vector<string> other(begin(os), end(os));
+    VERIFY(from(words).intersect(from(other), hash, eq).to_vector() == vector<string>(1, "Pear"));
+    VERIFY_EQ(2, from(words).except(from(other), hash, eq).count());
+    VERIFY_EQ(4, from(words).union_with(from(other), hash, eq).count());
+
+    // the input is read only as far as the next new element
+    int furthest = -1;
+    vector<int> positions = vector_range(0, 7);
+    auto lazy = from(positions).select([&](int i){ furthest = std::max(furthest, i); return xs[i]; }).distinct();
+    auto it = lazy.begin();
+    ++it; ++it;
+    VERIFY_EQ(2, *it);
+    VERIFY_EQ(3, furthest);
+
+    // against a first-seen table, past several grows of the set
+    vector<int> ids;
+    unsigned int seed = 1;
+    for (int i = 0; i < 100000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        ids.push_back(int((seed >> 8) % 10000));
+    }
+    vector<char> seen(10000);
+    vector<int> expected;
+    for (int id : ids) {
+        if (!seen[id]) {
+            seen[id] = 1;
+            expected.push_back(id);
+        }
+    }
+    VERIFY(from(ids).distinct().to_vector() == expected);
+    VERIFY(from(ids).distinct(default_hash(), default_equality(), 10000).to_vector() == expected);
+}
+
+TEST(test_lines)
+{
+    const char* path = "cpplinq_lines.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "a\r\nbb\n\nlast";
+    }
+    {
+        auto lines = from_lines(path);
+        VERIFY_EQ(4, lines.count());
+        VERIFY(lines.element_at(0) == "a");
+        VERIFY(lines.element_at(1) == "bb");
+        VERIFY(lines.element_at(2).empty());
+        VERIFY(lines.last() == "last");
+        VERIFY_EQ(2, lines.where([](string_ref s){ return s.size() == 2 || s.size() == 4; }).count());
+    }
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "x;y;;z;";
+    }
+    string records[] = {"x", "y", "", "z"};
+    VERIFY(from_records(path, ';').select([](string_ref s){ return s.str(); }).to_vector() == vector<string>(begin(records), end(records)));
+    {
+        std::ofstream file(path, std::ios::binary);
+    }
+    VERIFY_EQ(0, from_lines(path).count());
+
+    // against std::getline, over more than one vector block per line
+    vector<string> expected;
+    {
+        std::ofstream file(path, std::ios::binary);
+        for (int i = 0; i < 10000; ++i) {
+            string line(i % 150, char('a' + i % 26));
+            expected.push_back(line);
+            file << line << (i % 7 == 0 ? "\r\n" : "\n");
+        }
+    }
+    VERIFY(from_lines(path).select([](string_ref s){ return s.str(); }).to_vector() == expected);
+    VERIFY_EQ(10000, from_lines(path).parallel(3).count());
+    VERIFY_EQ(from(expected).distinct().count(), from_lines(path).distinct().count());
+    std::remove(path);
+
+    bool threw = false;
+    try {
+        from_lines(path);
+    } catch (std::logic_error&) {
+        threw = true;
+    }
+    VERIFY(threw);
+
+    string line = "{'var': [('concurrency', 4), ('args', '-test async-gated')], 'result': {'nonpaged': 25400.0, 'time': 71.75}}";
+    VERIFY(key_value(line, "args") == "-test async-gated");
+    VERIFY_EQ(4, to_long(key_value(line, "concurrency")));
+    VERIFY_EQ(71.75, to_double(key_value(line, "time")));
+    VERIFY(key_value("ab=1 b=22", "b") == "22");
+    VERIFY(key_value("{\"name\": \"x y\"}", "name") == "x y");
+    threw = false;
+    try {
+        key_value(line, "workingset");
+    } catch (std::logic_error&) {
+        threw = true;
+    }
+    VERIFY(threw);
+}
+
+TEST(test_parallel)
+{
+    vector<int> xs = vector_range(0, 1000);
+    auto sequential = from(xs).where([](int i){ return i % 3 == 0; }).select([](int i){ return i * 2; });
+
+    for (size_t threads = 1; threads <= 7; ++threads) {
+        auto q = from(xs).parallel(threads);
+
+        VERIFY_EQ(1000, q.count());
+        VERIFY_EQ(500, q.count([](int i){ return i % 2 == 0; }));
+        VERIFY_EQ(999 * 1000 / 2, q.sum());
+        VERIFY_EQ(999 * 1000 / 2, q.aggregate(std::plus<int>()));
+        VERIFY_EQ(999 * 1000 / 2, q.aggregate(0LL, [](long long a, int i){ return a + i; }, std::plus<long long>()));
+        VERIFY_EQ(999, q.max());
+        VERIFY_EQ(0, q.min());
+        VERIFY(q.any([](int i){ return i == 777; }));
+        VERIFY(!q.any([](int i){ return i < 0; }));
+        VERIFY(q.all([](int i){ return i >= 0; }));
+        VERIFY(!q.all([](int i){ return i < 999; }));
+
+        // ranges are merged in the order of the input
+        auto v = q.where([](int i){ return i % 3 == 0; }).select([](int i){ return i * 2; }).to_vector();
+        VERIFY(v == sequential.to_vector());
+
+        bool threw = false;
+        try {
+            q.where([](int i){ return i < 0; }).max();
+        } catch (std::logic_error&) {
+            threw = true;
+        }
+        VERIFY(threw);
+    }
+
+    vector<int> empty;
+    VERIFY_EQ(0, from(empty).parallel(4).count());
+    VERIFY(!from(empty).parallel(4).any());
+    VERIFY(from(empty).parallel(4).to_vector().empty());
+}
+
+TEST(test_reductions)
+{
+    // sizes around the vector widths, so that both the vector loop and the tail run
+    for (int n = 1; n <= 40; ++n) {
+        vector<double> xs;
+        for (int i = 0; i < n; ++i) {
+            xs.push_back(double((i * 37) % 23) - 11);
+        }
+        double total = std::accumulate(xs.begin(), xs.end(), 0.0);
+
+        VERIFY_EQ(total, from(xs).sum());
+        VERIFY_EQ(total, from(xs).aggregate(std::plus<double>()));
+        VERIFY_EQ(total / n, from(xs).average());
+        VERIFY_EQ(*std::max_element(xs.begin(), xs.end()), from(xs).max());
+        VERIFY_EQ(*std::min_element(xs.begin(), xs.end()), from(xs).min());
+        VERIFY_EQ(std::count_if(xs.begin(), xs.end(), [](double x){ return x > 0; }), from(xs).count([](double x){ return x > 0; }));
+
+        // the first of equal elements, as with std::min_element
+        VERIFY(&from(xs).min() == &*std::min_element(xs.begin(), xs.end()));
+        VERIFY(&from(xs).max() == &*std::max_element(xs.begin(), xs.end()));
+
+        vector<int> is(xs.begin(), xs.end());
+        VERIFY_EQ(std::accumulate(is.begin(), is.end(), 0), from(is).sum());
+        VERIFY_EQ(*std::max_element(is.begin(), is.end()), from(is).max());
+        VERIFY_EQ(*std::min_element(is.begin(), is.end()), from(is).min());
+    }
+
+    // field reads from an array of records
+    struct record { int id; double value; };
+    vector<record> rs;
+    for (int i = 0; i < 100; ++i) {
+        record r = { i, i * 0.5 };
+        rs.push_back(r);
+    }
+    VERIFY_EQ(99 * 100 / 4.0, from(rs).select([](const record& r){ return r.value; }).sum());
+    VERIFY_EQ(99, from(rs).select([](const record& r){ return r.id; }).max());
+    VERIFY_EQ(0, from(rs).select([](const record& r){ return r.id; }).min());
+    VERIFY_EQ(49.5, from(rs).select([](const record& r){ return r.id; }).average());
+    VERIFY_EQ(50, from(rs).select([](const record& r){ return r.id; }).count([](int id){ return id % 2 == 0; }));
+
+    vector<double> empty;
+    VERIFY_EQ(0.0, from(empty).sum());
+    bool threw = false;
+    try {
+        from(empty).max();
+    } catch (std::logic_error&) {
+        threw = true;
+    }
+    VERIFY(threw);
+}
+
+TEST(test_batches)
+{
+    // sizes around the batch size, so that full and partial batches are read
+    int sizes[] = {0, 1, 255, 256, 257, 1000};
+    for (int n : sizes) {
+        vector<int> xs;
+        for (int i = 0; i < n; ++i) {
+            xs.push_back((i * 37) % 101 - 50);
+        }
+        auto twice = [](int x){ return x * 2; };
+        auto positive = [](int x){ return x > 0; };
+
+        for (int k = 0; k <= n + 1; k += 1 + n / 7) {
+            int m = std::min(k, n);
+            int taken = std::accumulate(xs.begin(), xs.begin() + m, 0);
+            int skipped = std::accumulate(xs.begin() + m, xs.end(), 0);
+
+            VERIFY_EQ(m, (int)from(xs).take(k).to_vector().size());
+            VERIFY_EQ(m, (int)from(xs).select(twice).take(k).to_vector().size());
+            VERIFY_EQ(taken, from(xs).take(k).sum());
+            VERIFY_EQ(skipped, from(xs).skip(k).sum());
+            VERIFY_EQ(2 * taken, from(xs).select(twice).take(k).sum());
+            VERIFY_EQ(2 * skipped, from(xs).select(twice).skip(k).sum());
+            VERIFY_EQ(std::count_if(xs.begin(), xs.begin() + m, positive), from(xs).take(k).count(positive));
+            VERIFY_EQ(std::count_if(xs.begin() + m, xs.end(), positive), from(xs).skip(k).count(positive));
+            if (m > 0) {
+                VERIFY_EQ(taken, from(xs).take(k).aggregate(std::plus<int>()));
+                VERIFY_EQ(double(2 * taken) / m, from(xs).select(twice).take(k).average());
+            }
+        }
+    }
+}
+
 TEST(test_symbolname)
 {
     auto complexQuery = 
@@ -404,6 +870,35 @@ TEST(test_cursor_selectmany2)
     VERIFY( result.second == range2.end());
 }
 
+TEST(test_selectmany_sources)
+{
+    struct person { string name; vector<int> items; };
+    person ps[] = { {"ann", vector_range(1, 3)}, {"bob", vector<int>()}, {"cat", vector_range(3, 4)} };
+    vector<person> people(begin(ps), end(ps));
+    int expected[] = {1, 2, 3};
+
+    // a reference to a container is read in place
+    auto items = from(people).select_many([](const person& p) -> const vector<int>& { return p.items; });
+    VERIFY(items.to_vector() == vector<int>(begin(expected), end(expected)));
+    VERIFY(&items.first() == &people[0].items[0]);
+
+    // a query, with a result selector
+    auto named = from(people).select_many(
+        [](const person& p) { return from(p.items); },
+        [](const person& p, int i) { return p.name + std::to_string(i); });
+    string expectedNames[] = {"ann1", "ann2", "cat3"};
+    VERIFY(named.to_vector() == vector<string>(begin(expectedNames), end(expectedNames)));
+
+    // a container by value is kept by the cursor, also when the cursor is copied
+    auto copies = from(people).select_many([](const person& p) { return p.items; });
+    VERIFY(vector<int>(copies.begin(), copies.end()) == vector<int>(begin(expected), end(expected)));
+    VERIFY_EQ(1, copies.first());
+
+    vector<person> none;
+    VERIFY_EQ(0, from(none).select_many([](const person& p) { return from(p.items); }).count());
+    VERIFY_EQ(0, from(people).select_many([](const person&) { return vector<int>(); }).count());
+}
+
 TEST(test_late_bind)
 {
     int_range range1(0, 100);
@@ -417,6 +912,72 @@ TEST(test_late_bind)
     cout << "typeof q1.late_bind() ==> " << typeid(q1.late_bind()).name() << endl;
 }
 
+TEST(test_size_hints)
+{
+    vector<int> xs;
+    for (int i = 0; i < 1000; ++i) xs.push_back(i);
+    int reads = 0;
+    auto q = from(xs).select([&](int x){ ++reads; return x * 2; });
+
+    // random access queries are not read to count, index or skip
+    VERIFY_EQ(1000, q.count());
+    VERIFY_EQ(10, q.element_at(5));
+    VERIFY_EQ(20, q[10]);
+    VERIFY_EQ(1998, q.last());
+    VERIFY_EQ(10, q.skip(990).count());
+    VERIFY_EQ(995, q.skip(5).take(995).count());
+    VERIFY_EQ(0, q.skip(5000).count());
+    VERIFY_EQ(3, reads);
+
+    // nor through late_bind
+    reads = 0;
+    auto lb = q.late_bind();
+    VERIFY_EQ(1000, lb.count());
+    VERIFY_EQ(10, lb.take(10).count());
+    VERIFY_EQ(1000, lb.element_at(500));
+    VERIFY_EQ(1998, lb.last());
+    VERIFY_EQ(1000, lb.skip(500).first());
+    VERIFY_EQ(3, reads);
+    VERIFY_EQ(0, lb.element_at_or_default(2000));
+
+    // take and the slices of parallel() only reach as far as their count
+    auto taken = q.take(10);
+    VERIFY_EQ(10, taken.count());
+    VERIFY_EQ(18, taken.last());
+    VERIFY_EQ(0, taken.element_at_or_default(20));
+    auto takenAll = taken.to_vector();
+    VERIFY_EQ(10u, takenAll.size());
+    VERIFY_EQ(10u, takenAll.capacity());
+
+    typedef iter_cursor<vector<int>::iterator> xs_cursor;
+    linq_driver<detail::parallel_slice<xs_cursor>> slice(detail::parallel_slice<xs_cursor>(xs_cursor(xs.begin(), xs.end()), 500, 10));
+    VERIFY_EQ(10, slice.count());
+    VERIFY_EQ(509, slice.last());
+    VERIFY_EQ(509, slice.element_at(9));
+    VERIFY_EQ(0, slice.element_at_or_default(20));
+    auto sliced = slice.select([](int x){ return x * 2; }).to_vector();
+    VERIFY_EQ(10u, sliced.size());
+    VERIFY_EQ(10u, sliced.capacity());
+    VERIFY_EQ(1018, sliced.back());
+    VERIFY_EQ(990, from(xs).skip(10).parallel(4).count());
+    VERIFY_EQ(10, from(xs).skip(10).parallel(4).to_vector().front());
+
+    // to_vector allocates once
+    auto all = lb.to_vector();
+    VERIFY_EQ(all.size(), all.capacity());
+    auto odd = from(xs).where([](int x){ return x % 2 != 0; }).take(3).to_vector();
+    VERIFY_EQ(3u, odd.capacity());
+    VERIFY_EQ(5, odd[2]);
+
+    // forward queries are read, and last works on cursors that cannot be assigned
+    std::list<int> ys(xs.begin(), xs.end());
+    VERIFY_EQ(1000, from(ys).count());
+    VERIFY_EQ(4, from(ys).take(5).last());
+    VERIFY_EQ(3, from(ys).skip(997).count());
+    VERIFY_EQ(999, from(ys).where([](int x){ return x > 0; }).last());
+    VERIFY_EQ(0, from(ys).where([](int x){ return x < 0; }).last_or_default());
+}
+
 struct stopwatch
 {
     time_t t0, t1;
@@ -512,6 +1073,393 @@ TEST(test_performance)
 #endif
 }
 
+TEST(test_groupby_performance)
+{
+#ifdef PERF
+    // groups 10M rows by keys drawn from sets of 1k to 1M keys
+    const int rows = 10000000;
+    vector<int> data(rows);
+    unsigned int seed = 1;
+
+    for (int keys = 1000; keys <= 1000000; keys *= 10) {
+        for (auto& v : data) {
+            seed = seed * 1103515245 + 12345;
+            v = int((seed >> 8) % keys);
+        }
+
+        stopwatch sw;
+        sw.start();
+        auto groups = from(data).groupby([](int v){ return v; });
+        size_t total = 0;
+        for (auto group = begin(groups); group != end(groups); ++group) {
+            total += from(*group).count();
+        }
+        sw.stop();
+
+        VERIFY_EQ(size_t(rows), total);
+        cout << "groupby " << rows << " rows, " << keys << " keys: " << sw.value() << " s\n";
+    }
+    cout << endl;
+#endif
+}
+
+TEST(test_join_performance)
+{
+#ifdef PERF
+    // joins 1M orders to 1M customers
+    const int rows = 1000000;
+    vector<customer> customers(rows);
+    vector<order> orders(rows);
+    for (int i = 0; i < rows; ++i) {
+        customers[i].id = i;
+        customers[i].name = i % 2 ? "odd" : "even";
+        orders[i].customer = int((i * 2654435761u) % rows);
+        orders[i].amount = i % 100;
+    }
+
+    stopwatch sw;
+    sw.start();
+    auto joined = from(orders)
+        .join(from(customers),
+            [](const order& o){ return o.customer; },
+            [](const customer& c){ return c.id; },
+            [](const order& o, const customer& c){ return o.amount * int(c.name.size()); })
+        .sum();
+    sw.stop();
+    cout << "join " << rows << " x " << rows << " rows: " << sw.value() << " s\n";
+
+    // the nested equivalent scans the customers for each order, so only
+    //   a prefix of the orders is timed
+    const int prefix = 1000;
+    sw.start();
+    int nested = 0;
+    for (int i = 0; i < prefix; ++i) {
+        const order& o = orders[i];
+        nested += from(customers)
+            .where([&](const customer& c){ return c.id == o.customer; })
+            .select([&](const customer& c){ return o.amount * int(c.name.size()); })
+            .sum();
+    }
+    sw.stop();
+    VERIFY(nested <= joined);
+    cout << "nested where, " << prefix << " x " << rows << " rows: " << sw.value() << " s, "
+         << sw.value() * rows / prefix << " s for all rows\n";
+    cout << endl;
+#endif
+}
+
+TEST(test_order_by_performance)
+{
+#ifdef PERF
+    // orders 1M records of 128 bytes by an int key
+    struct record { int key; char payload[124]; };
+    const int rows = 1000000;
+    vector<record> records(rows);
+    unsigned int seed = 1;
+    for (auto& r : records) {
+        seed = seed * 1103515245 + 12345;
+        r.key = int(seed >> 8);
+    }
+    auto key = [](const record& r){ return r.key; };
+    auto keyLess = [](const record& a, const record& b){ return a.key < b.key; };
+
+    stopwatch sw;
+    sw.start();
+    auto copy = records;
+    std::stable_sort(copy.begin(), copy.end(), keyLess);
+    sw.stop();
+    cout << "to_vector and std::stable_sort: " << sw.value() << " s\n";
+
+    sw.start();
+    auto sorted = from(records).order_by(key).to_vector();
+    sw.stop();
+    VERIFY_EQ(copy[rows / 2].key, sorted[rows / 2].key);
+    cout << "order_by: " << sw.value() << " s\n";
+
+    sw.start();
+    auto top = from(records).order_by(key).take(10).to_vector();
+    sw.stop();
+    VERIFY_EQ(copy[9].key, top[9].key);
+    cout << "order_by, take(10): " << sw.value() << " s\n";
+
+    sw.start();
+    auto parallel = from(records).order_by(key).parallel_sort().to_vector();
+    sw.stop();
+    VERIFY_EQ(copy[rows / 2].key, parallel[rows / 2].key);
+    cout << "order_by, parallel_sort(): " << sw.value() << " s\n";
+    cout << endl;
+#endif
+}
+
+TEST(test_distinct_performance)
+{
+#ifdef PERF
+    // deduplicates 10M event ids, about 1M of them distinct
+    vector<long long> events;
+    events.reserve(10000000);
+    unsigned int seed = 1;
+    for (int i = 0; i < 10000000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        events.push_back(1000000000000LL + (seed >> 8) % 1000000);
+    }
+
+    stopwatch sw;
+    sw.start();
+    std::unordered_set<long long> set;
+    vector<long long> expected;
+    for (auto e : events) {
+        if (set.insert(e).second) {
+            expected.push_back(e);
+        }
+    }
+    sw.stop();
+    cout << "std::unordered_set: " << sw.value() << " s\n";
+
+    sw.start();
+    auto sorted = events;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    sw.stop();
+    VERIFY_EQ(expected.size(), sorted.size());
+    cout << "std::sort, std::unique (input order lost): " << sw.value() << " s\n";
+
+    sw.start();
+    auto distinct = from(events).distinct().to_vector();
+    sw.stop();
+    VERIFY(distinct == expected);
+    cout << "distinct: " << sw.value() << " s\n";
+
+    sw.start();
+    distinct = from(events).distinct(default_hash(), default_equality(), 1000000).to_vector();
+    sw.stop();
+    VERIFY(distinct == expected);
+    cout << "distinct, expected 1M: " << sw.value() << " s\n";
+    cout << endl;
+#endif
+}
+
+TEST(test_selectmany_performance)
+{
+#ifdef PERF
+    // flattens 1M outer elements of 4 inner elements each
+    struct basket { vector<int> items; };
+    vector<basket> baskets(1000000);
+    int next = 0;
+    for (auto& b : baskets) {
+        for (int i = 0; i < 4; ++i) {
+            b.items.push_back(next++ % 1000);
+        }
+    }
+
+    stopwatch sw;
+    sw.start();
+    long long expected = 0;
+    for (auto& b : baskets) {
+        for (int i : b.items) {
+            expected += i;
+        }
+    }
+    sw.stop();
+    cout << "nested loops: " << sw.value() << " s\n";
+
+    sw.start();
+    auto byReference = from(baskets).select_many([](const basket& b) -> const vector<int>& { return b.items; })
+        .aggregate(0LL, [](long long a, int i) { return a + i; });
+    sw.stop();
+    VERIFY_EQ(expected, byReference);
+    cout << "select_many, container reference: " << sw.value() << " s\n";
+
+    sw.start();
+    auto byQuery = from(baskets).select_many([](const basket& b) { return from(b.items); })
+        .aggregate(0LL, [](long long a, int i) { return a + i; });
+    sw.stop();
+    VERIFY_EQ(expected, byQuery);
+    cout << "select_many, query: " << sw.value() << " s\n";
+
+    // the inner cursor type erased, with a virtual call per element and an
+    //   allocation per outer element
+    sw.start();
+    auto byLateBind = from(baskets).select_many([](const basket& b) { return from(b.items).late_bind(); })
+        .aggregate(0LL, [](long long a, int i) { return a + i; });
+    sw.stop();
+    VERIFY_EQ(expected, byLateBind);
+    cout << "select_many, late_bind query: " << sw.value() << " s\n";
+    cout << endl;
+#endif
+}
+
+TEST(test_lines_performance)
+{
+#ifdef PERF
+    // 1M lines in the format of the SampleCppLinq data, about 190MB
+    const char* path = "cpplinq_lines_perf.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        for (int i = 0; i < 1000000; ++i) {
+            file << "{'var': [('concurrency', " << (i % 8 + 1) << "), ('args', '-test async-gated')], "
+                 << "'result': {'workingset': 22437888.0, 'privatemem': 25964544.0, 'nonpaged': 25400.0, "
+                 << "'virtualmem': 556580864.0, 'time': " << (i % 1000) * 0.25 << "}}\n";
+        }
+    }
+    auto parse = [](string_ref line){ return to_double(key_value(line, "time")) + to_long(key_value(line, "concurrency")); };
+
+    stopwatch sw;
+    sw.start();
+    vector<string> loaded;
+    {
+        std::ifstream file(path);
+        string line;
+        while (std::getline(file, line)) {
+            loaded.push_back(line);
+        }
+    }
+    sw.stop();
+    cout << "std::getline to vector<string>: " << sw.value() << " s\n";
+
+    sw.start();
+    auto count = from_lines(path).count();
+    sw.stop();
+    VERIFY_EQ(1000000, count);
+    cout << "from_lines: " << sw.value() << " s\n";
+
+    // the extractor of SampleCppLinq, on the first 100k lines
+    std::regex pair("'([^\']*)'\\s*[:,]\\s*(\\d+(?:\\.\\d+)?|'[^']*')");
+    auto extract = [&](const string& input, const string& key) -> string {
+        for (std::sregex_iterator i(input.begin(), input.end(), pair), end; i != end; ++i) {
+            if ((*i)[1] == key) {
+                return (*i)[2];
+            }
+        }
+        throw std::range_error("search key not found");
+    };
+    sw.start();
+    double expected = 0;
+    for (size_t i = 0; i < 100000; ++i) {
+        expected += atof(extract(loaded[i], "time").c_str()) + atoi(extract(loaded[i], "concurrency").c_str());
+    }
+    sw.stop();
+    cout << "std::regex, 100k lines: " << sw.value() << " s\n";
+
+    sw.start();
+    auto parsed = from(loaded).take(100000).select([&](const string& line){ return parse(line); }).sum();
+    sw.stop();
+    VERIFY_EQ(expected, parsed);
+    cout << "key_value, 100k lines: " << sw.value() << " s\n";
+
+    sw.start();
+    parsed = from_lines(path).select(parse).sum();
+    sw.stop();
+    cout << "from_lines and key_value, 1M lines: " << sw.value() << " s\n";
+    cout << endl;
+    std::remove(path);
+#endif
+}
+
+TEST(test_parallel_performance)
+{
+#ifdef PERF
+    vector<double> xs(100000000);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = double(i % 1000);
+    }
+
+    stopwatch sw;
+    sw.start();
+    auto expected = from(xs).where([](double x){ return x > 100; }).select([](double x){ return x * 0.5; }).sum();
+    sw.stop();
+    cout << "sequential: " << sw.value() << " s\n";
+
+    for (size_t threads = 2; threads <= 16; threads *= 2) {
+        sw.start();
+        auto result = from(xs).parallel(threads).where([](double x){ return x > 100; }).select([](double x){ return x * 0.5; }).sum();
+        sw.stop();
+        VERIFY_EQ(expected, result);
+        cout << "parallel(" << threads << "): " << sw.value() << " s\n";
+    }
+    cout << endl;
+#endif
+}
+
+TEST(test_reduction_performance)
+{
+#ifdef PERF
+    vector<double> xs(1 << 16);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = double(i % 1000);
+    }
+    auto q = from(xs);
+
+    // the cursor iterators, as the reductions were done before
+    cout << "sum through the cursor" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) std::accumulate(q.begin(), q.end(), 0.0); });
+    cout << "sum over the array" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) q.sum(); });
+    cout << "max through the cursor" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) std::max_element(q.begin(), q.end()); });
+    cout << "max over the array" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) q.max(); });
+    cout << endl;
+#endif
+}
+
+TEST(test_batch_performance)
+{
+#ifdef PERF
+    vector<double> xs(1 << 16);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = double(i % 1000);
+    }
+    auto q = from(xs).take(60000);
+    auto half = [](double x){ return x * 0.5; };
+
+    cout << "take/sum through the cursor" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) std::accumulate(q.begin(), q.end(), 0.0); });
+    cout << "take/sum in batches" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) q.sum(); });
+    cout << "select/take/average through the cursor" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) { auto s = from(xs).select(half).take(60000); std::accumulate(s.begin(), s.end(), 0.0); } });
+    cout << "select/take/average in batches" << endl;
+    test_perf([&](int n){ for (int i = 0; i < n; ++i) from(xs).select(half).take(60000).average(); });
+    cout << endl;
+#endif
+}
+
+TEST(test_size_hint_performance)
+{
+#ifdef PERF
+    vector<int> xs(10000000);
+    std::iota(xs.begin(), xs.end(), 0);
+    auto q = from(xs).select([](int x){ return x * 2; }).late_bind();
+
+    stopwatch sw;
+    sw.start();
+    size_t walked = 0;
+    for (auto cur = q.get_cursor(); !cur.empty(); cur.inc()) {
+        ++walked;
+    }
+    sw.stop();
+    VERIFY_EQ(xs.size(), walked);
+    cout << "late_bind count, walking the cursor: " << sw.value() << " s\n";
+
+    sw.start();
+    auto counted = q.count();
+    auto last = q.last();
+    auto middle = q.element_at(xs.size() / 2);
+    sw.stop();
+    VERIFY_EQ(xs.size(), size_t(counted));
+    VERIFY_EQ(2 * int(xs.size() - 1), last);
+    VERIFY_EQ(int(xs.size()), middle);
+    cout << "late_bind count, last and element_at from the size hint: " << sw.value() << " s\n";
+
+    sw.start();
+    auto copy = q.to_vector();
+    sw.stop();
+    VERIFY_EQ(copy.size(), copy.capacity());
+    cout << "late_bind to_vector: " << sw.value() << " s\n";
+    cout << endl;
+#endif
+}
+
 int main(int argc, char** argv)
 {
     size_t pass=0, fail=0;
@@ -578,6 +578,447 @@ namespace rxcpp
         }
     };
 
+    namespace detail
+    {
+        //
+        // hashed hierarchical timer wheel.
+        // time is counted in ticks. there are six levels of 64 slots, each
+        // level 64 times coarser than the one below it. a timer is linked into
+        // the level picked by the highest 6 bits in which its expiry differs
+        // from the current tick, so insert and cancel are constant time. as the
+        // current tick reaches a slot on a higher level, the timers in it are
+        // moved down. timers past the top level wait in an overflow list.
+        //
+        // nodes live in chunks that never move and are linked by index. a
+        // handle holds the index and the generation of the node, so cancelling
+        // a timer that already fired is detected and ignored.
+        //
+        // not synchronized, the owner must serialize all calls.
+        //
+        template<class T>
+        class TimerWheel
+        {
+        public:
+            typedef std::uint64_t Tick;
+
+            struct Handle
+            {
+                Handle()
+                    : index(npos)
+                    , generation(0)
+                {
+                }
+                Handle(std::uint32_t i, std::uint32_t g)
+                    : index(i)
+                    , generation(g)
+                {
+                }
+                std::uint32_t index;
+                std::uint32_t generation;
+            };
+
+        private:
+            TimerWheel(const TimerWheel&);
+            TimerWheel& operator=(const TimerWheel&);
+
+            static const std::uint32_t npos = 0xFFFFFFFF;
+            static const int levelBits = 6;
+            static const int slotCount = 1 << levelBits;
+            static const int levelCount = 6;
+            // the slot index used for the overflow list
+            static const int overflowSlot = levelCount * slotCount;
+            static const std::uint16_t unlinked = 0xFFFF;
+            static const std::uint32_t chunkBits = 10;
+            static const std::uint32_t chunkSize = 1 << chunkBits;
+
+            struct Node
+            {
+                Node()
+                    : prev(npos)
+                    , next(npos)
+                    , generation(0)
+                    , slot(unlinked)
+                    , expiry(0)
+                {
+                }
+                std::uint32_t prev;
+                std::uint32_t next;
+                std::uint32_t generation;
+                std::uint16_t slot;
+                Tick expiry;
+                util::maybe<T> value;
+            };
+
+            std::vector<std::unique_ptr<Node[]>> chunks;
+            std::uint32_t allocated;
+            std::uint32_t freeList;
+            std::uint32_t heads[overflowSlot + 1];
+            std::uint64_t occupied[levelCount];
+            Tick current;
+            size_t count;
+
+            Node& node(std::uint32_t i) {
+                return chunks[i >> chunkBits][i & (chunkSize - 1)];
+            }
+
+            static int lowestBit(std::uint64_t mask) {
+#if defined(__GNUC__)
+                return __builtin_ctzll(mask);
+#else
+                int i = 0;
+                for (; (mask & 1) == 0; mask >>= 1) {
+                    ++i;
+                }
+                return i;
+#endif
+            }
+
+            std::uint32_t allocate() {
+                if (freeList != npos) {
+                    auto i = freeList;
+                    freeList = node(i).next;
+                    return i;
+                }
+                if ((allocated & (chunkSize - 1)) == 0) {
+                    chunks.emplace_back(new Node[chunkSize]);
+                }
+                return allocated++;
+            }
+
+            void release(std::uint32_t i) {
+                auto& n = node(i);
+                n.value.reset();
+                n.slot = unlinked;
+                ++n.generation;
+                n.prev = npos;
+                n.next = freeList;
+                freeList = i;
+                --count;
+            }
+
+            void link(std::uint32_t i) {
+                auto& n = node(i);
+                int level = 0;
+                for (auto diff = (n.expiry ^ current) >> levelBits; diff != 0; diff >>= levelBits) {
+                    ++level;
+                }
+                int slot = overflowSlot;
+                if (level < levelCount) {
+                    auto index = static_cast<int>((n.expiry >> (level * levelBits)) & (slotCount - 1));
+                    slot = level * slotCount + index;
+                    occupied[level] |= std::uint64_t(1) << index;
+                }
+                n.slot = static_cast<std::uint16_t>(slot);
+                n.prev = npos;
+                n.next = heads[slot];
+                if (n.next != npos) {
+                    node(n.next).prev = i;
+                }
+                heads[slot] = i;
+            }
+
+            void unlink(std::uint32_t i) {
+                auto& n = node(i);
+                if (n.prev != npos) {
+                    node(n.prev).next = n.next;
+                } else {
+                    heads[n.slot] = n.next;
+                }
+                if (n.next != npos) {
+                    node(n.next).prev = n.prev;
+                }
+                if (heads[n.slot] == npos && n.slot != overflowSlot) {
+                    occupied[n.slot / slotCount] &= ~(std::uint64_t(1) << (n.slot % slotCount));
+                }
+                n.slot = unlinked;
+            }
+
+            // the slot that holds the earliest timers and the tick at which it starts
+            bool nextSlot(int& slot, Tick& start) const {
+                for (int level = 0; level < levelCount; ++level) {
+                    auto shift = level * levelBits;
+                    auto index = static_cast<int>((current >> shift) & (slotCount - 1));
+                    auto mask = occupied[level] & (~std::uint64_t(0) << index);
+                    if (mask != 0) {
+                        auto found = lowestBit(mask);
+                        auto block = current >> (shift + levelBits) << (shift + levelBits);
+                        slot = level * slotCount + found;
+                        start = block | (Tick(found) << shift);
+                        return true;
+                    }
+                }
+                if (heads[overflowSlot] != npos) {
+                    const int top = levelCount * levelBits;
+                    slot = overflowSlot;
+                    start = ((current >> top) + 1) << top;
+                    return true;
+                }
+                return false;
+            }
+
+        public:
+            TimerWheel()
+                : allocated(0)
+                , freeList(npos)
+                , current(0)
+                , count(0)
+            {
+                for (auto& h : heads) {
+                    h = npos;
+                }
+                for (auto& o : occupied) {
+                    o = 0;
+                }
+            }
+
+            Tick Now() const {
+                return current;
+            }
+
+            size_t Size() const {
+                return count;
+            }
+
+            // expiry must be later than Now()
+            Handle Insert(Tick expiry, T value) {
+                auto i = allocate();
+                auto& n = node(i);
+                n.expiry = std::max(expiry, current + 1);
+                n.value.set(std::move(value));
+                ++count;
+                link(i);
+                return Handle(i, n.generation);
+            }
+
+            // removes the timer and moves its value out, so that the caller
+            // can destroy it after releasing any lock that protects the wheel.
+            bool Cancel(Handle h, util::maybe<T>& out) {
+                if (h.index >= allocated) {
+                    return false;
+                }
+                auto& n = node(h.index);
+                if (n.generation != h.generation || n.slot == unlinked) {
+                    return false;
+                }
+                out.set(std::move(*n.value));
+                unlink(h.index);
+                release(h.index);
+                return true;
+            }
+
+            // the earliest tick at which Advance() may find expired timers
+            bool NextExpiration(Tick& out) const {
+                int slot = 0;
+                return nextSlot(slot, out);
+            }
+
+            // moves the current tick forward to target and passes the value of
+            // each timer that expired on the way to f, in expiry order.
+            template<class F>
+            void Advance(Tick target, F&& f) {
+                int slot = 0;
+                Tick start = 0;
+                while (nextSlot(slot, start) && start <= target) {
+                    current = std::max(current, start);
+                    auto i = heads[slot];
+                    heads[slot] = npos;
+                    if (slot != overflowSlot) {
+                        occupied[slot / slotCount] &= ~(std::uint64_t(1) << (slot % slotCount));
+                    }
+                    while (i != npos) {
+                        auto& n = node(i);
+                        auto next = n.next;
+                        n.slot = unlinked;
+                        if (n.expiry <= current) {
+                            f(std::move(*n.value));
+                            release(i);
+                        } else {
+                            link(i);
+                        }
+                        i = next;
+                    }
+                }
+                current = std::max(current, target);
+            }
+        };
+    }
+
+    //
+    // runs work on one thread and keeps pending timers in a hashed
+    // hierarchical timer wheel, so scheduling and cancelling a timer costs
+    // the same no matter how many are pending. disposing the result of
+    // Schedule removes the timer and destroys the work at once.
+    //
+    // due times are rounded up to the resolution of the wheel, timers
+    // never fire early.
+    //
+    struct TimerWheelScheduler : public LocalScheduler
+    {
+    private:
+        TimerWheelScheduler(const TimerWheelScheduler&);
+
+        typedef detail::TimerWheel<Work> Wheel;
+        typedef Wheel::Tick Tick;
+
+        struct State
+        {
+            explicit State(clock::duration r)
+                : start(clock::now())
+                , resolution(r <= clock::duration::zero() ? clock::duration(1) : r)
+                , sleepingUntil(0)
+                , stopping(false)
+            {
+            }
+
+            static Tick Awake() {
+                return 0;
+            }
+            static Tick Forever() {
+                return (std::numeric_limits<Tick>::max)();
+            }
+
+            const clock::time_point start;
+            const clock::duration resolution;
+
+            std::mutex lock;
+            std::condition_variable wake;
+            // these must only be accessed under lock
+            Wheel wheel;
+            std::deque<Work> ready;
+            // the tick the thread is waiting for, or Awake
+            Tick sleepingUntil;
+            bool stopping;
+            // not owned, the scheduler owns this state
+            std::weak_ptr<Scheduler> owner;
+
+            Tick TickFloor(clock::time_point t) const {
+                return t <= start ? 0 : static_cast<Tick>((t - start) / resolution);
+            }
+            Tick TickCeil(clock::time_point t) const {
+                return t <= start ? 0 : static_cast<Tick>((t - start + resolution - clock::duration(1)) / resolution);
+            }
+            clock::time_point TickTime(Tick t) const {
+                return start + resolution * static_cast<clock::duration::rep>(t);
+            }
+
+            void Cancel(Wheel::Handle h) {
+                util::maybe<Work> cancelled;
+                std::unique_lock<std::mutex> guard(lock);
+                wheel.Cancel(h, cancelled);
+                guard.unlock();
+                // the work is destroyed here, outside the lock
+            }
+        };
+
+        static void Run(std::shared_ptr<State> state) {
+            std::unique_lock<std::mutex> guard(state->lock);
+            while (!state->stopping) {
+                state->wheel.Advance(state->TickFloor(clock::now()), [&](Work&& work){
+                    state->ready.push_back(std::move(work));
+                });
+                if (state->ready.empty()) {
+                    Tick next = 0;
+                    if (state->wheel.NextExpiration(next)) {
+                        state->sleepingUntil = next;
+                        state->wake.wait_until(guard, state->TickTime(next));
+                    } else {
+                        state->sleepingUntil = State::Forever();
+                        state->wake.wait(guard);
+                    }
+                    state->sleepingUntil = State::Awake();
+                    continue;
+                }
+
+                util::maybe<Work> work;
+                work.set(std::move(state->ready.front()));
+                state->ready.pop_front();
+                auto owner = state->owner.lock();
+
+                guard.unlock();
+                {
+                    RXCPP_UNWIND_AUTO([&]{
+                        // destroy the work before taking the lock again
+                        work.reset();
+                        owner.reset();
+                        guard.lock();
+                    });
+                    if (owner) {
+                        Do(*work, owner);
+                    }
+                }
+            }
+        }
+
+        std::shared_ptr<State> state;
+        std::thread worker;
+
+    public:
+        explicit TimerWheelScheduler(clock::duration resolution = std::chrono::milliseconds(1))
+            : state(std::make_shared<State>(resolution))
+        {
+            auto s = state;
+            worker = std::thread([s](){
+                Run(s);
+            });
+        }
+        virtual ~TimerWheelScheduler()
+        {
+            {
+                std::unique_lock<std::mutex> guard(state->lock);
+                state->stopping = true;
+                state->wake.notify_all();
+            }
+            if (worker.get_id() == std::this_thread::get_id()) {
+                // the last reference was released by work on the timer thread
+                worker.detach();
+            } else if (worker.joinable()) {
+                worker.join();
+            }
+        }
+
+        // the number of timers and due work that have not run
+        size_t Pending() const {
+            std::unique_lock<std::mutex> guard(state->lock);
+            return state->wheel.Size() + state->ready.size();
+        }
+
+        using LocalScheduler::Schedule;
+        virtual Disposable Schedule(clock::time_point dueTime, Work work)
+        {
+            auto expiry = state->TickCeil(dueTime);
+
+            std::unique_lock<std::mutex> guard(state->lock);
+            if (state->stopping) {
+                return Disposable::Empty();
+            }
+            if (state->owner.expired()) {
+                state->owner = shared_from_this();
+            }
+            if (expiry <= state->wheel.Now()) {
+                state->ready.push_back(work);
+                if (state->sleepingUntil != State::Awake()) {
+                    state->wake.notify_one();
+                }
+                // work is disposable
+                return work;
+            }
+            auto handle = state->wheel.Insert(expiry, work);
+            if (expiry < state->sleepingUntil) {
+                // the thread is waiting for a later timer
+                state->wake.notify_one();
+            }
+
+            std::weak_ptr<State> weak = state;
+            return Disposable([weak, handle, work](){
+                work.Dispose();
+                auto s = weak.lock();
+                if (s) {
+                    s->Cancel(handle);
+                }
+            });
+        }
+    };
+
     template<class Absolute, class Relative>
     class VirtualTimeScheduler : public VirtualTimeSchedulerBase<Absolute, Relative>
     {
@@ -0,0 +1,94 @@
+#include "cpprx/rx.hpp"
+namespace rx=rxcpp;
+
+#include "catch.hpp"
+
+namespace {
+
+// blocks until Count() has been called n times
+class Countdown
+{
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining;
+public:
+    explicit Countdown(int n)
+        : remaining(n)
+    {
+    }
+    void Count() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+    void Wait() {
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [this](){return remaining <= 0;});
+    }
+};
+
+}
+
+// same workloads as the v2 "thread_pool test" scenario, for comparison
+SCENARIO("EventLoopScheduler test", "[hide][EventLoopScheduler][schedulers][perf]"){
+    GIVEN("an EventLoopScheduler"){
+        WHEN("scheduling many short actions"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int actions = 1000000;
+            const int hops = 100000;
+
+            auto scheduler = std::make_shared<rx::EventLoopScheduler>();
+
+            {
+                Countdown finished(actions);
+                auto start = clock::now();
+                for (int i = 0; i < actions; i++) {
+                    scheduler->Schedule([&finished](rx::Scheduler::shared) -> rx::Disposable {
+                        finished.Count();
+                        return rx::Disposable::Empty();
+                    });
+                }
+                finished.Wait();
+                auto finish = clock::now();
+                auto msElapsed = duration_cast<milliseconds>(finish - start);
+                std::cout << "EventLoopScheduler posted from outside : " << actions << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+
+            {
+                Countdown finished(actions);
+                auto start = clock::now();
+                scheduler->Schedule([&finished, actions](rx::Scheduler::shared self) -> rx::Disposable {
+                    for (int i = 0; i < actions; i++) {
+                        self->Schedule([&finished](rx::Scheduler::shared) -> rx::Disposable {
+                            finished.Count();
+                            return rx::Disposable::Empty();
+                        });
+                    }
+                    return rx::Disposable::Empty();
+                });
+                finished.Wait();
+                auto finish = clock::now();
+                auto msElapsed = duration_cast<milliseconds>(finish - start);
+                std::cout << "EventLoopScheduler posted from worker  : " << actions << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+
+            {
+                clock::duration latency(0);
+                for (int i = 0; i < hops; i++) {
+                    Countdown finished(1);
+                    auto posted = clock::now();
+                    scheduler->Schedule([&](rx::Scheduler::shared) -> rx::Disposable {
+                        latency += clock::now() - posted;
+                        finished.Count();
+                        return rx::Disposable::Empty();
+                    });
+                    finished.Wait();
+                }
+                std::cout << "EventLoopScheduler post latency       : " << hops << " hops, " << duration_cast<nanoseconds>(latency).count() / hops << "ns average " << std::endl;
+            }
+        }
+    }
+}
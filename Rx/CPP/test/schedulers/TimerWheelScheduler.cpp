@@ -0,0 +1,126 @@
+#include "cpprx/rx.hpp"
+namespace rx=rxcpp;
+
+#include "catch.hpp"
+
+namespace {
+
+// blocks until Count() has been called n times
+class Countdown
+{
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining;
+public:
+    explicit Countdown(int n)
+        : remaining(n)
+    {
+    }
+    void Count() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+    bool Wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return done.wait_for(guard, timeout, [this](){return remaining <= 0;});
+    }
+};
+
+}
+
+// same workload as the v2 "timer_wheel test" scenario, for comparison
+SCENARIO("TimerWheelScheduler test", "[hide][TimerWheelScheduler][schedulers][perf]"){
+    GIVEN("schedulers with many pending timers"){
+        WHEN("scheduling and cancelling timeouts"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int timers = 1000000;
+
+            auto measure = [&](const char* name, rx::Scheduler::shared scheduler) {
+                std::vector<rx::Disposable> timeouts;
+                timeouts.reserve(timers);
+                auto start = clock::now();
+                for (int i = 0; i < timers; i++) {
+                    // spread over ten minutes, like per request timeouts
+                    timeouts.push_back(scheduler->Schedule(milliseconds(60000 + (i * 7919LL) % 540000), [](rx::Scheduler::shared) -> rx::Disposable {
+                        return rx::Disposable::Empty();
+                    }));
+                }
+                auto scheduled = clock::now();
+                for (auto& d : timeouts) {
+                    d.Dispose();
+                }
+                auto cancelled = clock::now();
+                std::cout << name << " schedule : " << timers << " timers, " << duration_cast<milliseconds>(scheduled - start).count() << "ms elapsed " << std::endl;
+                std::cout << name << " cancel   : " << timers << " timers, " << duration_cast<milliseconds>(cancelled - scheduled).count() << "ms elapsed " << std::endl;
+            };
+
+            measure("TimerWheelScheduler", std::make_shared<rx::TimerWheelScheduler>());
+            measure("EventLoopScheduler ", std::make_shared<rx::EventLoopScheduler>());
+        }
+    }
+}
+
+SCENARIO("TimerWheelScheduler timed work", "[TimerWheelScheduler][schedulers]"){
+    GIVEN("a TimerWheelScheduler"){
+        auto scheduler = std::make_shared<rx::TimerWheelScheduler>();
+        typedef rx::Scheduler::clock clock;
+
+        WHEN("work is scheduled for later"){
+            Countdown finished(3);
+            std::mutex lock;
+            std::vector<int> order;
+            int late = 0;
+            auto start = scheduler->Now();
+            auto record = [&](int i, clock::time_point due){
+                return [&, i, due](rx::Scheduler::shared) -> rx::Disposable {
+                    std::unique_lock<std::mutex> guard(lock);
+                    order.push_back(i);
+                    if (clock::now() >= due) {
+                        ++late;
+                    }
+                    finished.Count();
+                    return rx::Disposable::Empty();
+                };
+            };
+            // 150ms is past the first level of the wheel
+            scheduler->Schedule(start + std::chrono::milliseconds(150), record(3, start + std::chrono::milliseconds(150)));
+            scheduler->Schedule(start + std::chrono::milliseconds(20), record(1, start + std::chrono::milliseconds(20)));
+            scheduler->Schedule(start + std::chrono::milliseconds(40), record(2, start + std::chrono::milliseconds(40)));
+
+            THEN("it runs in due order and not early"){
+                REQUIRE(finished.Wait());
+                std::unique_lock<std::mutex> guard(lock);
+                REQUIRE(order.size() == 3);
+                REQUIRE(order[0] == 1);
+                REQUIRE(order[1] == 2);
+                REQUIRE(order[2] == 3);
+                REQUIRE(late == 3);
+            }
+        }
+
+        WHEN("timers are disposed before they are due"){
+            const int timers = 10000;
+            auto payload = std::make_shared<int>(0);
+            std::weak_ptr<int> watch = payload;
+            std::vector<rx::Disposable> timeouts;
+            for (int i = 0; i < timers; i++) {
+                timeouts.push_back(scheduler->Schedule(std::chrono::seconds(60 + i), [payload](rx::Scheduler::shared) -> rx::Disposable {
+                    return rx::Disposable::Empty();
+                }));
+            }
+            payload.reset();
+            REQUIRE(scheduler->Pending() == timers);
+            for (auto& d : timeouts) {
+                d.Dispose();
+            }
+            THEN("they are removed and their work destroyed at once"){
+                REQUIRE(scheduler->Pending() == 0);
+                REQUIRE(watch.expired());
+            }
+        }
+    }
+}
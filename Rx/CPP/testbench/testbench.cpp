@@ -5,14 +5,13 @@
 
 #include "cpprx/rx.hpp"
 #include "cpplinq/linq.hpp"
+#include "cpplinq/linq_file.hpp"
 
 #include <iostream>
 #include <sstream>
-#include <fstream>
 #include <iomanip>
 #include <string>
 #include <exception>
-#include <regex>
 
 using namespace std;
 
@@ -580,21 +579,11 @@ bool IsPrime(int x)
     return true;
 }
 
-regex key_value_pair("'([^\']*)'\\s*[:,]\\s*(\\d+(?:\\.\\d+)?|'[^']*')");
-
+// a quoted value is returned without its quotes. a missing key throws
+// logic_error.
 string extract_value(const string& input, const string& key)
 {
-    const std::sregex_iterator end;
-    for (std::sregex_iterator i(input.cbegin(), input.cend(), key_value_pair);
-        i != end;
-        ++i)
-    {
-        if ((*i)[1] == key)
-        {
-            return (*i)[2];
-        }
-    }
-    throw std::range_error("search key not found");
+    return cpplinq::key_value(input, key).str();
 }
 
 std::shared_ptr<rxcpp::Observable<string>> Data(
@@ -609,13 +598,10 @@ std::shared_ptr<rxcpp::Observable<string>> Data(
             struct State 
             {
                 State(string filename) 
-                    : cancel(false), data(filename) {
-                        if (data.fail()) {
-                            throw logic_error("could not find file");
-                        }
+                    : cancel(false), lines(cpplinq::from_lines(filename).get_cursor()) {
                     }
                 bool cancel;
-                ifstream data;
+                cpplinq::linq_records::cursor lines;
             };
             auto state = std::make_shared<State>(std::move(filename));
 
@@ -631,9 +617,10 @@ std::shared_ptr<rxcpp::Observable<string>> Data(
                     if (state->cancel)
                         return rxcpp::Disposable::Empty();
 
-                    string line;
-                    if (!!getline(state->data, line))
+                    if (!state->lines.empty())
                     {
+                        string line = state->lines.get().str();
+                        state->lines.inc();
                         observer->OnNext(std::move(line));
                         return s->Schedule(std::move(self));
                     }
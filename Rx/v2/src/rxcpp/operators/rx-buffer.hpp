@@ -0,0 +1,424 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_OPERATORS_RX_BUFFER_HPP)
+#define RXCPP_OPERATORS_RX_BUFFER_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace operators {
+
+// vectors for the buffer operators to fill. an observer that is done
+// with a buffer passes it to recycle() and the next buffer reuses its
+// storage. copies share the same vectors.
+// a default constructed pool keeps nothing, each buffer is a new vector.
+template<class T>
+class buffer_pool
+{
+public:
+    typedef std::vector<T> buffer_type;
+
+private:
+    struct state_type
+    {
+        explicit state_type(std::size_t m)
+            : max_pooled(m)
+        {
+        }
+        std::mutex lock;
+        std::vector<buffer_type> free;
+        std::size_t max_pooled;
+    };
+    std::shared_ptr<state_type> state;
+
+public:
+    buffer_pool()
+    {
+    }
+    // keeps at most max_pooled vectors
+    explicit buffer_pool(std::size_t max_pooled)
+        : state(std::make_shared<state_type>(max_pooled))
+    {
+    }
+
+    // an empty vector with room for at least capacity values
+    buffer_type acquire(std::size_t capacity) const {
+        buffer_type result;
+        if (state) {
+            std::unique_lock<std::mutex> guard(state->lock);
+            if (!state->free.empty()) {
+                result = std::move(state->free.back());
+                state->free.pop_back();
+            }
+        }
+        result.reserve(capacity);
+        return result;
+    }
+
+    void recycle(buffer_type b) const {
+        if (!state) {
+            return;
+        }
+        b.clear();
+        std::unique_lock<std::mutex> guard(state->lock);
+        if (state->free.size() < state->max_pooled) {
+            state->free.push_back(std::move(b));
+        }
+    }
+
+    // the number of vectors waiting to be reused
+    std::size_t size() const {
+        if (!state) {
+            return 0;
+        }
+        std::unique_lock<std::mutex> guard(state->lock);
+        return state->free.size();
+    }
+};
+
+namespace detail {
+
+// a buffer with no room for values would never be sent, and a skip of
+// zero would never open the next buffer
+inline std::size_t positive_buffer_arg(std::size_t n, const char* message) {
+    if (n == 0) {
+        throw std::invalid_argument(message);
+    }
+    return n;
+}
+
+// a value that does not close a buffer gives its unit of credit back,
+// so the credit of the observer is spent on buffers.
+template<class T, class Observable>
+struct buffer_count
+    : public operator_base<std::vector<T>>
+{
+    typedef typename std::decay<Observable>::type source_type;
+
+    struct values
+    {
+        values(source_type o, std::size_t c, std::size_t s, buffer_pool<T> p)
+            : source(std::move(o))
+            , count(positive_buffer_arg(c, "buffer count must be greater than zero"))
+            , skip(positive_buffer_arg(s, "buffer skip must be greater than zero"))
+            , pool(std::move(p))
+        {
+        }
+        source_type source;
+        std::size_t count;
+        std::size_t skip;
+        buffer_pool<T> pool;
+    };
+    values initial;
+
+    buffer_count(source_type o, std::size_t count, std::size_t skip, buffer_pool<T> pool)
+        : initial(std::move(o), count, skip, std::move(pool))
+    {
+    }
+
+    template<class Subscriber>
+    void on_subscribe(Subscriber o) {
+
+        typedef Subscriber output_type;
+        struct state_type
+            : public std::enable_shared_from_this<state_type>
+            , public values
+        {
+            state_type(values i, output_type oarg)
+                : values(std::move(i))
+                , index(0)
+                , out(std::move(oarg))
+            {
+            }
+            // the buffers that are open, oldest first. a new buffer opens
+            // every skip values and closes after count values.
+            std::deque<std::vector<T>> chunks;
+            std::size_t index;
+            output_type out;
+        };
+        // take a copy of the values for each subscription
+        auto state = std::shared_ptr<state_type>(new state_type(initial, std::move(o)));
+
+        state->source.subscribe(
+            state->out,
+        // on_next
+            [state](T t) {
+                if (state->index == 0) {
+                    state->chunks.push_back(state->pool.acquire(state->count));
+                }
+                if (++state->index == state->skip) {
+                    state->index = 0;
+                }
+                if (state->chunks.empty()) {
+                    // between buffers when skip > count
+                    state->out.get_resumption().request(1);
+                    return;
+                }
+                auto last = state->chunks.end() - 1;
+                for (auto it = state->chunks.begin(); it != last; ++it) {
+                    it->push_back(t);
+                }
+                last->push_back(std::move(t));
+                if (state->chunks.front().size() != state->count) {
+                    state->out.get_resumption().request(1);
+                    return;
+                }
+                auto full = std::move(state->chunks.front());
+                state->chunks.pop_front();
+                state->out.on_next(std::move(full));
+            },
+        // on_error
+            [state](std::exception_ptr e) {
+                state->chunks.clear();
+                state->out.on_error(e);
+            },
+        // on_completed
+            [state]() {
+                // the open buffers are sent even though they are not full
+                while (!state->chunks.empty() && state->out.is_subscribed()) {
+                    auto partial = std::move(state->chunks.front());
+                    state->chunks.pop_front();
+                    state->out.on_next(std::move(partial));
+                }
+                state->out.on_completed();
+            }
+        );
+    }
+};
+
+// each buffer closes period after it opened, or once it holds count
+// values. the next buffer opens when the last one closes. a buffer
+// closed by the scheduler is sent even when it is empty.
+// a value that does not close a buffer gives its unit of credit back,
+// the buffers closed by the scheduler do not wait for credit.
+template<class T, class Observable>
+struct buffer_with_time
+    : public operator_base<std::vector<T>>
+{
+    typedef typename std::decay<Observable>::type source_type;
+    typedef rxsc::scheduler::clock_type clock_type;
+
+    struct values
+    {
+        values(source_type o, clock_type::duration p, std::size_t c, rxsc::scheduler s, buffer_pool<T> pl)
+            : source(std::move(o))
+            , period(p)
+            , count(positive_buffer_arg(c, "buffer count must be greater than zero"))
+            , sc(std::move(s))
+            , pool(std::move(pl))
+        {
+        }
+        source_type source;
+        clock_type::duration period;
+        std::size_t count;
+        rxsc::scheduler sc;
+        buffer_pool<T> pool;
+    };
+    values initial;
+
+    buffer_with_time(source_type o, clock_type::duration period, std::size_t count, rxsc::scheduler sc, buffer_pool<T> pool)
+        : initial(std::move(o), period, count, std::move(sc), std::move(pool))
+    {
+    }
+
+    template<class Subscriber>
+    void on_subscribe(Subscriber o) {
+
+        typedef Subscriber output_type;
+        struct state_type
+            : public std::enable_shared_from_this<state_type>
+            , public values
+        {
+            state_type(values i, output_type oarg)
+                : values(std::move(i))
+                , window(0)
+                , reserve(0)
+                , out(std::move(oarg))
+            {
+            }
+
+            // calls are serialized by lock
+            //
+            void open(clock_type::time_point start) {
+                ++window;
+                reserve = std::min(this->count, reserve);
+                chunk = this->pool.acquire(reserve);
+                auto state = this->shared_from_this();
+                auto expected = window;
+                auto end = start + this->period;
+                // the timer of each buffer is cancelled when the buffer closes
+                timer = composite_subscription();
+                timerToken = out.add(timer);
+                rxsc::schedule(this->sc, end, timer, [state, expected, end](const rxsc::schedulable&){
+                    std::unique_lock<std::mutex> guard(state->lock);
+                    if (state->window != expected || !state->out.is_subscribed()) {
+                        // this buffer was closed by count, or the source finished
+                        return;
+                    }
+                    state->close();
+                    // the next window starts at the end of this one, so a
+                    // late timer does not make the windows drift
+                    state->open(end);
+                });
+            }
+            void close() {
+                // the next buffer reserves room for as many values as the largest one held
+                reserve = std::max(reserve, chunk.size());
+                out.remove(timerToken);
+                timer.unsubscribe();
+                out.on_next(std::move(chunk));
+            }
+
+            std::mutex lock;
+            std::vector<T> chunk;
+            // numbers the buffers, a timer only closes the buffer it was scheduled for
+            std::uint64_t window;
+            std::size_t reserve;
+            composite_subscription timer;
+            composite_subscription::weak_subscription timerToken;
+            output_type out;
+        };
+        // take a copy of the values for each subscription
+        auto state = std::shared_ptr<state_type>(new state_type(initial, std::move(o)));
+
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            state->open(state->sc.now());
+        }
+
+        state->source.subscribe(
+            state->out,
+        // on_next
+            [state](T t) {
+                std::unique_lock<std::mutex> guard(state->lock);
+                state->chunk.push_back(std::move(t));
+                if (state->chunk.size() < state->count) {
+                    state->out.get_resumption().request(1);
+                    return;
+                }
+                state->close();
+                state->open(state->sc.now());
+            },
+        // on_error
+            [state](std::exception_ptr e) {
+                std::unique_lock<std::mutex> guard(state->lock);
+                state->chunk.clear();
+                state->out.on_error(e);
+            },
+        // on_completed
+            [state]() {
+                std::unique_lock<std::mutex> guard(state->lock);
+                if (!state->chunk.empty()) {
+                    state->close();
+                }
+                state->out.on_completed();
+            }
+        );
+    }
+};
+
+// the factories take the pool of the value type of the source
+struct no_buffer_pool {};
+
+template<class T>
+buffer_pool<T> pool_for(no_buffer_pool) {
+    return buffer_pool<T>();
+}
+template<class T>
+buffer_pool<T> pool_for(buffer_pool<T> p) {
+    return p;
+}
+
+template<class Pool>
+class buffer_count_factory
+{
+    std::size_t count;
+    std::size_t skip;
+    Pool pool;
+public:
+    buffer_count_factory(std::size_t c, std::size_t s, Pool p)
+        : count(positive_buffer_arg(c, "buffer count must be greater than zero"))
+        , skip(positive_buffer_arg(s, "buffer skip must be greater than zero"))
+        , pool(std::move(p))
+    {
+    }
+    template<class Observable>
+    auto operator()(Observable&& source)
+        ->      observable<std::vector<typename std::decay<Observable>::type::value_type>,  buffer_count<typename std::decay<Observable>::type::value_type, Observable>> {
+        return  observable<std::vector<typename std::decay<Observable>::type::value_type>,  buffer_count<typename std::decay<Observable>::type::value_type, Observable>>(
+                                                                                            buffer_count<typename std::decay<Observable>::type::value_type, Observable>(std::forward<Observable>(source), count, skip, pool_for<typename std::decay<Observable>::type::value_type>(pool)));
+    }
+};
+
+template<class Pool>
+class buffer_with_time_factory
+{
+    rxsc::scheduler::clock_type::duration period;
+    std::size_t count;
+    rxsc::scheduler sc;
+    Pool pool;
+public:
+    buffer_with_time_factory(rxsc::scheduler::clock_type::duration p, std::size_t c, rxsc::scheduler s, Pool pl)
+        : period(p)
+        , count(positive_buffer_arg(c, "buffer count must be greater than zero"))
+        , sc(std::move(s))
+        , pool(std::move(pl))
+    {
+    }
+    template<class Observable>
+    auto operator()(Observable&& source)
+        ->      observable<std::vector<typename std::decay<Observable>::type::value_type>,  buffer_with_time<typename std::decay<Observable>::type::value_type, Observable>> {
+        return  observable<std::vector<typename std::decay<Observable>::type::value_type>,  buffer_with_time<typename std::decay<Observable>::type::value_type, Observable>>(
+                                                                                            buffer_with_time<typename std::decay<Observable>::type::value_type, Observable>(std::forward<Observable>(source), period, count, sc, pool_for<typename std::decay<Observable>::type::value_type>(pool)));
+    }
+};
+
+}
+
+inline auto buffer(std::size_t count)
+    ->      detail::buffer_count_factory<detail::no_buffer_pool> {
+    return  detail::buffer_count_factory<detail::no_buffer_pool>(count, count, detail::no_buffer_pool());
+}
+inline auto buffer(std::size_t count, std::size_t skip)
+    ->      detail::buffer_count_factory<detail::no_buffer_pool> {
+    return  detail::buffer_count_factory<detail::no_buffer_pool>(count, skip, detail::no_buffer_pool());
+}
+template<class T>
+auto buffer(std::size_t count, buffer_pool<T> pool)
+    ->      detail::buffer_count_factory<buffer_pool<T>> {
+    return  detail::buffer_count_factory<buffer_pool<T>>(count, count, std::move(pool));
+}
+template<class T>
+auto buffer(std::size_t count, std::size_t skip, buffer_pool<T> pool)
+    ->      detail::buffer_count_factory<buffer_pool<T>> {
+    return  detail::buffer_count_factory<buffer_pool<T>>(count, skip, std::move(pool));
+}
+
+inline auto buffer_with_time(rxsc::scheduler::clock_type::duration period, rxsc::scheduler sc)
+    ->      detail::buffer_with_time_factory<detail::no_buffer_pool> {
+    return  detail::buffer_with_time_factory<detail::no_buffer_pool>(period, std::numeric_limits<std::size_t>::max(), std::move(sc), detail::no_buffer_pool());
+}
+template<class T>
+auto buffer_with_time(rxsc::scheduler::clock_type::duration period, rxsc::scheduler sc, buffer_pool<T> pool)
+    ->      detail::buffer_with_time_factory<buffer_pool<T>> {
+    return  detail::buffer_with_time_factory<buffer_pool<T>>(period, std::numeric_limits<std::size_t>::max(), std::move(sc), std::move(pool));
+}
+
+inline auto buffer_with_time_or_count(rxsc::scheduler::clock_type::duration period, std::size_t count, rxsc::scheduler sc)
+    ->      detail::buffer_with_time_factory<detail::no_buffer_pool> {
+    return  detail::buffer_with_time_factory<detail::no_buffer_pool>(period, count, std::move(sc), detail::no_buffer_pool());
+}
+template<class T>
+auto buffer_with_time_or_count(rxsc::scheduler::clock_type::duration period, std::size_t count, rxsc::scheduler sc, buffer_pool<T> pool)
+    ->      detail::buffer_with_time_factory<buffer_pool<T>> {
+    return  detail::buffer_with_time_factory<buffer_pool<T>>(period, count, std::move(sc), std::move(pool));
+}
+
+}
+
+}
+
+#endif
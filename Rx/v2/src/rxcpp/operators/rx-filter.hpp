@@ -13,50 +13,34 @@ namespace operators {
 
 namespace detail {
 
-template<class T, class Observable, class Predicate>
-struct filter : public operator_base<T>
+// the filter step of a fused operator. values that fail the test are dropped
+template<class T, class Predicate>
+struct filter_stage
 {
-    typedef typename std::decay<Observable>::type source_type;
+    typedef T source_value_type;
+    typedef T value_type;
     typedef typename std::decay<Predicate>::type test_type;
-    source_type source;
-    test_type test;
 
     template<class CT, class CP>
     static auto check(int) -> decltype((*(CP*)nullptr)(*(CT*)nullptr));
     template<class CT, class CP>
     static void check(...);
-    filter(source_type o, test_type p)
-        : source(std::move(o))
-        , test(std::move(p))
+
+    static_assert(std::is_convertible<decltype(check<T, test_type>(0)), bool>::value, "filter Predicate must be a function with the signature bool(T)");
+
+    explicit filter_stage(test_type p)
+        : test(std::move(p))
     {
-        static_assert(std::is_convertible<decltype(check<T, test_type>(0)), bool>::value, "filter Predicate must be a function with the signature bool(T)");
     }
-    template<class Subscriber>
-    void on_subscribe(Subscriber o) {
-        source.subscribe(
-            o,
-        // on_next
-            [this, o](T t) {
-                bool filtered = false;
-                try {
-                   filtered = !this->test(t);
-                } catch(...) {
-                    o.on_error(std::current_exception());
-                    return;
-                }
-                if (!filtered) {
-                    o.on_next(std::move(t));
-                }
-            },
-        // on_error
-            [o](std::exception_ptr e) {
-                o.on_error(e);
-            },
-        // on_completed
-            [o]() {
-                o.on_completed();
-            }
-        );
+    test_type test;
+
+    template<class V, class Sink>
+    void on_next(V&& v, Sink& sink) {
+        if (test(v)) {
+            sink.next(std::forward<V>(v));
+        } else {
+            sink.drop();
+        }
     }
 };
 
@@ -69,9 +53,8 @@ public:
     filter_factory(test_type p) : predicate(std::move(p)) {}
     template<class Observable>
     auto operator()(Observable&& source)
-        ->      observable<typename std::decay<Observable>::type::value_type,   filter<typename std::decay<Observable>::type::value_type, Observable, Predicate>> {
-        return  observable<typename std::decay<Observable>::type::value_type,   filter<typename std::decay<Observable>::type::value_type, Observable, Predicate>>(
-                                                                                filter<typename std::decay<Observable>::type::value_type, Observable, Predicate>(std::forward<Observable>(source), std::move(predicate)));
+        -> decltype(source.filter(std::move(*(test_type*)nullptr))) {
+        return      source.filter(std::move(predicate));
     }
 };
 
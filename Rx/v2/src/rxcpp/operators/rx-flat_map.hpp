@@ -64,20 +64,23 @@ struct flat_map
 
     struct values
     {
-        values(source_type o, collection_selector_type s, result_selector_type rs)
+        values(source_type o, collection_selector_type s, result_selector_type rs, int mc)
             : source(std::move(o))
             , selectCollection(std::move(s))
             , selectResult(std::move(rs))
+            , maxConcurrent(mc)
         {
         }
         source_type source;
         collection_selector_type selectCollection;
         result_selector_type selectResult;
+        // 0 or less means no limit
+        int maxConcurrent;
     };
     values initial;
 
-    flat_map(source_type o, collection_selector_type s, result_selector_type rs)
-        : initial(std::move(o), std::move(s), std::move(rs))
+    flat_map(source_type o, collection_selector_type s, result_selector_type rs, int maxConcurrent = 0)
+        : initial(std::move(o), std::move(s), std::move(rs), maxConcurrent)
     {
     }
 
@@ -87,6 +90,13 @@ struct flat_map
 
         typedef typename std::decay<Observer>::type output_type;
 
+        struct emission_type
+        {
+            // neither value nor error means on_completed
+            util::detail::maybe<typename this_type::value_type> value;
+            std::exception_ptr error;
+        };
+
         struct state_type
             : public std::enable_shared_from_this<state_type>
             , public values
@@ -94,17 +104,155 @@ struct flat_map
             state_type(values i, output_type oarg)
                 : values(std::move(i))
                 , pendingCompletions(0)
+                , emitting(0)
+                , active(0)
+                , outer(this->maxConcurrent > 0 ? regulator(this->maxConcurrent) : regulator())
                 , out(std::move(oarg))
             {
             }
+
+            // calls to the output must be serialized because multiple
+            // sources are subscribed to by flat_map. the thread that finds
+            // emitting at 0 calls the output directly and then drains
+            // whatever other threads queued meanwhile. the other threads
+            // only push to the queue and return, so a slow output does not
+            // block any producer.
+            void emit(emission_type e) {
+                int expected = 0;
+                if (emitting.compare_exchange_strong(expected, 1)) {
+                    deliver(e);
+                    drain(1);
+                } else {
+                    queue.push(std::move(e));
+                    if (emitting.fetch_add(1) == 0) {
+                        drain(0);
+                    }
+                }
+            }
+            void drain(int done) {
+                util::detail::maybe<emission_type> next;
+                for (;;) {
+                    auto remaining = emitting.fetch_sub(done) - done;
+                    if (remaining == 0) {
+                        return;
+                    }
+                    for (done = 0; done < remaining;) {
+                        if (!queue.pop(next)) {
+                            // a push has been counted but is not linked yet
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        deliver(*next);
+                        next.reset();
+                        ++done;
+                    }
+                }
+            }
+            void deliver(emission_type& e) {
+                if (!out.is_subscribed()) {
+                    return;
+                }
+                if (!e.value.empty()) {
+                    out.on_next(std::move(*e.value));
+                } else if (e.error) {
+                    out.on_error(e.error);
+                } else {
+                    out.on_completed();
+                }
+            }
+            void on_next(typename this_type::value_type v) {
+                emission_type e;
+                e.value.reset(std::move(v));
+                emit(std::move(e));
+            }
+            void on_error(std::exception_ptr ex) {
+                emission_type e;
+                e.error = ex;
+                emit(std::move(e));
+            }
+            void on_completed() {
+                if (--pendingCompletions == 0) {
+                    emit(emission_type());
+                }
+            }
+
+            void subscribe_inner(source_value_type st, collection_type selectedCollection) {
+                auto state = this->shared_from_this();
+
+                // every value of the inner subscription reads the same outer
+                // value. it is kept once, copies of the on_next only share it
+                auto outerValue = std::make_shared<const source_value_type>(std::move(st));
+
+                composite_subscription innercs;
+
+                // when the out observer is unsubscribed all the
+                // inner subscriptions are unsubscribed as well
+                auto innercstoken = out.add(innercs);
+
+                innercs.add(make_subscription([state, innercstoken](){
+                    state->out.remove(innercstoken);
+                }));
+
+                // this subscribe does not share the source subscription
+                // so that when it is unsubscribed the source will continue
+                selectedCollection.subscribe(
+                    out,
+                    innercs,
+                // on_next
+                    [state, outerValue](collection_value_type ct) {
+                        util::detail::maybe<typename this_type::value_type> selectedResult;
+                        try {
+                            selectedResult.reset(state->selectResult(*outerValue, std::move(ct)));
+                        } catch(...) {
+                            state->on_error(std::current_exception());
+                            return;
+                        }
+                        state->on_next(std::move(*selectedResult));
+                    },
+                // on_error
+                    [state](std::exception_ptr e) {
+                        state->on_error(e);
+                    },
+                //on_completed
+                    [state](){
+                        state->inner_completed();
+                        state->on_completed();
+                    }
+                );
+            }
+            void inner_completed() {
+                if (this->maxConcurrent <= 0) {
+                    return;
+                }
+                std::unique_lock<std::mutex> guard(lock);
+                if (waiting.empty()) {
+                    --active;
+                    guard.unlock();
+                    // a slot is free, let the source send another collection
+                    outer.request(1);
+                    return;
+                }
+                auto next = std::move(waiting.front());
+                waiting.pop_front();
+                guard.unlock();
+                subscribe_inner(std::move(next.first), std::move(next.second));
+            }
+
             // on_completed on the output must wait until all the
             // subscriptions have received on_completed
             std::atomic<int> pendingCompletions;
-            // because multiple sources are subscribed to by flat_map,
-            // calls to the output must be serialized by lock.
-            // the on_error/on_complete and unsubscribe calls can
-            // cause lock recursion.
-            std::recursive_mutex lock;
+            std::atomic<int> emitting;
+            util::detail::mpsc_queue<emission_type> queue;
+            // when maxConcurrent is set, selected collections beyond
+            // the limit wait here until an active one completes
+            std::mutex lock;
+            int active;
+            std::deque<std::pair<source_value_type, collection_type>> waiting;
+            // the source is regulated separately from the inner
+            // subscriptions, which share the credit of the output.
+            // when maxConcurrent is set the source only gets credit
+            // for the free slots.
+            regulator outer;
             output_type out;
         };
         // take a copy of the values for each subscription
@@ -123,71 +271,35 @@ struct flat_map
         state->source.subscribe(
             state->out,
             outercs,
+            state->outer.get_resumption(),
         // on_next
             [state](source_value_type st) {
                 util::detail::maybe<collection_type> selectedCollection;
                 try {
                     selectedCollection.reset(state->selectCollection(st));
                 } catch(...) {
-                    std::unique_lock<std::recursive_mutex> guard(state->lock);
-                    state->out.on_error(std::current_exception());
+                    state->on_error(std::current_exception());
                     return;
                 }
 
-                composite_subscription innercs;
-
-                // when the out observer is unsubscribed all the
-                // inner subscriptions are unsubscribed as well
-                auto innercstoken = state->out.add(innercs);
-
-                innercs.add(make_subscription([state, innercstoken](){
-                    state->out.remove(innercstoken);
-                }));
-
                 ++state->pendingCompletions;
-                // this subscribe does not share the source subscription
-                // so that when it is unsubscribed the source will continue
-                selectedCollection->subscribe(
-                    state->out,
-                    innercs,
-                // on_next
-                    [state, st](collection_value_type ct) {
-                        util::detail::maybe<typename this_type::value_type> selectedResult;
-                        try {
-                            selectedResult.reset(state->selectResult(st, std::move(ct)));
-                        } catch(...) {
-                            std::unique_lock<std::recursive_mutex> guard(state->lock);
-                            state->out.on_error(std::current_exception());
-                            return;
-                        }
-                        std::unique_lock<std::recursive_mutex> guard(state->lock);
-                        state->out.on_next(std::move(*selectedResult));
-                    },
-                // on_error
-                    [state](std::exception_ptr e) {
-                        std::unique_lock<std::recursive_mutex> guard(state->lock);
-                        state->out.on_error(e);
-                    },
-                //on_completed
-                    [state](){
-                        if (--state->pendingCompletions == 0) {
-                            std::unique_lock<std::recursive_mutex> guard(state->lock);
-                            state->out.on_completed();
-                        }
+                if (state->maxConcurrent > 0) {
+                    std::unique_lock<std::mutex> guard(state->lock);
+                    if (state->active >= state->maxConcurrent) {
+                        state->waiting.push_back(std::make_pair(std::move(st), std::move(*selectedCollection)));
+                        return;
                     }
-                );
+                    ++state->active;
+                }
+                state->subscribe_inner(std::move(st), std::move(*selectedCollection));
             },
         // on_error
             [state](std::exception_ptr e) {
-                std::unique_lock<std::recursive_mutex> guard(state->lock);
-                state->out.on_error(e);
+                state->on_error(e);
             },
         // on_completed
             [state]() {
-                if (--state->pendingCompletions == 0) {
-                    std::unique_lock<std::recursive_mutex> guard(state->lock);
-                    state->out.on_completed();
-                }
+                state->on_completed();
             }
         );
     }
@@ -201,10 +313,12 @@ class flat_map_factory
 
     collection_selector_type selectorCollection;
     result_selector_type selectorResult;
+    int maxConcurrent;
 public:
-    flat_map_factory(collection_selector_type s, result_selector_type rs)
-        : selectorCollection(std::move(rs))
-        , selectorResult(std::move(s))
+    flat_map_factory(collection_selector_type s, result_selector_type rs, int mc)
+        : selectorCollection(std::move(s))
+        , selectorResult(std::move(rs))
+        , maxConcurrent(mc)
     {
     }
 
@@ -212,7 +326,7 @@ public:
     auto operator()(Observable&& source)
         ->      observable<typename flat_map<Observable, CollectionSelector, ResultSelector>::value_type, flat_map<Observable, CollectionSelector, ResultSelector>> {
         return  observable<typename flat_map<Observable, CollectionSelector, ResultSelector>::value_type, flat_map<Observable, CollectionSelector, ResultSelector>>(
-                                    flat_map<Observable, CollectionSelector, ResultSelector>(std::forward<Observable>(source), std::move(selectorCollection), std::move(selectorResult)));
+                                    flat_map<Observable, CollectionSelector, ResultSelector>(std::forward<Observable>(source), std::move(selectorCollection), std::move(selectorResult), maxConcurrent));
     }
 };
 
@@ -221,7 +335,13 @@ public:
 template<class CollectionSelector, class ResultSelector>
 auto flat_map(CollectionSelector&& s, ResultSelector&& rs)
     ->      detail::flat_map_factory<CollectionSelector, ResultSelector> {
-    return  detail::flat_map_factory<CollectionSelector, ResultSelector>(std::forward<CollectionSelector>(s), std::forward<ResultSelector>(rs));
+    return  detail::flat_map_factory<CollectionSelector, ResultSelector>(std::forward<CollectionSelector>(s), std::forward<ResultSelector>(rs), 0);
+}
+
+template<class CollectionSelector, class ResultSelector>
+auto flat_map(CollectionSelector&& s, ResultSelector&& rs, int max_concurrent)
+    ->      detail::flat_map_factory<CollectionSelector, ResultSelector> {
+    return  detail::flat_map_factory<CollectionSelector, ResultSelector>(std::forward<CollectionSelector>(s), std::forward<ResultSelector>(rs), max_concurrent);
 }
 
 }
@@ -0,0 +1,252 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_OPERATORS_RX_FUSE_HPP)
+#define RXCPP_OPERATORS_RX_FUSE_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace operators {
+
+namespace detail {
+
+// a stage is one step of a fused operator, such as map_stage or
+// filter_stage. on_next(v, sink) passes the result for v to
+// sink.next() or, when v is dropped, calls sink.drop().
+// stages call user functions and never call the subscriber.
+// values are forwarded, so an rvalue from the source is moved
+// along the chain and an lvalue is only read until a stage has to
+// keep it.
+
+// two stages in sequence, inner first
+template<class Inner, class Outer>
+struct compose_stage
+{
+    typedef typename Inner::source_value_type source_value_type;
+    typedef typename Outer::value_type value_type;
+
+    compose_stage(Inner i, Outer o)
+        : inner(std::move(i))
+        , outer(std::move(o))
+    {
+    }
+    Inner inner;
+    Outer outer;
+
+    template<class Sink>
+    struct inner_sink
+    {
+        Outer* outer;
+        Sink* sink;
+        template<class V>
+        void next(V&& v) {
+            outer->on_next(std::forward<V>(v), *sink);
+        }
+        void drop() {
+            sink->drop();
+        }
+    };
+
+    template<class V, class Sink>
+    void on_next(V&& v, Sink& sink) {
+        inner_sink<Sink> next = {&outer, &sink};
+        inner.on_next(std::forward<V>(v), next);
+    }
+};
+
+// runs all the stages of a chain of maps and filters on each value from
+// the source, with one state per subscription, one subscriber between
+// the source and the output and one try/catch around the user functions.
+template<class Observable, class Stage>
+struct fused
+    : public operator_base<typename Stage::value_type>
+{
+    typedef typename std::decay<Observable>::type source_type;
+    typedef Stage stage_type;
+    typedef typename Stage::source_value_type source_value_type;
+    typedef typename Stage::value_type value_type;
+
+    struct values
+    {
+        values(source_type o, stage_type s)
+            : source(std::move(o))
+            , stage(std::move(s))
+        {
+        }
+        source_type source;
+        stage_type stage;
+    };
+    values initial;
+
+    fused(source_type o, stage_type s)
+        : initial(std::move(o), std::move(s))
+    {
+    }
+
+    // keeps the value that reaches the end of the stages
+    struct result_sink
+    {
+        util::detail::maybe<value_type> result;
+        template<class V>
+        void next(V&& v) {
+            result.reset(std::forward<V>(v));
+        }
+        void drop() {
+        }
+    };
+
+    // runs the stages for one value and sends the result to the output.
+    // returns false when a stage dropped the value.
+    template<class State, class V>
+    static bool deliver(State& state, V&& st) {
+        result_sink selected;
+        try {
+            state.stage.on_next(std::forward<V>(st), selected);
+        } catch(...) {
+            state.out.on_error(std::current_exception());
+            return true;
+        }
+        if (selected.result.empty()) {
+            return false;
+        }
+        state.out.on_next(std::move(*selected.result));
+        return true;
+    }
+
+    // the on_next of the source. a lambda would have to take the value
+    // by value, which copies every lvalue the source sends. only values
+    // of the source type are accepted, so make_subscriber does not take
+    // this for an on_error.
+    template<class State>
+    struct next_from_source
+    {
+        explicit next_from_source(std::shared_ptr<State> s)
+            : state(std::move(s))
+        {
+        }
+        std::shared_ptr<State> state;
+        template<class V>
+        typename std::enable_if<std::is_same<typename std::decay<V>::type, source_value_type>::value>::type
+        operator()(V&& st) const {
+            if (!deliver(*state, std::forward<V>(st))) {
+                // the dropped value used a unit of credit, ask for a replacement
+                state->out.get_resumption().request(1);
+            }
+        }
+    };
+
+    // the next of a range or iterate source. the source gives back the
+    // credit of dropped values itself.
+    template<class State>
+    struct next_from_loop
+    {
+        explicit next_from_loop(std::shared_ptr<State> s)
+            : state(std::move(s))
+        {
+        }
+        std::shared_ptr<State> state;
+        template<class Subscriber>
+        bool operator()(const Subscriber&, const source_value_type& st) const {
+            return deliver(*state, st);
+        }
+    };
+
+    // an observable source is subscribed. a range or iterate source is
+    // not, it runs the stages inside its own loop.
+    template<class State>
+    static void subscribe_source(const std::shared_ptr<State>& state, tag_observable) {
+        state->source.subscribe(
+            state->out,
+        // on_next
+            next_from_source<State>(state),
+        // on_error
+            [state](std::exception_ptr e) {
+                state->out.on_error(e);
+            },
+        // on_completed
+            [state]() {
+                state->out.on_completed();
+            }
+        );
+    }
+    template<class State>
+    static void subscribe_source(const std::shared_ptr<State>& state, rxs::tag_source) {
+        state->source.emit(state->out, next_from_loop<State>(state));
+    }
+
+    template<class Subscriber>
+    void on_subscribe(Subscriber o) {
+
+        typedef Subscriber output_type;
+        struct state_type
+            : public std::enable_shared_from_this<state_type>
+            , public values
+        {
+            state_type(values i, output_type oarg)
+                : values(std::move(i))
+                , out(std::move(oarg))
+            {
+            }
+            output_type out;
+        };
+        // take a copy of the values for each subscription
+        auto state = std::shared_ptr<state_type>(new state_type(initial, std::move(o)));
+
+        subscribe_source(state, typename std::conditional<is_observable<source_type>::value, tag_observable, rxs::tag_source>::type());
+    }
+};
+
+// the observable for Stage applied to the values of Observable. when
+// Observable is already fused the stage is added to its chain instead.
+template<class Observable, class SourceOperator, class Stage>
+struct fuse_stage
+{
+    typedef fused<Observable, Stage> operator_type;
+    typedef observable<typename operator_type::value_type, operator_type> type;
+
+    static type make(const Observable& source, const SourceOperator&, Stage s) {
+        return type(operator_type(source, std::move(s)));
+    }
+};
+// the values of a range or iterate source are sent straight into the stages
+template<class Observable, class T, class Stage>
+struct fuse_stage<Observable, rxs::detail::range<T>, Stage>
+{
+    typedef fused<rxs::detail::range<T>, Stage> operator_type;
+    typedef observable<typename operator_type::value_type, operator_type> type;
+
+    static type make(const Observable&, const rxs::detail::range<T>& so, Stage s) {
+        return type(operator_type(so, std::move(s)));
+    }
+};
+template<class Observable, class Collection, class Stage>
+struct fuse_stage<Observable, rxs::detail::iterate<Collection>, Stage>
+{
+    typedef fused<rxs::detail::iterate<Collection>, Stage> operator_type;
+    typedef observable<typename operator_type::value_type, operator_type> type;
+
+    static type make(const Observable&, const rxs::detail::iterate<Collection>& so, Stage s) {
+        return type(operator_type(so, std::move(s)));
+    }
+};
+template<class Observable, class Source, class Inner, class Stage>
+struct fuse_stage<Observable, fused<Source, Inner>, Stage>
+{
+    typedef fused<Source, compose_stage<Inner, Stage>> operator_type;
+    typedef observable<typename operator_type::value_type, operator_type> type;
+
+    static type make(const Observable&, const fused<Source, Inner>& so, Stage s) {
+        return type(operator_type(so.initial.source, compose_stage<Inner, Stage>(so.initial.stage, std::move(s))));
+    }
+};
+
+}
+
+}
+
+}
+
+#endif
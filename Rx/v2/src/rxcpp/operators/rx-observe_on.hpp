@@ -0,0 +1,294 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_OPERATORS_RX_OBSERVE_ON_HPP)
+#define RXCPP_OPERATORS_RX_OBSERVE_ON_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace operators {
+
+// what observe_on does with a value that arrives while its queue is full
+struct overflow_policy
+{
+    enum type {
+        // the source waits for room. the scheduler must not run the
+        // observer on the thread of the source or they deadlock.
+        block,
+        // the oldest queued value is dropped
+        drop_oldest,
+        // the new value is dropped
+        drop_newest,
+        // the source is unsubscribed and the observer receives
+        // std::overflow_error after the values already queued
+        error
+    };
+};
+
+namespace detail {
+
+template<class T, class Observable>
+struct observe_on
+    : public operator_base<T>
+{
+    typedef typename std::decay<Observable>::type source_type;
+
+    struct values
+    {
+        values(source_type o, rxsc::scheduler s, std::size_t c, overflow_policy::type p)
+            : source(std::move(o))
+            , sc(std::move(s))
+            , capacity(c)
+            , policy(p)
+        {
+        }
+        source_type source;
+        rxsc::scheduler sc;
+        std::size_t capacity;
+        overflow_policy::type policy;
+    };
+    values initial;
+
+    observe_on(source_type o, rxsc::scheduler sc, std::size_t capacity, overflow_policy::type policy)
+        : initial(std::move(o), std::move(sc), capacity, policy)
+    {
+    }
+
+    template<class Subscriber>
+    void on_subscribe(Subscriber o) {
+
+        typedef Subscriber output_type;
+        struct state_type
+            : public std::enable_shared_from_this<state_type>
+            , public values
+        {
+            state_type(values i, output_type oarg)
+                : values(std::move(i))
+                , queue(this->capacity)
+                , wip(0)
+                , done(false)
+                , blocked(0)
+                , out(std::move(oarg))
+            {
+            }
+
+            // source side, calls are serialized by the source
+            //
+            void on_next(T t) {
+                if (done.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                if (!queue.try_push(std::move(t))) {
+                    switch (this->policy) {
+                    case overflow_policy::block:
+                        if (!push_blocking(t)) {
+                            return;
+                        }
+                        break;
+                    case overflow_policy::drop_oldest:
+                        {
+                            util::detail::maybe<T> oldest;
+                            while (!queue.try_push(std::move(t))) {
+                                queue.try_pop(oldest);
+                                oldest.reset();
+                            }
+                            // the dropped value used a unit of credit
+                            out.get_resumption().request(1);
+                        }
+                        break;
+                    case overflow_policy::drop_newest:
+                        out.get_resumption().request(1);
+                        return;
+                    case overflow_policy::error:
+                        error = std::make_exception_ptr(std::overflow_error("observe_on queue is full"));
+                        done = true;
+                        sourceLifetime.unsubscribe();
+                        break;
+                    default:
+                        abort();
+                    }
+                }
+                signal();
+            }
+            void on_error(std::exception_ptr e) {
+                error = e;
+                done = true;
+                signal();
+            }
+            void on_completed() {
+                done = true;
+                signal();
+            }
+
+            bool push_blocking(T& t) {
+                // the observer usually makes room soon, try that before sleeping
+                for (int spin = 0; spin < 16; ++spin) {
+                    std::this_thread::yield();
+                    if (queue.try_push(std::move(t))) {
+                        return true;
+                    }
+                }
+                std::unique_lock<std::mutex> guard(lock);
+                ++blocked;
+                wake.wait(guard, [&](){
+                    return queue.try_push(std::move(t)) || !out.is_subscribed();
+                });
+                --blocked;
+                return out.is_subscribed();
+            }
+
+            // observer side
+            //
+            void signal() {
+                if (wip.fetch_add(1) == 0) {
+                    auto state = this->shared_from_this();
+                    rxsc::schedule(this->sc, out.get_subscription(), [state](const rxsc::schedulable& self){
+                        state->drain(self);
+                    });
+                }
+            }
+
+            // one drain runs at a time. wip counts the signals that
+            // arrived since the drain started, a drain only stops once
+            // it has seen all of them.
+            void drain(const rxsc::schedulable& self) {
+                auto missed = wip.load();
+                util::detail::maybe<T> next;
+                for (;;) {
+                    for (std::size_t delivered = 0;; ++delivered) {
+                        if (!out.is_subscribed()) {
+                            return;
+                        }
+                        if (delivered == queue.capacity()) {
+                            // let other work on the scheduler run
+                            self();
+                            return;
+                        }
+                        // done is read first so that an empty queue
+                        // after it is set means nothing more will arrive
+                        auto finished = done.load();
+                        if (!queue.try_pop(next)) {
+                            if (finished) {
+                                if (error) {
+                                    out.on_error(error);
+                                } else {
+                                    out.on_completed();
+                                }
+                                return;
+                            }
+                            break;
+                        }
+                        release_blocked();
+                        out.on_next(std::move(*next));
+                        next.reset();
+                    }
+                    missed = wip.fetch_sub(missed) - missed;
+                    if (missed == 0) {
+                        return;
+                    }
+                }
+            }
+
+            void release_blocked() {
+                if (this->policy != overflow_policy::block) {
+                    return;
+                }
+                // pairs with the increment of blocked before the
+                // blocked producer tries the queue again
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (blocked.load() != 0) {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.notify_all();
+                }
+            }
+
+            util::detail::bounded_queue<T> queue;
+            std::atomic<int> wip;
+            std::atomic<bool> done;
+            // written before done is set
+            std::exception_ptr error;
+
+            std::mutex lock;
+            std::condition_variable wake;
+            std::atomic<int> blocked;
+
+            composite_subscription sourceLifetime;
+            output_type out;
+        };
+        // take a copy of the values for each subscription
+        auto state = std::shared_ptr<state_type>(new state_type(initial, std::move(o)));
+
+        // this subscribe does not share the observer subscription
+        // so that on_completed from the source does not unsubscribe
+        // the observer before the queue is delivered
+        auto sourcecstoken = state->out.add(state->sourceLifetime);
+        state->sourceLifetime.add(make_subscription([state, sourcecstoken](){
+            state->out.remove(sourcecstoken);
+        }));
+
+        // a producer blocked on a full queue must wake when the observer unsubscribes
+        std::weak_ptr<state_type> weak = state;
+        state->out.add(make_subscription([weak](){
+            auto s = weak.lock();
+            if (s) {
+                std::unique_lock<std::mutex> guard(s->lock);
+                s->wake.notify_all();
+            }
+        }));
+
+        state->source.subscribe(
+            state->out,
+            state->sourceLifetime,
+        // on_next
+            [state](T t) {
+                state->on_next(std::move(t));
+            },
+        // on_error
+            [state](std::exception_ptr e) {
+                state->on_error(e);
+            },
+        // on_completed
+            [state]() {
+                state->on_completed();
+            }
+        );
+    }
+};
+
+class observe_on_factory
+{
+    rxsc::scheduler sc;
+    std::size_t capacity;
+    overflow_policy::type policy;
+public:
+    static const std::size_t default_capacity = 1024;
+
+    observe_on_factory(rxsc::scheduler s, std::size_t c, overflow_policy::type p)
+        : sc(std::move(s))
+        , capacity(c)
+        , policy(p)
+    {
+    }
+    template<class Observable>
+    auto operator()(Observable&& source)
+        ->      observable<typename std::decay<Observable>::type::value_type,   observe_on<typename std::decay<Observable>::type::value_type, Observable>> {
+        return  observable<typename std::decay<Observable>::type::value_type,   observe_on<typename std::decay<Observable>::type::value_type, Observable>>(
+                                                                                observe_on<typename std::decay<Observable>::type::value_type, Observable>(std::forward<Observable>(source), sc, capacity, policy));
+    }
+};
+
+}
+
+inline auto observe_on(rxsc::scheduler sc, std::size_t capacity = detail::observe_on_factory::default_capacity, overflow_policy::type policy = overflow_policy::block)
+    ->      detail::observe_on_factory {
+    return  detail::observe_on_factory(std::move(sc), capacity, policy);
+}
+
+}
+
+}
+
+#endif
@@ -74,12 +74,15 @@
 #include <stdlib.h>
 
 #include <cstddef>
+#include <cstdint>
 
 #include <iostream>
 #include <iomanip>
 
 #include <exception>
+#include <stdexcept>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <algorithm>
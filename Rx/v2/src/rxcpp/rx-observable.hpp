@@ -105,7 +105,7 @@ public:
             make_observer_dynamic<T>(
             // on_next
                 [so](T t){
-                    so->on_next(t);
+                    so->on_next(std::move(t));
                 },
             // on_error
                 [so](std::exception_ptr e){
@@ -241,22 +241,24 @@ public:
 
     /// filter (AKA Where) ->
     /// for each item from this observable use Predicate to select which items to emit from the new observable that is returned.
+    /// a chain of filter and map calls is fused into one operator.
     ///
     template<class Predicate>
     auto filter(Predicate&& p) const
-        ->      observable<T,   rxo::detail::filter<T, observable, Predicate>> {
-        return  observable<T,   rxo::detail::filter<T, observable, Predicate>>(
-                                rxo::detail::filter<T, observable, Predicate>(*this, std::forward<Predicate>(p)));
+        -> typename rxo::detail::fuse_stage<this_type, source_operator_type, rxo::detail::filter_stage<T, Predicate>>::type {
+        return      rxo::detail::fuse_stage<this_type, source_operator_type, rxo::detail::filter_stage<T, Predicate>>::make(
+                                                                                                                        *this, source_operator, rxo::detail::filter_stage<T, Predicate>(std::forward<Predicate>(p)));
     }
 
     /// map (AKA Select) ->
     /// for each item from this observable use Selector to produce an item to emit from the new observable that is returned.
+    /// a chain of map and filter calls is fused into one operator.
     ///
     template<class Selector>
     auto map(Selector&& s) const
-        ->      observable<typename rxo::detail::map<observable, Selector>::value_type, rxo::detail::map<observable, Selector>> {
-        return  observable<typename rxo::detail::map<observable, Selector>::value_type, rxo::detail::map<observable, Selector>>(
-                                                                                        rxo::detail::map<observable, Selector>(*this, std::forward<Selector>(s)));
+        -> typename rxo::detail::fuse_stage<this_type, source_operator_type, rxo::detail::map_stage<T, Selector>>::type {
+        return      rxo::detail::fuse_stage<this_type, source_operator_type, rxo::detail::map_stage<T, Selector>>::make(
+                                                                                                                        *this, source_operator, rxo::detail::map_stage<T, Selector>(std::forward<Selector>(s)));
     }
 
     /// flat_map (AKA SelectMany) ->
@@ -270,6 +272,64 @@ public:
                                                                                                                         rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>(*this, std::forward<CollectionSelector>(s), std::forward<ResultSelector>(rs)));
     }
 
+    /// flat_map (AKA SelectMany) ->
+    /// same as flat_map(s, rs), but at most max_concurrent of the selected observables are subscribed at once.
+    /// selected observables beyond that wait until an active one completes.
+    ///
+    template<class CollectionSelector, class ResultSelector>
+    auto flat_map(CollectionSelector&& s, ResultSelector&& rs, int max_concurrent) const
+        ->      observable<typename rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>::value_type,  rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>> {
+        return  observable<typename rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>::value_type,  rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>>(
+                                                                                                                        rxo::detail::flat_map<observable, CollectionSelector, ResultSelector>(*this, std::forward<CollectionSelector>(s), std::forward<ResultSelector>(rs), max_concurrent));
+    }
+
+    /// observe_on ->
+    /// delivers the notifications of this observable on the scheduler. at most capacity
+    /// values wait between the source and the observer, policy decides what happens to more.
+    ///
+    auto observe_on(rxsc::scheduler sc, std::size_t capacity = rxo::detail::observe_on_factory::default_capacity, rxo::overflow_policy::type policy = rxo::overflow_policy::block) const
+        ->      observable<T,   rxo::detail::observe_on<T, observable>> {
+        return  observable<T,   rxo::detail::observe_on<T, observable>>(
+                                rxo::detail::observe_on<T, observable>(*this, std::move(sc), capacity, policy));
+    }
+
+    /// buffer ->
+    /// collects the items from this observable into vectors of count items and emits each vector from the new observable that is returned.
+    /// a new vector is started every skip items, so vectors overlap when skip < count and items are left out when skip > count.
+    /// the vectors that are not full when this observable completes are emitted before on_completed.
+    /// count and skip must be greater than zero, std::invalid_argument is thrown otherwise. the vectors are taken from pool when one is provided.
+    ///
+    auto buffer(std::size_t count, rxo::buffer_pool<T> pool = rxo::buffer_pool<T>()) const
+        ->      observable<std::vector<T>,  rxo::detail::buffer_count<T, observable>> {
+        return  observable<std::vector<T>,  rxo::detail::buffer_count<T, observable>>(
+                                            rxo::detail::buffer_count<T, observable>(*this, count, count, std::move(pool)));
+    }
+    auto buffer(std::size_t count, std::size_t skip, rxo::buffer_pool<T> pool = rxo::buffer_pool<T>()) const
+        ->      observable<std::vector<T>,  rxo::detail::buffer_count<T, observable>> {
+        return  observable<std::vector<T>,  rxo::detail::buffer_count<T, observable>>(
+                                            rxo::detail::buffer_count<T, observable>(*this, count, skip, std::move(pool)));
+    }
+
+    /// buffer_with_time ->
+    /// collects the items from this observable into a vector for each period and emits each vector from the new observable that is returned.
+    /// the periods are timed on the scheduler, a vector is emitted at the end of its period even when it is empty.
+    ///
+    auto buffer_with_time(rxsc::scheduler::clock_type::duration period, rxsc::scheduler sc, rxo::buffer_pool<T> pool = rxo::buffer_pool<T>()) const
+        ->      observable<std::vector<T>,  rxo::detail::buffer_with_time<T, observable>> {
+        return  observable<std::vector<T>,  rxo::detail::buffer_with_time<T, observable>>(
+                                            rxo::detail::buffer_with_time<T, observable>(*this, period, std::numeric_limits<std::size_t>::max(), std::move(sc), std::move(pool)));
+    }
+
+    /// buffer_with_time_or_count ->
+    /// same as buffer_with_time, but a vector is also emitted once it holds count items. the next period starts when it is emitted.
+/// count must be greater than zero, std::invalid_argument is thrown otherwise.
+    ///
+    auto buffer_with_time_or_count(rxsc::scheduler::clock_type::duration period, std::size_t count, rxsc::scheduler sc, rxo::buffer_pool<T> pool = rxo::buffer_pool<T>()) const
+        ->      observable<std::vector<T>,  rxo::detail::buffer_with_time<T, observable>> {
+        return  observable<std::vector<T>,  rxo::detail::buffer_with_time<T, observable>>(
+                                            rxo::detail::buffer_with_time<T, observable>(*this, period, count, std::move(sc), std::move(pool)));
+    }
+
     ///
     /// takes any function that will take this observable and produce a result value.
     /// this is intended to allow externally defined operators to be connected into the expression.
@@ -296,6 +356,16 @@ public:
         return  observable<T,   rxs::detail::range<T>>(
                                 rxs::detail::range<T>(start, count, step, sc));
     }
+    template<class Collection>
+    static auto iterate(Collection c, rxsc::scheduler sc = rxsc::make_current_thread())
+        -> decltype(rxs::iterate(std::move(c), std::move(sc))) {
+        return      rxs::iterate(std::move(c), std::move(sc));
+    }
+    template<class Iterator>
+    static auto from(Iterator b, Iterator e, rxsc::scheduler sc = rxsc::make_current_thread())
+        -> decltype(rxs::from(std::move(b), std::move(e), std::move(sc))) {
+        return      rxs::from(std::move(b), std::move(e), std::move(sc));
+    }
 };
 
 }
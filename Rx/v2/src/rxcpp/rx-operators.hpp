@@ -35,8 +35,11 @@ namespace rxo=operators;
 }
 
 #include "operators/rx-subscribe.hpp"
+#include "operators/rx-fuse.hpp"
 #include "operators/rx-filter.hpp"
 #include "operators/rx-map.hpp"
 #include "operators/rx-flat_map.hpp"
+#include "operators/rx-observe_on.hpp"
+#include "operators/rx-buffer.hpp"
 
 #endif
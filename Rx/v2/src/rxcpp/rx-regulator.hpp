@@ -27,73 +27,246 @@ public:
 
 namespace detail {
 
+//
+// credit based flow control.
+// the consumer grants credit with request(n). the source takes one unit
+// of credit before each on_next. a source that finds no credit passes
+// the schedulable that continues it to resume_with and returns. that
+// schedulable is scheduled again when more credit is requested.
+//
 struct regulator_state_type
-	: public std::enable_shared_from_this<regulator_state_type>
+    : public std::enable_shared_from_this<regulator_state_type>
 {
-	regulator_state_type()
-		: isresumed(true)
-	{
-	}
-	rxsc::schedulable resumewith;
-	bool isresumed;
+    static std::uint64_t unbounded() {
+        return (std::numeric_limits<std::uint64_t>::max)();
+    }
+
+    explicit regulator_state_type(std::uint64_t initial = unbounded())
+        : credit(initial)
+        , abandoned(false)
+    {
+    }
+    virtual ~regulator_state_type()
+    {
+    }
+
+    // source side
+    //
+    virtual bool is_resumed() {
+        return credit.load() != 0;
+    }
+    virtual bool try_consume() {
+        auto c = credit.load();
+        for (;;) {
+            if (c == 0) {
+                return false;
+            }
+            if (c == unbounded()) {
+                return true;
+            }
+            if (credit.compare_exchange_weak(c, c - 1)) {
+                return true;
+            }
+        }
+    }
+    virtual void resume_with(rxsc::schedulable rw) {
+        // a parked source that is unsubscribed is dropped at once, the
+        // hook only holds a weak ref so the waiting list is not a cycle
+        std::weak_ptr<regulator_state_type> weak = shared_from_this();
+        auto hook = rw.add(make_subscription([weak](){
+            auto s = weak.lock();
+            if (s) {
+                s->purge();
+            }
+        }));
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (abandoned) {
+                // nothing can request more, the source is dropped
+                guard.unlock();
+                rw.remove(hook);
+                return;
+            }
+            // request adds credit before it takes the lock, so a request
+            // that raced with the caller's try_consume is seen here
+            if (!is_resumed()) {
+                waiting.push_back(waiter_type(std::move(rw), hook));
+                return;
+            }
+        }
+        rw.remove(hook);
+        rw.schedule();
+    }
+
+    // consumer side
+    //
+    virtual void request(std::uint64_t n) {
+        auto c = credit.load();
+        for (;;) {
+            if (c == unbounded()) {
+                break;
+            }
+            auto next = n >= unbounded() - c ? unbounded() : c + n;
+            if (credit.compare_exchange_weak(c, next)) {
+                break;
+            }
+        }
+        wake();
+    }
+    void pause() {
+        credit = 0;
+    }
+    void resume() {
+        credit = unbounded();
+        wake();
+    }
+
+    // called when the consumer is gone. the parked sources can never be
+    // resumed, dropping them breaks the cycle through their subscribers.
+    void abandon() {
+        std::vector<waiter_type> removed;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            abandoned = true;
+            removed.swap(waiting);
+        }
+        for (auto& w : removed) {
+            w.what.remove(w.hook);
+        }
+    }
+
+protected:
+    struct waiter_type
+    {
+        waiter_type(rxsc::schedulable w, composite_subscription::weak_subscription h)
+            : what(std::move(w))
+            , hook(h)
+        {
+        }
+        rxsc::schedulable what;
+        composite_subscription::weak_subscription hook;
+    };
+
+    // schedules every parked source, they each take credit again when they run
+    void wake() {
+        std::vector<waiter_type> ready;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.swap(waiting);
+        }
+        for (auto& w : ready) {
+            w.what.remove(w.hook);
+            if (w.what.is_subscribed()) {
+                w.what.schedule();
+            }
+        }
+    }
+
+    void purge() {
+        std::vector<waiter_type> removed;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            auto split = std::partition(waiting.begin(), waiting.end(),
+                [](const waiter_type& w){
+                    return w.what.is_subscribed();
+                });
+            std::move(split, waiting.end(), std::back_inserter(removed));
+            waiting.erase(split, waiting.end());
+        }
+        // destroyed outside the lock
+    }
+
+    std::atomic<std::uint64_t> credit;
+    std::mutex lock;
+    // must only be accessed under lock
+    bool abandoned;
+    std::vector<waiter_type> waiting;
 };
 typedef std::shared_ptr<regulator_state_type> regulator_state;
 
 }
 
 //
-// passed to subscribe to control the source
-// the source must call is_resumed before each onnext
-// the source must call resume_with when is_resumed returns false
-// the schedulable passed to resume_with must implement a resumption policy;
-// forward(undoes drop), unblock(undoes block), subscribe(undoes unsubscribe),
-// drain(undoes buffer)
+// passed to subscribe to control the source.
+// the source must call try_consume before each on_next.
+// when try_consume returns false the source must stop and pass the
+// schedulable that continues it to resume_with.
+// an operator that drops a value calls request(1) so that the source
+// sends a replacement.
+// a default constructed resumption never runs out of credit.
 //
 class resumption : public resumption_base
 {
-	detail::regulator_state state;
+    detail::regulator_state state;
 public:
-	resumption(){}
-	explicit resumption(detail::regulator_state st)
-		: state(st)
-	{
-	}
-	inline bool is_resumed() const {
-		return state ? state->isresumed : true;
-	}
-	inline void resume_with(rxsc::schedulable rw) {
-		// invalid to call when state is null.
-		state->resumewith = rw;
-	}
+    resumption(){}
+    explicit resumption(detail::regulator_state st)
+        : state(std::move(st))
+    {
+    }
+    inline bool is_resumed() const {
+        return state ? state->is_resumed() : true;
+    }
+    inline bool try_consume() const {
+        return state ? state->try_consume() : true;
+    }
+    inline void resume_with(rxsc::schedulable rw) const {
+        if (!state) {
+            rw.schedule();
+            return;
+        }
+        state->resume_with(std::move(rw));
+    }
+    inline void request(std::uint64_t n) const {
+        if (state) {
+            state->request(n);
+        }
+    }
 };
 
 //
-// owned by observer. the
-// observer calls pause to stop the source. The
-// observer calls resume when ready for the
-// source to send more data.
+// owned by the consumer. the consumer calls request(n)
+// to allow the source to send n more values, pause to
+// stop the source and resume to let it run without limit.
+// a default constructed regulator does not limit the source.
 //
 class regulator
 {
-	detail::regulator_state state;
+    // the resumptions share the state, only the regulators share the owner
+    struct owner_type
+    {
+        explicit owner_type(detail::regulator_state s)
+            : state(std::move(s))
+        {
+        }
+        ~owner_type()
+        {
+            state->abandon();
+        }
+        detail::regulator_state state;
+    };
+    std::shared_ptr<owner_type> owner;
 public:
-	regulator()
-		: state(new detail::regulator_state_type())
-	{
-	}
-	inline void pause() {
-		state->isresumed = false;
-	}
-	inline void resume() {
-		state->isresumed = true;
-        auto resumewith = std::move(state->resumewith);
-        auto local = state->resumewith;
-        state->resumewith = rxsc::schedulable::empty(local.get_scheduler());
-        local.schedule();
-	}
-	inline resumption get_resumption() {
-		return resumption(state);
-	}
+    regulator()
+        : owner(std::make_shared<owner_type>(std::make_shared<detail::regulator_state_type>()))
+    {
+    }
+    explicit regulator(std::uint64_t initial)
+        : owner(std::make_shared<owner_type>(std::make_shared<detail::regulator_state_type>(initial)))
+    {
+    }
+    inline void pause() const {
+        owner->state->pause();
+    }
+    inline void resume() const {
+        owner->state->resume();
+    }
+    inline void request(std::uint64_t n) const {
+        owner->state->request(n);
+    }
+    inline resumption get_resumption() const {
+        return resumption(owner->state);
+    }
 };
 
 }
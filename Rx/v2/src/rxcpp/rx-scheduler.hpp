@@ -237,6 +237,7 @@ class schedulable : public schedulable_base
     class recursed_scope_type
     {
         mutable const recursed* requestor;
+        mutable const recurse* recursor;
 
         class exit_recursed_scope_type
         {
@@ -245,6 +246,7 @@ class schedulable : public schedulable_base
             ~exit_recursed_scope_type()
             {
                     that->requestor = nullptr;
+                    that->recursor = nullptr;
             }
             exit_recursed_scope_type(const recursed_scope_type* that)
                 : that(that)
@@ -254,10 +256,12 @@ class schedulable : public schedulable_base
     public:
         recursed_scope_type()
             : requestor(nullptr)
+            , recursor(nullptr)
         {
         }
         recursed_scope_type(const recursed_scope_type&)
             : requestor(nullptr)
+            , recursor(nullptr)
         {
             // does not aquire recursion scope
         }
@@ -268,11 +272,15 @@ class schedulable : public schedulable_base
         }
         exit_recursed_scope_type reset(const recurse& r) const {
             requestor = std::addressof(r.get_recursed());
+            recursor = std::addressof(r);
             return exit_recursed_scope_type(this);
         }
         void operator()() const {
             (*requestor)();
         }
+        bool is_allowed() const {
+            return recursor && recursor->is_allowed();
+        }
     };
     recursed_scope_type recursed_scope;
 
@@ -324,6 +332,12 @@ public:
     inline void operator()() const {
         recursed_scope();
     }
+    // true while this action is running and nothing else is waiting on
+    // its scheduler, so that a tail recursion would run at once. an
+    // action that loops may keep going while this is true.
+    inline bool is_recursion_allowed() const {
+        return recursed_scope.is_allowed();
+    }
 
     // composite_subscription
     //
@@ -395,7 +409,9 @@ class action_type
     typedef action_type this_type;
 
 public:
-    typedef std::function<void(const schedulable&, const recurse&)> function_type;
+    // sized so that the tail-recursion wrapper around a lambda that
+    // captures a subscriber and a few shared_ptr is stored inline.
+    typedef rxu::detail::small_function<void(const schedulable&, const recurse&), 24 * sizeof(void*)> function_type;
 
 private:
     action_duration::type d;
@@ -403,12 +419,14 @@ private:
 
 public:
     action_type()
+        : d(action_duration::invalid)
     {
     }
 
-    action_type(action_duration::type d, function_type f)
+    template<class F>
+    action_type(action_duration::type d, F&& f)
         : d(d)
-        , f(std::move(f))
+        , f(std::forward<F>(f))
     {
     }
 
@@ -443,26 +461,45 @@ inline action make_action_empty() {
     return action::empty();
 }
 
+namespace detail {
+
+template<class F>
+struct action_tailrecurser
+{
+    typedef typename std::decay<F>::type function_type;
+
+    explicit action_tailrecurser(function_type fn)
+        : f(std::move(fn))
+    {
+    }
+
+    // tail-recurse inside of the virtual function call
+    // until a new action, lifetime or scheduler is returned
+    inline void operator()(const schedulable& s, const recurse& r) {
+        auto scope = s.set_recursed(r);
+        while (s.is_subscribed()) {
+            r.reset();
+            f(s);
+            if (!r.is_allowed() || !r.is_requested()) {
+                if (r.is_requested()) {
+                    s.schedule();
+                }
+                break;
+            }
+        }
+    }
+
+private:
+    function_type f;
+};
+
+}
+
 template<class F>
 inline action make_action(F&& f, action_duration::type d = action_duration::runs_short) {
-    auto fn = std::forward<F>(f);
     return action(std::make_shared<detail::action_type>(
         d,
-        // tail-recurse inside of the virtual function call
-        // until a new action, lifetime or scheduler is returned
-        [fn](const schedulable& s, const recurse& r) {
-            auto scope = s.set_recursed(r);
-            while (s.is_subscribed()) {
-                r.reset();
-                fn(s);
-                if (!r.is_allowed() || !r.is_requested()) {
-                    if (r.is_requested()) {
-                        s.schedule();
-                    }
-                    break;
-                }
-            }
-        }));
+        detail::action_tailrecurser<F>(std::forward<F>(f))));
 }
 
 namespace detail {
@@ -603,7 +640,7 @@ action select_action(ResolvedArgSet& rs) {
     static_assert(int(ra_t::is_arg) + int(rad_t::is_arg) < 2, "action_duration not allowed with an action");
 }
 
-template<bool when_invalid, class ResolvedArgSet>
+template<bool when_valid, class ResolvedArgSet>
 schedulable make_schedulable_resolved(ResolvedArgSet&& rsArg) {
     const auto rs = std::forward<ResolvedArgSet>(rsArg);
     const auto rsub = std::get<2>(rs);
@@ -617,14 +654,14 @@ schedulable make_schedulable_resolved(ResolvedArgSet&& rsArg) {
     typedef typename std::decay<decltype(std::get<3>(rs))>::type rsc_t;
     typedef typename std::decay<decltype(std::get<1>(rs))>::type rscbl_t;
 
-    static_assert(when_invalid || !rw_t::is_arg, "when is an invalid parameter");
+    static_assert(when_valid || !rw_t::is_arg, "when is an invalid parameter");
     static_assert(rscbl_t::is_arg || rsc_t::is_arg, "at least one of; scheduler or schedulable is required");
 }
 
 template<class ResolvedArgSet>
 schedulable schedule_resolved(ResolvedArgSet&& rsArg) {
     const auto rw = std::get<0>(rsArg);
-    schedulable result = make_schedulable_resolved<false>(std::forward<ResolvedArgSet>(rsArg));
+    schedulable result = make_schedulable_resolved<true>(std::forward<ResolvedArgSet>(rsArg));
     if (rw.is_arg) {
         result.schedule(rw.value);
     } else {
@@ -637,7 +674,7 @@ schedulable schedule_resolved(ResolvedArgSet&& rsArg) {
 
 template<class Arg0, class... ArgN>
 schedulable make_schedulable(Arg0&& a0, ArgN&&... an) {
-    return detail::make_schedulable_resolved<true>(rxu::detail::resolve_arg_set(detail::tag_schedulable_set(), std::forward<Arg0>(a0), std::forward<ArgN>(an)...));
+    return detail::make_schedulable_resolved<false>(rxu::detail::resolve_arg_set(detail::tag_schedulable_set(), std::forward<Arg0>(a0), std::forward<ArgN>(an)...));
 }
 
 template<class Arg0, class... ArgN>
@@ -668,5 +705,7 @@ namespace rxsc=schedulers;
 
 #include "schedulers/rx-currentthread.hpp"
 #include "schedulers/rx-virtualtime.hpp"
+#include "schedulers/rx-threadpool.hpp"
+#include "schedulers/rx-timerwheel.hpp"
 
 #endif
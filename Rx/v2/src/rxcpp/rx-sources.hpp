@@ -30,11 +30,75 @@ public:
     static const bool value = std::is_convertible<decltype(check<typename std::decay<T>::type>(0)), tag_source*>::value;
 };
 
+namespace detail {
+
+// the most values sent in one run of a loop action. the action yields
+// to the scheduler between chunks, and sooner when other work is
+// waiting on the scheduler.
+static const std::uint64_t loop_chunk_size = 1024;
+
+// sends the values of a source that steps through them in a loop.
+// State has a scheduler sc, and
+//   at_end()  - true when there are no more values
+//   current() - the value to send next
+//   advance() - steps to the value after it
+// each value is sent to o through next(o, value), which returns false
+// for a value it dropped. the credit of dropped values is given back
+// once per chunk.
+template<class State, class Subscriber, class Next>
+void emit_loop(std::shared_ptr<State> state, Subscriber o, Next next) {
+    schedule(state->sc, o.get_subscription(), [=](const rxsc::schedulable& self){
+        std::uint64_t dropped = 0;
+        for (std::uint64_t sent = 0;; ++sent) {
+            if (state->at_end()) {
+                o.on_completed();
+                // o is unsubscribed
+            }
+            if (!o.is_subscribed()) {
+                // terminate loop
+                return;
+            }
+
+            if (sent == loop_chunk_size || (sent != 0 && !self.is_recursion_allowed())) {
+                if (dropped != 0) {
+                    o.get_resumption().request(dropped);
+                }
+                // tail recurse this same action to continue loop, other
+                // work waiting on the scheduler runs first
+                self();
+                return;
+            }
+
+            auto credit = o.get_resumption().try_consume();
+            if (!credit && dropped != 0) {
+                // the dropped values give back their credit before the source waits
+                o.get_resumption().request(dropped);
+                dropped = 0;
+                credit = o.get_resumption().try_consume();
+            }
+            if (!credit) {
+                // no credit, continue when more is requested
+                o.resume_with(self);
+                return;
+            }
+
+            // send next value
+            if (!next(o, state->current())) {
+                ++dropped;
+            }
+            state->advance();
+        }
+    });
+}
+
+}
+
 }
 namespace rxs=sources;
 
 }
 
 #include "sources/rx-range.hpp"
+#include "sources/rx-iterate.hpp"
 
 #endif
@@ -79,7 +79,7 @@ public:
     bool is_resumed() const {
         return controller.is_resumed();
     }
-    void resume_with(rxsc::schedulable rw) {
+    void resume_with(rxsc::schedulable rw) const {
         controller.resume_with(std::move(rw));
     }
 
@@ -25,28 +25,40 @@ public:
 
 class dynamic_subscription : public subscription_base
 {
-    typedef std::function<void()> unsubscribe_call_type;
-    unsubscribe_call_type unsubscribe_call;
+    typedef rxu::detail::small_function<void()> unsubscribe_call_type;
+    // small_function is called non-const, unsubscribe() is const.
+    mutable unsubscribe_call_type unsubscribe_call;
+
+    template<class I>
+    struct unsubscriber
+    {
+        explicit unsubscriber(I i)
+            : inner(std::move(i))
+        {
+        }
+        void operator()() const {
+            inner.unsubscribe();
+        }
+        I inner;
+    };
+
     dynamic_subscription()
     {
     }
+    dynamic_subscription(const dynamic_subscription&);
 public:
-    dynamic_subscription(const dynamic_subscription& o)
-        : unsubscribe_call(o.unsubscribe_call)
-    {
-    }
     dynamic_subscription(dynamic_subscription&& o)
         : unsubscribe_call(std::move(o.unsubscribe_call))
     {
     }
     template<class I>
     dynamic_subscription(I i, typename std::enable_if<is_subscription<I>::value && !std::is_same<I, dynamic_subscription>::value, void**>::type selector = nullptr)
-        : unsubscribe_call([i](){
-            i.unsubscribe();})
+        : unsubscribe_call(unsubscriber<I>(std::move(i)))
     {
     }
-    dynamic_subscription(unsubscribe_call_type s)
-        : unsubscribe_call(std::move(s))
+    template<class Unsubscribe>
+    dynamic_subscription(Unsubscribe&& u, typename std::enable_if<!is_subscription<Unsubscribe>::value, void**>::type selector = nullptr)
+        : unsubscribe_call(std::forward<Unsubscribe>(u))
     {
     }
     void unsubscribe() const {
@@ -137,87 +149,284 @@ class composite_subscription : public subscription_base
 {
 public:
     typedef std::shared_ptr<dynamic_subscription> shared_subscription;
-    typedef std::weak_ptr<dynamic_subscription> weak_subscription;
+
+    // returned from add() and accepted by remove().
+    // identifies the slot that holds the child and the generation of
+    // that slot, so remove() is constant time and ignores stale tokens.
+    class weak_subscription
+    {
+        friend class composite_subscription;
+        std::size_t index;
+        std::size_t stamp;
+        weak_subscription(std::size_t i, std::size_t s)
+            : index(i)
+            , stamp(s)
+        {
+        }
+    public:
+        weak_subscription()
+            : index(std::numeric_limits<std::size_t>::max())
+            , stamp(0)
+        {
+        }
+    };
 private:
     struct tag_empty {};
+
+    struct slot_mode
+    {
+        enum type {
+            Free = 0,
+            Occupied,
+            Removing
+        };
+    };
+
+    struct slot_type
+    {
+        slot_type()
+            : state(0)
+            , next_free(0xFFFFFFFF)
+            , shared(nullptr)
+        {
+        }
+        // generation in the high bits, slot_mode in the low two bits
+        std::atomic<std::size_t> state;
+        std::atomic<std::uint32_t> next_free;
+        // the child added as a shared_subscription, if any
+        std::atomic<const dynamic_subscription*> shared;
+        typename std::aligned_storage<sizeof(dynamic_subscription), std::alignment_of<dynamic_subscription>::value>::type
+            storage;
+
+        inline dynamic_subscription* get() {
+            return reinterpret_cast<dynamic_subscription*>(&storage);
+        }
+    };
+
+    // children are stored in slots. the first few slots are inline,
+    // the rest are in chunks that double in size and never move, so
+    // slots are claimed and released without taking a lock.
+    //
+    // the transition out of Occupied is always a compare-exchange,
+    // so each child is either removed or unsubscribed exactly once
+    // even when add, remove and unsubscribe race.
     struct state_t : public std::enable_shared_from_this<state_t>
     {
-        std::vector<shared_subscription> subscriptions;
-        std::recursive_mutex lock;
-        bool issubscribed;
+        static const std::size_t inline_count = 4;
+        static const std::size_t chunk_count = 31;
+        static const std::size_t mode_mask = 3;
+        static const std::size_t generation_step = 4;
+        static const std::uint32_t free_end = 0xFFFFFFFF;
+
+        // the chunk table is only allocated once the inline slots are used up
+        struct chunk_table
+        {
+            chunk_table()
+            {
+                for (auto& c : chunks) {
+                    c.store(nullptr, std::memory_order_relaxed);
+                }
+            }
+            ~chunk_table()
+            {
+                for (auto& c : chunks) {
+                    delete [] c.load();
+                }
+            }
+            std::atomic<slot_type*> chunks[chunk_count];
+        };
+
+        slot_type inline_slots[inline_count];
+        std::atomic<chunk_table*> table;
+        // number of slots ever claimed
+        std::atomic<std::size_t> claimed;
+        // index of the first free slot in the low bits, tag to prevent ABA in the high bits
+        std::atomic<std::uint64_t> free_head;
+        std::atomic<bool> issubscribed;
 
         state_t()
-            : issubscribed(true)
+            : table(nullptr)
+            , claimed(0)
+            , free_head(free_end)
+            , issubscribed(true)
         {
         }
 
         state_t(tag_empty&&)
-            : issubscribed(false)
+            : table(nullptr)
+            , claimed(0)
+            , free_head(free_end)
+            , issubscribed(false)
         {
         }
 
+        ~state_t()
+        {
+            const std::size_t end = claimed;
+            for (std::size_t i = 0; i != end; ++i) {
+                auto slot = slot_at(i, false);
+                if (slot && (slot->state & mode_mask) == slot_mode::Occupied) {
+                    slot->get()->~dynamic_subscription();
+                }
+            }
+            delete table.load();
+        }
+
         inline bool is_subscribed() {
             return issubscribed;
         }
 
-        inline weak_subscription add(dynamic_subscription s) {
-            return add(std::make_shared<dynamic_subscription>(std::move(s)));
+        // a shared child that is already in the set is not added again.
+        // two threads adding the same child at once may both add it.
+        inline weak_subscription add(shared_subscription s) {
+            if (issubscribed) {
+                const std::size_t end = claimed;
+                for (std::size_t i = 0; i != end; ++i) {
+                    auto slot = slot_at(i, false);
+                    if (!slot) {
+                        continue;
+                    }
+                    const std::size_t stamp = slot->state;
+                    if ((stamp & mode_mask) == slot_mode::Occupied && slot->shared == s.get() && slot->state == stamp) {
+                        return weak_subscription(i, stamp);
+                    }
+                }
+            }
+            auto key = s.get();
+            return add(dynamic_subscription([s](){
+                s->unsubscribe();}), key);
         }
 
-        inline weak_subscription add(shared_subscription s) {
-            std::unique_lock<decltype(lock)> guard(lock);
+        inline weak_subscription add(dynamic_subscription s, const dynamic_subscription* key = nullptr) {
+            if (!issubscribed) {
+                s.unsubscribe();
+                return weak_subscription();
+            }
 
+            std::size_t index = 0;
+            auto slot = claim(index);
+            new (slot->get()) dynamic_subscription(std::move(s));
+            slot->shared = key;
+            const std::size_t stamp = (slot->state & ~mode_mask) | slot_mode::Occupied;
+            slot->state = stamp;
+
+            // unsubscribe may have swept past this slot before it was published
             if (!issubscribed) {
-                s->unsubscribe();
-            } else {
-                auto end = std::end(subscriptions);
-                auto it = std::find(std::begin(subscriptions), end, s);
-                if (it == end)
-                {
-                    subscriptions.emplace_back(s);
-                }
+                take(index, slot, stamp, true);
+                return weak_subscription();
             }
-            return s;
+            return weak_subscription(index, stamp);
         }
 
         inline void remove(weak_subscription w) {
-            std::unique_lock<decltype(lock)> guard(lock);
-
-            if (issubscribed) {
-                auto s = w.lock();
-                if (s)
-                {
-                    auto end = std::end(subscriptions);
-                    auto it = std::find(std::begin(subscriptions), end, s);
-                    if (it != end)
-                    {
-                        subscriptions.erase(it);
-                    }
-                }
+            if (w.index >= claimed) {
+                return;
+            }
+            auto slot = slot_at(w.index, false);
+            if (slot) {
+                take(w.index, slot, w.stamp, false);
             }
         }
 
         inline void clear() {
-            std::unique_lock<decltype(lock)> guard(lock);
-
             if (issubscribed) {
-                std::vector<shared_subscription> v(std::move(subscriptions));
-                std::for_each(v.begin(), v.end(),
-                              [](shared_subscription& s) {
-                                s->unsubscribe(); });
+                sweep();
             }
         }
 
         inline void unsubscribe() {
-            std::unique_lock<decltype(lock)> guard(lock);
+            if (issubscribed.exchange(false)) {
+                sweep();
+            }
+        }
 
-            if (issubscribed) {
-                issubscribed = false;
-                std::vector<shared_subscription> v(std::move(subscriptions));
-                std::for_each(v.begin(), v.end(),
-                              [](shared_subscription& s) {
-                                s->unsubscribe(); });
+    private:
+        inline void sweep() {
+            const std::size_t end = claimed;
+            for (std::size_t i = 0; i != end; ++i) {
+                auto slot = slot_at(i, false);
+                if (!slot) {
+                    // chunk not published yet, the add will see !issubscribed
+                    continue;
+                }
+                const std::size_t stamp = slot->state;
+                if ((stamp & mode_mask) == slot_mode::Occupied) {
+                    take(i, slot, stamp, true);
+                }
+            }
+        }
+
+        inline bool take(std::size_t index, slot_type* slot, std::size_t stamp, bool unsubscribe) {
+            std::size_t expected = stamp;
+            if (!slot->state.compare_exchange_strong(expected, (stamp & ~mode_mask) | slot_mode::Removing)) {
+                // already removed or unsubscribed
+                return false;
+            }
+            dynamic_subscription child(std::move(*slot->get()));
+            slot->get()->~dynamic_subscription();
+            slot->shared = nullptr;
+            slot->state = (stamp & ~mode_mask) + generation_step;
+            release(index, slot);
+            if (unsubscribe) {
+                child.unsubscribe();
             }
+            return true;
+        }
+
+        inline slot_type* slot_at(std::size_t index, bool allocate) {
+            if (index < inline_count) {
+                return inline_slots + index;
+            }
+            std::size_t c = 1;
+            for (std::size_t q = index / inline_count; q > 1; q >>= 1) {
+                ++c;
+            }
+            const std::size_t first = inline_count << (c - 1);
+            chunk_table* t = table;
+            if (!t) {
+                if (!allocate) {
+                    return nullptr;
+                }
+                std::unique_ptr<chunk_table> fresh(new chunk_table());
+                if (table.compare_exchange_strong(t, fresh.get())) {
+                    t = fresh.release();
+                }
+            }
+            slot_type* chunk = t->chunks[c];
+            if (!chunk && allocate) {
+                std::unique_ptr<slot_type[]> fresh(new slot_type[first]);
+                if (t->chunks[c].compare_exchange_strong(chunk, fresh.get())) {
+                    chunk = fresh.release();
+                }
+            }
+            return chunk ? chunk + (index - first) : nullptr;
+        }
+
+        inline slot_type* claim(std::size_t& index) {
+            std::uint64_t head = free_head;
+            while (std::uint32_t(head) != free_end) {
+                const std::uint32_t top = std::uint32_t(head);
+                auto slot = slot_at(top, false);
+                const std::uint64_t next = (((head >> 32) + 1) << 32) | slot->next_free;
+                if (free_head.compare_exchange_weak(head, next)) {
+                    index = top;
+                    return slot;
+                }
+            }
+            index = claimed++;
+            if (index >= free_end) {
+                abort();
+            }
+            return slot_at(index, true);
+        }
+
+        inline void release(std::size_t index, slot_type* slot) {
+            std::uint64_t head = free_head;
+            std::uint64_t next = 0;
+            do {
+                slot->next_free = std::uint32_t(head);
+                next = (((head >> 32) + 1) << 32) | index;
+            } while (!free_head.compare_exchange_weak(head, next));
         }
     };
 
@@ -49,7 +49,7 @@ struct test_source
                 make_observer_dynamic<T>(
                 // on_next
                     [so](T t){
-                        so->on_next(t);
+                        so->on_next(std::move(t));
                     },
                 // on_error
                     [so](std::exception_ptr e){
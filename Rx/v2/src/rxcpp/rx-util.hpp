@@ -62,7 +62,7 @@ public:
     : is_set(false)
     {
         if (other.is_set) {
-            new (reinterpret_cast<T*>(&storage)) T(*other.get());
+            new (reinterpret_cast<T*>(&storage)) T(*other);
             is_set = true;
         }
     }
@@ -70,7 +70,7 @@ public:
     : is_set(false)
     {
         if (other.is_set) {
-            new (reinterpret_cast<T*>(&storage)) T(std::move(*other.get()));
+            new (reinterpret_cast<T*>(&storage)) T(std::move(*other));
             is_set = true;
             other.reset();
         }
@@ -151,12 +151,12 @@ public:
     }
 
     maybe& operator=(const T& other) {
-        set(other);
+        reset(other);
         return *this;
     }
     maybe& operator=(const maybe& other) {
-        if (const T* pother = other.get()) {
-            set(*pother);
+        if (!other.empty()) {
+            reset(*other);
         } else {
             reset();
         }
@@ -164,6 +164,330 @@ public:
     }
 };
 
+//
+// move-only replacement for std::function.
+// callables that fit in Capacity bytes are stored inline and never
+// touch the allocator. larger callables fall back to a single heap
+// allocation.
+//
+template<class Signature, std::size_t Capacity = 6 * sizeof(void*)>
+class small_function;
+
+template<class R, class... ArgN, std::size_t Capacity>
+class small_function<R(ArgN...), Capacity>
+{
+    typedef small_function<R(ArgN...), Capacity> this_type;
+    typedef typename std::aligned_storage<Capacity>::type storage_type;
+
+    struct vtable_type
+    {
+        R (*invoke)(void*, ArgN&&...);
+        void (*move)(void*, void*);
+        void (*destroy)(void*);
+    };
+
+    template<class F>
+    struct inline_target
+    {
+        static F* get(void* s) {
+            return reinterpret_cast<F*>(s);
+        }
+        static R invoke(void* s, ArgN&&... an) {
+            return (*get(s))(std::forward<ArgN>(an)...);
+        }
+        static void move(void* from, void* to) {
+            new (to) F(std::move(*get(from)));
+            get(from)->~F();
+        }
+        static void destroy(void* s) {
+            get(s)->~F();
+        }
+        static const vtable_type* table() {
+            static const vtable_type t = {&invoke, &move, &destroy};
+            return &t;
+        }
+        template<class U>
+        static void construct(void* s, U&& u) {
+            new (s) F(std::forward<U>(u));
+        }
+    };
+
+    template<class F>
+    struct heap_target
+    {
+        static F*& get(void* s) {
+            return *reinterpret_cast<F**>(s);
+        }
+        static R invoke(void* s, ArgN&&... an) {
+            return (*get(s))(std::forward<ArgN>(an)...);
+        }
+        static void move(void* from, void* to) {
+            new (to) F*(get(from));
+        }
+        static void destroy(void* s) {
+            delete get(s);
+        }
+        static const vtable_type* table() {
+            static const vtable_type t = {&invoke, &move, &destroy};
+            return &t;
+        }
+        template<class U>
+        static void construct(void* s, U&& u) {
+            new (s) F*(new F(std::forward<U>(u)));
+        }
+    };
+
+    const vtable_type* vtable;
+    storage_type storage;
+
+public:
+    template<class F>
+    struct fits_inline
+    {
+        static const bool value =
+            sizeof(F) <= sizeof(storage_type) &&
+            std::alignment_of<F>::value <= std::alignment_of<storage_type>::value;
+    };
+
+    small_function()
+        : vtable(nullptr)
+    {
+    }
+    small_function(std::nullptr_t)
+        : vtable(nullptr)
+    {
+    }
+    template<class F,
+        class Decayed = typename std::decay<F>::type,
+        class Enabled = typename std::enable_if<!std::is_same<Decayed, this_type>::value>::type,
+        class Result = decltype(std::declval<Decayed&>()(std::declval<ArgN>()...))>
+    small_function(F&& f)
+        : vtable(nullptr)
+    {
+        typedef typename std::conditional<fits_inline<Decayed>::value,
+            inline_target<Decayed>,
+            heap_target<Decayed>>::type target;
+        target::construct(&storage, std::forward<F>(f));
+        vtable = target::table();
+    }
+    small_function(small_function&& o)
+        : vtable(o.vtable)
+    {
+        if (vtable) {
+            vtable->move(&o.storage, &storage);
+            o.vtable = nullptr;
+        }
+    }
+    ~small_function()
+    {
+        reset();
+    }
+    small_function& operator=(small_function&& o)
+    {
+        if (this != &o) {
+            reset();
+            if (o.vtable) {
+                o.vtable->move(&o.storage, &storage);
+                vtable = o.vtable;
+                o.vtable = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    void reset() {
+        if (vtable) {
+            auto destroy = vtable->destroy;
+            vtable = nullptr;
+            destroy(&storage);
+        }
+    }
+
+    explicit operator bool() const {
+        return !!vtable;
+    }
+
+    // not const, the target may change its own state when called.
+    R operator()(ArgN... an) {
+        if (!vtable) {
+            abort();
+        }
+        return vtable->invoke(&storage, std::forward<ArgN>(an)...);
+    }
+
+private:
+    small_function(const small_function&);
+    small_function& operator=(const small_function&);
+};
+
+//
+// unbounded multiple producer, single consumer queue.
+// push is wait-free and may be called from any thread.
+// pop must only be called by one thread at a time. it returns false
+// when the queue is empty and also when a concurrent push has taken
+// its place but not yet linked its node, in which case the value
+// becomes visible once that push returns.
+//
+template<class T>
+class mpsc_queue
+{
+    struct node_type
+    {
+        node_type()
+            : next(nullptr)
+        {
+        }
+        template<class U>
+        explicit node_type(U&& u)
+            : next(nullptr)
+        {
+            value.reset(std::forward<U>(u));
+        }
+        std::atomic<node_type*> next;
+        maybe<T> value;
+    };
+
+    // producers swap themselves into head
+    std::atomic<node_type*> head;
+    // the consumer owns tail, which is always an already consumed node
+    node_type* tail;
+
+    mpsc_queue(const mpsc_queue&);
+    mpsc_queue& operator=(const mpsc_queue&);
+
+public:
+    mpsc_queue()
+        : head(new node_type())
+        , tail(head.load())
+    {
+    }
+    ~mpsc_queue()
+    {
+        while (tail) {
+            auto next = tail->next.load();
+            delete tail;
+            tail = next;
+        }
+    }
+
+    template<class U>
+    void push(U&& u) {
+        auto n = new node_type(std::forward<U>(u));
+        auto prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    bool pop(maybe<T>& out) {
+        auto next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        out.reset(std::move(*next->value));
+        next->value.reset();
+        delete tail;
+        tail = next;
+        return true;
+    }
+};
+
+//
+// bounded lock-free queue. each cell carries a sequence number that
+// tells producers and consumers whose turn it is, so push and pop only
+// contend on their own position counter.
+// several threads may push and several may pop at once.
+//
+template<class T>
+class bounded_queue
+{
+    struct cell_type
+    {
+        std::atomic<std::size_t> sequence;
+        maybe<T> value;
+    };
+
+    std::unique_ptr<cell_type[]> cells;
+    std::size_t mask;
+    // keep the producer and consumer positions on their own cache lines
+    char pad0[64];
+    std::atomic<std::size_t> pushPos;
+    char pad1[64];
+    std::atomic<std::size_t> popPos;
+    char pad2[64];
+
+    bounded_queue(const bounded_queue&);
+    bounded_queue& operator=(const bounded_queue&);
+
+    static std::size_t round_up(std::size_t n) {
+        std::size_t result = 2;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    explicit bounded_queue(std::size_t c)
+        : cells(new cell_type[round_up(c)])
+        , mask(round_up(c) - 1)
+        , pushPos(0)
+        , popPos(0)
+    {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t capacity() const {
+        return mask + 1;
+    }
+
+    // u is only moved from when the push succeeds
+    template<class U>
+    bool try_push(U&& u) {
+        auto pos = pushPos.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& cell = cells[pos & mask];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value.reset(std::forward<U>(u));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // full
+                return false;
+            } else {
+                pos = pushPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(maybe<T>& out) {
+        auto pos = popPos.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& cell = cells[pos & mask];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out.reset(std::move(*cell.value));
+                    cell.value.reset();
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // empty
+                return false;
+            } else {
+                pos = popPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
 template<typename Function>
 class unwinder
 {
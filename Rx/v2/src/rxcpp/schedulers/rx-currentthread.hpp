@@ -13,6 +13,78 @@ namespace schedulers {
 
 namespace detail {
 
+// a growable ring of items in first-in first-out order. the slots are
+// reused, so a steady stream of items does not allocate.
+template<class T>
+class fifo_ring
+{
+    typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage_type;
+
+    std::unique_ptr<storage_type[]> slots;
+    std::size_t capacity;
+    std::size_t head;
+    std::size_t count;
+
+    fifo_ring(const fifo_ring&);
+    fifo_ring& operator=(const fifo_ring&);
+
+    T& at(std::size_t i) {
+        return *reinterpret_cast<T*>(&slots[(head + i) & (capacity - 1)]);
+    }
+
+    void grow() {
+        auto c = capacity == 0 ? 16 : capacity * 2;
+        std::unique_ptr<storage_type[]> next(new storage_type[c]);
+        for (std::size_t i = 0; i != count; ++i) {
+            auto& item = at(i);
+            new (&next[i]) T(std::move(item));
+            item.~T();
+        }
+        slots = std::move(next);
+        capacity = c;
+        head = 0;
+    }
+
+public:
+    fifo_ring()
+        : capacity(0)
+        , head(0)
+        , count(0)
+    {
+    }
+    ~fifo_ring()
+    {
+        while (!empty()) {
+            pop_front();
+        }
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    T& front() {
+        return at(0);
+    }
+    T& back() {
+        return at(count - 1);
+    }
+
+    void push_back(T item) {
+        if (count == capacity) {
+            grow();
+        }
+        new (&slots[(head + count) & (capacity - 1)]) T(std::move(item));
+        ++count;
+    }
+
+    void pop_front() {
+        at(0).~T();
+        head = (head + 1) & (capacity - 1);
+        --count;
+    }
+};
+
 struct action_queue
 {
     typedef action_queue this_type;
@@ -38,6 +110,9 @@ public:
     struct current_thread_queue_type {
         scheduler sc;
         recursion r;
+        // work that was due when it was scheduled, in due order. it stays
+        // in order without the heap and is run without looking at the clock.
+        fifo_ring<item_type> immediate;
         queue_item_time queue;
     };
 
@@ -59,24 +134,56 @@ public:
         if (!current_thread_queue()) {
             abort();
         }
-        return current_thread_queue()->queue.empty();
+        return current_thread_queue()->immediate.empty() && current_thread_queue()->queue.empty();
     }
-    static queue_item_time::const_reference top() {
-        if (!current_thread_queue()) {
+    // removes the next item. due is set for an item from immediate,
+    // otherwise the item may not be due yet.
+    static item_type pop(bool& due) {
+        auto state = current_thread_queue();
+        if (!state) {
+            abort();
+        }
+        auto& immediate = state->immediate;
+        auto& queue = state->queue;
+        if (immediate.empty() && queue.empty()) {
             abort();
         }
-        return current_thread_queue()->queue.top();
+        // an immediate item goes first unless a timer came due before it was scheduled
+        bool useImmediate = !immediate.empty() && (queue.empty() || immediate.front().when <= queue.top().when);
+        RXCPP_UNWIND_AUTO([state]{
+            if (state->immediate.empty() && state->queue.empty()) {
+                // allow recursion
+                state->r.reset(true);
+            }
+        });
+        due = useImmediate;
+        if (useImmediate) {
+            item_type result(std::move(immediate.front()));
+            immediate.pop_front();
+            return result;
+        }
+        item_type result(queue.top());
+        queue.pop();
+        return result;
     }
-    static void pop() {
+    // schedules work that is due now
+    static void push(const schedulable& what) {
         auto state = current_thread_queue();
         if (!state) {
             abort();
         }
-        state->queue.pop();
-        if (state->queue.empty()) {
-            // allow recursion
-            state->r.reset(true);
+        if (!what.is_subscribed()) {
+            return;
         }
+        // the clock is only needed to order this against pending timers
+        // and the overdue timers in immediate. every timer pushed later is
+        // due after this item was pushed.
+        auto& immediate = state->immediate;
+        bool untimed = state->queue.empty() && (immediate.empty() || immediate.back().when == clock::time_point::min());
+        auto when = untimed ? clock::time_point::min() : clock::now();
+        immediate.push_back(item_type(when, what));
+        // disallow recursion
+        state->r.reset(false);
     }
     static void push(item_type item) {
         auto state = current_thread_queue();
@@ -86,7 +193,15 @@ public:
         if (!item.what.is_subscribed()) {
             return;
         }
-        state->queue.push(std::move(item));
+        // an overdue timer joins immediate when that keeps immediate in
+        // due order, a timer due before the last item in immediate waits
+        // in the heap, which orders it against immediate when popped.
+        auto& immediate = state->immediate;
+        if (item.when <= clock::now() && (immediate.empty() || immediate.back().when <= item.when)) {
+            immediate.push_back(std::move(item));
+        } else {
+            state->queue.push(std::move(item));
+        }
         // disallow recursion
         state->r.reset(false);
     }
@@ -152,7 +267,7 @@ private:
         }
 
         virtual void schedule(const schedulable& scbl) const {
-            queue::push(queue::item_type(now(), scbl));
+            queue::push(scbl);
         }
 
         virtual void schedule(clock_type::duration when, const schedulable& scbl) const {
@@ -183,7 +298,28 @@ public:
     }
 
     virtual void schedule(const schedulable& scbl) const {
-        schedule(now(), scbl);
+        if (!scbl.is_subscribed()) {
+            return;
+        }
+
+        auto sc = queue::get_scheduler();
+        // check ownership
+        if (sc != scheduler())
+        {
+            // already has an owner - delegate
+            return sc.schedule(scbl);
+        }
+
+        // take ownership
+
+        sc = queue::ensure(get_derecurser());
+        RXCPP_UNWIND_AUTO([]{
+            queue::destroy();
+        });
+
+        queue::push(scbl);
+
+        run();
     }
 
     virtual void schedule(clock_type::duration when, const schedulable& scbl) const {
@@ -205,37 +341,47 @@ public:
 
         // take ownership
 
-        sc = queue::ensure(make_scheduler<derecurser>());
+        sc = queue::ensure(get_derecurser());
         RXCPP_UNWIND_AUTO([]{
             queue::destroy();
         });
 
         queue::push(queue::item_type(when, scbl));
 
-        const auto& recursor = queue::get_recursion().get_recurse();
+        run();
+    }
 
-        // loop until queue is empty
-        for (
-             auto when = queue::top().when;
-             std::this_thread::sleep_until(when), true;
-             when = queue::top().when
-             )
-        {
-            auto what = queue::top().what;
+private:
+    // both schedulers are stateless, so every thread shares one of each.
+    // never destroyed, other threads may still use them during static destruction
+    static scheduler get_derecurser() {
+        static scheduler* instance = new scheduler(make_scheduler<derecurser>());
+        return *instance;
+    }
+
+    // loop until queue is empty
+    static void run() {
+        const auto& recursor = queue::get_recursion().get_recurse();
 
-            queue::pop();
+        while (!queue::empty()) {
+            bool due = false;
+            auto next = queue::pop(due);
 
-            what(what, recursor);
+            // immediate items were due when they were pushed
+            if (!due && next.when > clock_type::now()) {
+                std::this_thread::sleep_until(next.when);
+            }
 
-            if (queue::empty()) {
-                break;
+            if (next.what.is_subscribed()) {
+                next.what(next.what, recursor);
             }
         }
     }
 };
 
 inline scheduler make_current_thread() {
-    return make_scheduler<current_thread>();
+    static scheduler* instance = new scheduler(make_scheduler<current_thread>());
+    return *instance;
 }
 
 }
@@ -0,0 +1,710 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_RX_SCHEDULER_THREAD_POOL_HPP)
+#define RXCPP_RX_SCHEDULER_THREAD_POOL_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace schedulers {
+
+namespace detail {
+
+//
+// Chase-Lev work stealing deque.
+// the owning thread pushes and pops at the bottom (LIFO).
+// any other thread may steal from the top (FIFO).
+//
+template<class T>
+class work_stealing_deque
+{
+    static_assert(std::is_pointer<T>::value, "work_stealing_deque only stores pointers");
+
+    struct array_type
+    {
+        explicit array_type(std::int64_t c)
+            : capacity(c)
+            , items(new std::atomic<T>[static_cast<std::size_t>(c)])
+        {
+        }
+        T get(std::int64_t i) const {
+            return items[static_cast<std::size_t>(i & (capacity - 1))].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, T v) {
+            items[static_cast<std::size_t>(i & (capacity - 1))].store(v, std::memory_order_relaxed);
+        }
+        array_type* grow(std::int64_t b, std::int64_t t) const {
+            auto next = new array_type(capacity * 2);
+            for (auto i = t; i != b; ++i) {
+                next->put(i, get(i));
+            }
+            return next;
+        }
+        std::int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    std::atomic<std::int64_t> top;
+    // keep the thieves' end and the owner's end on separate cache lines
+    char pad[64];
+    std::atomic<std::int64_t> bottom;
+    std::atomic<array_type*> array;
+    // thieves may still be reading a replaced array, so all of them are
+    // kept until the deque is destroyed. only touched by the owner.
+    std::vector<std::unique_ptr<array_type>> arrays;
+
+    work_stealing_deque(const work_stealing_deque&);
+    work_stealing_deque& operator=(const work_stealing_deque&);
+
+public:
+    explicit work_stealing_deque(std::int64_t capacity = 256)
+        : top(0)
+        , bottom(0)
+        , array(nullptr)
+    {
+        arrays.emplace_back(new array_type(capacity));
+        array = arrays.back().get();
+    }
+
+    // owner only
+    void push(T v) {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        auto a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            arrays.emplace_back(a->grow(b, t));
+            a = arrays.back().get();
+            array.store(a, std::memory_order_release);
+        }
+        a->put(b, v);
+        // seq_cst so that a worker going to sleep either sees this
+        // item or is seen as sleeping by the pusher.
+        bottom.store(b + 1);
+    }
+
+    // owner only
+    bool pop(T& out) {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto a = array.load(std::memory_order_relaxed);
+        bottom.store(b);
+        auto t = top.load();
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = a->get(b);
+        if (t == b) {
+            // last item, race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread
+    bool steal(T& out) {
+        auto t = top.load();
+        auto b = bottom.load();
+        if (t >= b) {
+            return false;
+        }
+        auto a = array.load(std::memory_order_acquire);
+        out = a->get(t);
+        return top.compare_exchange_strong(t, t + 1);
+    }
+
+    // any thread, only a hint while other threads are active
+    bool empty() const {
+        return bottom.load() <= top.load();
+    }
+};
+
+// a counter that only one thread at a time writes to. it can be
+// read from any thread without making the writer pay for a lock
+// or a read-modify-write.
+class single_writer_counter
+{
+    std::atomic<std::uint64_t> n;
+public:
+    single_writer_counter()
+        : n(0)
+    {
+    }
+    void increment() {
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    std::uint64_t get() const {
+        return n.load(std::memory_order_relaxed);
+    }
+};
+
+}
+
+//
+// a fixed set of worker threads.
+// each worker owns a work stealing deque. work scheduled from a worker
+// goes to its own deque and idle workers steal from the others. work
+// scheduled from any other thread goes to a shared queue. timed work
+// waits in a heap shared by all the workers.
+//
+// tail recursion is allowed while the worker has nothing else queued.
+// an action that reschedules itself stays on the worker that is running
+// it and takes turns with the rest of that worker's deque.
+//
+// actions made with action_duration::runs_long never run on the
+// workers. they go to a separate set of blocking threads that is
+// started on demand, up to maxBlocking threads, and shrinks again
+// when those threads have been idle for a while.
+//
+struct thread_pool : public scheduler_interface
+{
+    static const std::size_t default_max_blocking = 64;
+
+private:
+    typedef thread_pool this_type;
+    thread_pool(const this_type&);
+
+    typedef scheduler_base::clock_type clock;
+
+    // a timer does not keep the pool alive. a schedulable of this pool
+    // is kept without its scheduler, which it gets back when it is due.
+    // the timers that are left when the pool is released are destroyed
+    // with it.
+    struct timed_item_type
+    {
+        timed_item_type(clock::time_point w, schedulable s, bool p)
+            : when(w)
+            , what(std::move(s))
+            , pooled(p)
+        {
+        }
+        clock::time_point when;
+        schedulable what;
+        bool pooled;
+    };
+
+    struct compare_item_time
+    {
+        bool operator()(const timed_item_type& lhs, const timed_item_type& rhs) const {
+            return lhs.when > rhs.when;
+        }
+    };
+
+    typedef std::priority_queue<
+        timed_item_type,
+        std::vector<timed_item_type>,
+        compare_item_time
+    > queue_item_time;
+
+    struct state_type;
+
+    struct worker_type
+    {
+        worker_type(state_type* s, std::size_t i)
+            : state(s)
+            , index(i)
+            , alternate(false)
+            , running(nullptr)
+        {
+        }
+        ~worker_type()
+        {
+            schedulable* item = nullptr;
+            while (deque.pop(item)) {
+                delete item;
+            }
+            for (auto i : yielded) {
+                delete i;
+            }
+            for (auto i : inbox) {
+                delete i;
+            }
+        }
+
+        state_type* state;
+        std::size_t index;
+        detail::work_stealing_deque<schedulable*> deque;
+        // the running action rescheduling itself lands here instead of
+        // the deque. these are never stolen.
+        std::deque<schedulable*> yielded;
+        // items taken from the shared queue along with the one being run
+        std::deque<schedulable*> inbox;
+        bool alternate;
+        const schedulable* running;
+        recursion r;
+        std::thread thread;
+        // queue depth accounting, only written by this worker
+        detail::single_writer_counter enqueued;
+        detail::single_writer_counter dequeued;
+
+        bool has_local_work() {
+            return !deque.empty() || !inbox.empty() || !yielded.empty();
+        }
+
+        schedulable* next() {
+            schedulable* item = nullptr;
+            alternate = !alternate;
+            if (!yielded.empty() && alternate) {
+                item = yielded.front();
+                yielded.pop_front();
+            } else if (deque.pop(item)) {
+            } else if (!inbox.empty()) {
+                item = inbox.front();
+                inbox.pop_front();
+            } else if (!yielded.empty()) {
+                item = yielded.front();
+                yielded.pop_front();
+            } else {
+                item = nullptr;
+            }
+            return item;
+        }
+    };
+
+    // the threads that run the long actions
+    struct blocking_type
+    {
+        explicit blocking_type(std::size_t m)
+            : maxThreads(m == 0 ? 1 : m)
+            , live(0)
+            , idle(0)
+            , stopping(false)
+        {
+        }
+        ~blocking_type()
+        {
+            for (auto i : queue) {
+                delete i;
+            }
+        }
+
+        std::mutex lock;
+        std::condition_variable wake;
+        // these must only be accessed under lock
+        std::deque<schedulable*> queue;
+        std::vector<std::thread> threads;
+        // threads that have stopped and can be joined
+        std::vector<std::thread::id> exited;
+        std::size_t maxThreads;
+        std::size_t live;
+        std::size_t idle;
+        bool stopping;
+
+        // must be called with lock held
+        void reap() {
+            for (auto id : exited) {
+                auto it = std::find_if(threads.begin(), threads.end(),
+                    [id](const std::thread& t){
+                        return t.get_id() == id;
+                    });
+                if (it != threads.end()) {
+                    it->join();
+                    threads.erase(it);
+                }
+            }
+            exited.clear();
+        }
+    };
+
+    struct state_type
+    {
+        state_type(std::size_t n, std::size_t maxBlocking)
+            : nextDue(max_due())
+            , sleeping(0)
+            , stopping(false)
+            , blocking(maxBlocking)
+        {
+            for (std::size_t i = 0; i != n; ++i) {
+                workers.emplace_back(new worker_type(this, i));
+            }
+        }
+        ~state_type()
+        {
+            for (auto i : injected) {
+                delete i;
+            }
+        }
+
+        static clock::rep max_due() {
+            return (std::numeric_limits<clock::rep>::max)();
+        }
+
+        std::vector<std::unique_ptr<worker_type>> workers;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        // these must only be accessed under lock
+        std::deque<schedulable*> injected;
+        queue_item_time timers;
+        // the pool, for the timers that were scheduled on it
+        std::weak_ptr<scheduler_interface> owner;
+        // only written under lock
+        detail::single_writer_counter injectedCount;
+
+        // due time of the first timer, readable without the lock
+        std::atomic<clock::rep> nextDue;
+        std::atomic<int> sleeping;
+        std::atomic<bool> stopping;
+
+        blocking_type blocking;
+
+        void notify_sleeper() {
+            if (sleeping.load() > 0) {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.notify_one();
+            }
+        }
+
+        // must be called with lock held
+        bool has_work() const {
+            if (!injected.empty()) {
+                return true;
+            }
+            for (auto& w : workers) {
+                if (!w->deque.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // moves due timers to the deque of the calling worker
+        void release_timers(const std::shared_ptr<state_type>& self, worker_type* w) {
+            auto now = clock::now();
+            if (now.time_since_epoch().count() < nextDue.load(std::memory_order_relaxed)) {
+                return;
+            }
+            bool released = false;
+            std::vector<schedulable*> blockingDue;
+            // released after the lock, the pool may be destroyed with it
+            std::shared_ptr<scheduler_interface> pool;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                while (!timers.empty() && timers.top().when <= now) {
+                    auto& top = timers.top();
+                    if (top.pooled && !pool) {
+                        pool = owner.lock();
+                    }
+                    if (top.what.is_subscribed() && (!top.pooled || pool)) {
+                        auto what = top.pooled
+                            ? new schedulable(top.what.get_subscription(), scheduler(pool), top.what.get_action())
+                            : new schedulable(top.what);
+                        if (what->get_duration() == action_duration::runs_long) {
+                            blockingDue.push_back(what);
+                        } else {
+                            w->deque.push(what);
+                            w->enqueued.increment();
+                            released = true;
+                        }
+                    }
+                    timers.pop();
+                }
+                nextDue = timers.empty() ? max_due() : timers.top().when.time_since_epoch().count();
+            }
+            for (auto item : blockingDue) {
+                schedule_blocking(self, item);
+            }
+            if (released) {
+                notify_sleeper();
+            }
+        }
+
+        // takes a few items at a time to amortize the lock. the extra
+        // items stay in the worker's inbox, in order.
+        schedulable* take_injected(worker_type* w) {
+            std::unique_lock<std::mutex> guard(lock);
+            if (injected.empty()) {
+                return nullptr;
+            }
+            auto item = injected.front();
+            injected.pop_front();
+            auto batch = std::min<std::size_t>(injected.size() / workers.size(), 32);
+            for (; batch != 0; --batch) {
+                w->inbox.push_back(injected.front());
+                injected.pop_front();
+            }
+            return item;
+        }
+
+        schedulable* steal(worker_type* w) {
+            auto n = workers.size();
+            schedulable* item = nullptr;
+            for (std::size_t i = 1; i < n; ++i) {
+                auto& victim = workers[(w->index + i) % n];
+                if (victim->deque.steal(item)) {
+                    return item;
+                }
+            }
+            return nullptr;
+        }
+
+        void idle() {
+            std::unique_lock<std::mutex> guard(lock);
+            ++sleeping;
+            // a push that did not see sleeping above is visible here
+            if (!stopping && !has_work()) {
+                if (timers.empty()) {
+                    wake.wait(guard);
+                } else {
+                    // copied, the heap may reallocate while this waits
+                    auto due = timers.top().when;
+                    if (due > clock::now()) {
+                        wake.wait_until(guard, due);
+                    }
+                }
+            }
+            --sleeping;
+        }
+
+        std::size_t short_depth() const {
+            // read the dequeue side first so that the difference does
+            // not usually go below zero while workers are running
+            std::uint64_t out = 0;
+            for (auto& w : workers) {
+                out += w->dequeued.get();
+            }
+            std::uint64_t in = injectedCount.get();
+            for (auto& w : workers) {
+                in += w->enqueued.get();
+            }
+            return in > out ? static_cast<std::size_t>(in - out) : 0;
+        }
+
+        static void schedule_blocking(const std::shared_ptr<state_type>& self, schedulable* item) {
+            auto& b = self->blocking;
+            std::unique_lock<std::mutex> guard(b.lock);
+            if (b.stopping) {
+                guard.unlock();
+                delete item;
+                return;
+            }
+            b.queue.push_back(item);
+            if (b.idle > 0) {
+                b.wake.notify_one();
+            }
+            // start another thread when the idle ones cannot take all the queued work
+            if (b.queue.size() > b.idle && b.live < b.maxThreads) {
+                b.reap();
+                ++b.live;
+                b.threads.emplace_back([self](){
+                    run_blocking(self);
+                });
+            }
+        }
+
+        static void run_blocking(std::shared_ptr<state_type> self) {
+            auto& b = self->blocking;
+            recursion r;
+            std::unique_lock<std::mutex> guard(b.lock);
+            while (!b.stopping) {
+                if (b.queue.empty()) {
+                    ++b.idle;
+                    auto status = b.wake.wait_for(guard, blocking_keep_alive());
+                    --b.idle;
+                    if (status == std::cv_status::timeout && b.queue.empty()) {
+                        break;
+                    }
+                    continue;
+                }
+                std::unique_ptr<schedulable> what(b.queue.front());
+                b.queue.pop_front();
+                // the action may keep this thread with tail recursion
+                // only while nothing else is waiting for it
+                r.reset(b.queue.empty());
+                guard.unlock();
+                if (what->is_subscribed()) {
+                    (*what)(*what, r.get_recurse());
+                }
+                what.reset();
+                guard.lock();
+            }
+            --b.live;
+            b.exited.push_back(std::this_thread::get_id());
+        }
+
+        static clock::duration blocking_keep_alive() {
+            return std::chrono::seconds(10);
+        }
+    };
+
+    static worker_type*& current_worker() {
+        static RXCPP_THREAD_LOCAL worker_type* worker;
+        return worker;
+    }
+
+    static void run(std::shared_ptr<state_type> state, worker_type* w) {
+        current_worker() = w;
+        std::size_t ticks = 0;
+        while (!state->stopping) {
+            // busy workers still look at the timers now and then
+            if ((++ticks & 0x1f) == 0) {
+                state->release_timers(state, w);
+            }
+
+            auto item = w->next();
+            if (!item) {
+                item = state->take_injected(w);
+            }
+            if (!item) {
+                item = state->steal(w);
+            }
+            if (!item) {
+                state->release_timers(state, w);
+                if (w->deque.empty()) {
+                    state->idle();
+                }
+                continue;
+            }
+            w->dequeued.increment();
+
+            std::unique_ptr<schedulable> what(item);
+            if (!what->is_subscribed()) {
+                continue;
+            }
+            w->r.reset(!w->has_local_work());
+            w->running = what.get();
+            RXCPP_UNWIND_AUTO([w]{
+                w->running = nullptr;
+            });
+            (*what)(*what, w->r.get_recurse());
+        }
+        current_worker() = nullptr;
+    }
+
+    std::shared_ptr<state_type> state;
+
+public:
+    explicit thread_pool(std::size_t n, std::size_t maxBlocking = default_max_blocking)
+        : state(std::make_shared<state_type>(n == 0 ? 1 : n, maxBlocking))
+    {
+        for (auto& w : state->workers) {
+            auto s = state;
+            auto worker = w.get();
+            w->thread = std::thread([s, worker](){
+                run(s, worker);
+            });
+        }
+    }
+    virtual ~thread_pool()
+    {
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            state->stopping = true;
+            state->wake.notify_all();
+        }
+        for (auto& w : state->workers) {
+            if (w->thread.get_id() == std::this_thread::get_id()) {
+                // the last reference was released by an action on this worker
+                w->thread.detach();
+            } else if (w->thread.joinable()) {
+                w->thread.join();
+            }
+        }
+        std::vector<std::thread> blockingThreads;
+        {
+            std::unique_lock<std::mutex> guard(state->blocking.lock);
+            state->blocking.stopping = true;
+            state->blocking.wake.notify_all();
+            blockingThreads.swap(state->blocking.threads);
+        }
+        for (auto& t : blockingThreads) {
+            if (t.get_id() == std::this_thread::get_id()) {
+                t.detach();
+            } else {
+                t.join();
+            }
+        }
+    }
+
+    std::size_t size() const {
+        return state->workers.size();
+    }
+
+    // the number of blocking threads that are currently started
+    std::size_t blocking_threads() const {
+        std::unique_lock<std::mutex> guard(state->blocking.lock);
+        return state->blocking.live;
+    }
+
+    // the number of actions of the given duration that are ready to run
+    // but have not been started. timers that are not yet due are not
+    // included. runs_short is a snapshot of counters that the workers
+    // update without synchronizing, so it is approximate while they are busy.
+    std::size_t queue_depth(action_duration::type d) const {
+        if (d == action_duration::runs_long) {
+            std::unique_lock<std::mutex> guard(state->blocking.lock);
+            return state->blocking.queue.size();
+        }
+        return state->short_depth();
+    }
+
+    virtual clock_type::time_point now() const {
+        return clock_type::now();
+    }
+
+    virtual void schedule(const schedulable& scbl) const {
+        if (!scbl.is_subscribed()) {
+            return;
+        }
+        if (scbl.get_duration() == action_duration::runs_long) {
+            state_type::schedule_blocking(state, new schedulable(scbl));
+            return;
+        }
+        auto w = current_worker();
+        if (w && w->state == state.get()) {
+            w->enqueued.increment();
+            if (w->running && *w->running == scbl) {
+                w->yielded.push_back(new schedulable(scbl));
+                return;
+            }
+            w->deque.push(new schedulable(scbl));
+            // disallow tail recursion so the new work gets a turn
+            w->r.reset(false);
+            state->notify_sleeper();
+            return;
+        }
+        std::unique_lock<std::mutex> guard(state->lock);
+        state->injected.push_back(new schedulable(scbl));
+        state->injectedCount.increment();
+        if (state->sleeping > 0) {
+            state->wake.notify_one();
+        }
+    }
+
+    virtual void schedule(clock_type::duration when, const schedulable& scbl) const {
+        schedule(now() + when, scbl);
+    }
+
+    virtual void schedule(clock_type::time_point when, const schedulable& scbl) const {
+        if (when <= now()) {
+            return schedule(scbl);
+        }
+        if (!scbl.is_subscribed()) {
+            return;
+        }
+        auto self = std::const_pointer_cast<scheduler_interface>(shared_from_this());
+        bool pooled = scbl.get_scheduler() == scheduler(self);
+        std::unique_lock<std::mutex> guard(state->lock);
+        if (pooled) {
+            state->owner = self;
+        }
+        state->timers.push(timed_item_type(when, pooled ? schedulable(scbl.get_subscription(), scheduler(), scbl.get_action()) : scbl, pooled));
+        state->nextDue = state->timers.top().when.time_since_epoch().count();
+        // a sleeping worker may need to wake earlier than it planned
+        state->wake.notify_one();
+    }
+};
+
+inline scheduler make_thread_pool(std::size_t n = std::thread::hardware_concurrency(), std::size_t maxBlocking = thread_pool::default_max_blocking) {
+    return scheduler(std::static_pointer_cast<scheduler_interface>(std::make_shared<thread_pool>(n, maxBlocking)));
+}
+
+}
+
+}
+
+#endif
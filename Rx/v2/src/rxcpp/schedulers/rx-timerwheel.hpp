@@ -0,0 +1,558 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_RX_SCHEDULER_TIMER_WHEEL_HPP)
+#define RXCPP_RX_SCHEDULER_TIMER_WHEEL_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace schedulers {
+
+namespace detail {
+
+//
+// hashed hierarchical timer wheel.
+// time is counted in ticks. there are six levels of 64 slots, each
+// level 64 times coarser than the one below it. a timer is linked into
+// the level picked by the highest 6 bits in which its expiry differs
+// from the current tick, so insert and cancel are constant time. as the
+// current tick reaches a slot on a higher level, the timers in it are
+// moved down. timers past the top level wait in an overflow list.
+//
+// nodes live in chunks that never move and are linked by index. a
+// handle holds the index and the generation of the node, so cancelling
+// a timer that already fired is detected and ignored.
+//
+// not synchronized, the owner must serialize all calls.
+//
+template<class T>
+class hierarchical_timer_wheel
+{
+public:
+    typedef std::uint64_t tick_type;
+
+    struct handle_type
+    {
+        handle_type()
+            : index(npos)
+            , generation(0)
+        {
+        }
+        handle_type(std::uint32_t i, std::uint32_t g)
+            : index(i)
+            , generation(g)
+        {
+        }
+        std::uint32_t index;
+        std::uint32_t generation;
+    };
+
+private:
+    static const std::uint32_t npos = 0xFFFFFFFF;
+    static const int level_bits = 6;
+    static const int slot_count = 1 << level_bits;
+    static const int level_count = 6;
+    // the slot index used for the overflow list
+    static const int overflow_slot = level_count * slot_count;
+    static const std::uint16_t unlinked = 0xFFFF;
+    static const std::uint32_t chunk_bits = 10;
+    static const std::uint32_t chunk_size = 1 << chunk_bits;
+
+    struct node_type
+    {
+        node_type()
+            : prev(npos)
+            , next(npos)
+            , generation(0)
+            , slot(unlinked)
+            , expiry(0)
+        {
+        }
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t generation;
+        std::uint16_t slot;
+        tick_type expiry;
+        rxu::detail::maybe<T> value;
+    };
+
+    std::vector<std::unique_ptr<node_type[]>> chunks;
+    std::uint32_t allocated;
+    std::uint32_t freeList;
+    std::uint32_t heads[overflow_slot + 1];
+    std::uint64_t occupied[level_count];
+    tick_type current;
+    std::size_t count;
+
+    hierarchical_timer_wheel(const hierarchical_timer_wheel&);
+    hierarchical_timer_wheel& operator=(const hierarchical_timer_wheel&);
+
+    node_type& node(std::uint32_t i) {
+        return chunks[i >> chunk_bits][i & (chunk_size - 1)];
+    }
+
+    static int lowest_bit(std::uint64_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(mask);
+#else
+        int i = 0;
+        for (; (mask & 1) == 0; mask >>= 1) {
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+    std::uint32_t allocate() {
+        if (freeList != npos) {
+            auto i = freeList;
+            freeList = node(i).next;
+            return i;
+        }
+        if ((allocated & (chunk_size - 1)) == 0) {
+            chunks.emplace_back(new node_type[chunk_size]);
+        }
+        return allocated++;
+    }
+
+    void release(std::uint32_t i) {
+        auto& n = node(i);
+        n.value.reset();
+        n.slot = unlinked;
+        ++n.generation;
+        n.prev = npos;
+        n.next = freeList;
+        freeList = i;
+        --count;
+    }
+
+    void link(std::uint32_t i) {
+        auto& n = node(i);
+        int level = 0;
+        for (auto diff = (n.expiry ^ current) >> level_bits; diff != 0; diff >>= level_bits) {
+            ++level;
+        }
+        int slot = overflow_slot;
+        if (level < level_count) {
+            auto index = static_cast<int>((n.expiry >> (level * level_bits)) & (slot_count - 1));
+            slot = level * slot_count + index;
+            occupied[level] |= std::uint64_t(1) << index;
+        }
+        n.slot = static_cast<std::uint16_t>(slot);
+        n.prev = npos;
+        n.next = heads[slot];
+        if (n.next != npos) {
+            node(n.next).prev = i;
+        }
+        heads[slot] = i;
+    }
+
+    void unlink(std::uint32_t i) {
+        auto& n = node(i);
+        if (n.prev != npos) {
+            node(n.prev).next = n.next;
+        } else {
+            heads[n.slot] = n.next;
+        }
+        if (n.next != npos) {
+            node(n.next).prev = n.prev;
+        }
+        if (heads[n.slot] == npos && n.slot != overflow_slot) {
+            occupied[n.slot / slot_count] &= ~(std::uint64_t(1) << (n.slot % slot_count));
+        }
+        n.slot = unlinked;
+    }
+
+    // the slot that holds the earliest timers and the tick at which it starts
+    bool next_slot(int& slot, tick_type& start) const {
+        for (int level = 0; level < level_count; ++level) {
+            auto shift = level * level_bits;
+            auto index = static_cast<int>((current >> shift) & (slot_count - 1));
+            auto mask = occupied[level] & (~std::uint64_t(0) << index);
+            if (mask != 0) {
+                auto found = lowest_bit(mask);
+                auto block = current >> (shift + level_bits) << (shift + level_bits);
+                slot = level * slot_count + found;
+                start = block | (tick_type(found) << shift);
+                return true;
+            }
+        }
+        if (heads[overflow_slot] != npos) {
+            const int top = level_count * level_bits;
+            slot = overflow_slot;
+            start = ((current >> top) + 1) << top;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    hierarchical_timer_wheel()
+        : allocated(0)
+        , freeList(npos)
+        , current(0)
+        , count(0)
+    {
+        for (auto& h : heads) {
+            h = npos;
+        }
+        for (auto& o : occupied) {
+            o = 0;
+        }
+    }
+
+    tick_type now() const {
+        return current;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // expiry must be later than now()
+    handle_type insert(tick_type expiry, T value) {
+        auto i = allocate();
+        auto& n = node(i);
+        n.expiry = std::max(expiry, current + 1);
+        n.value.reset(std::move(value));
+        ++count;
+        link(i);
+        return handle_type(i, n.generation);
+    }
+
+    // the value of a timer that has not fired or been cancelled
+    T* find(handle_type h) {
+        if (h.index >= allocated) {
+            return nullptr;
+        }
+        auto& n = node(h.index);
+        if (n.generation != h.generation || n.slot == unlinked) {
+            return nullptr;
+        }
+        return &*n.value;
+    }
+
+    // removes the timer and moves its value out, so that the caller
+    // can destroy it after releasing any lock that protects the wheel.
+    bool cancel(handle_type h, rxu::detail::maybe<T>& out) {
+        auto value = find(h);
+        if (!value) {
+            return false;
+        }
+        out.reset(std::move(*value));
+        unlink(h.index);
+        release(h.index);
+        return true;
+    }
+
+    // the earliest tick at which advance() may find expired timers
+    bool next_expiration(tick_type& out) const {
+        int slot = 0;
+        return next_slot(slot, out);
+    }
+
+    // moves the current tick forward to target and passes the value of
+    // each timer that expired on the way to f, in expiry order.
+    template<class F>
+    void advance(tick_type target, F&& f) {
+        int slot = 0;
+        tick_type start = 0;
+        while (next_slot(slot, start) && start <= target) {
+            current = std::max(current, start);
+            auto i = heads[slot];
+            heads[slot] = npos;
+            if (slot != overflow_slot) {
+                occupied[slot / slot_count] &= ~(std::uint64_t(1) << (slot % slot_count));
+            }
+            while (i != npos) {
+                auto& n = node(i);
+                auto next = n.next;
+                n.slot = unlinked;
+                if (n.expiry <= current) {
+                    f(std::move(*n.value));
+                    release(i);
+                } else {
+                    link(i);
+                }
+                i = next;
+            }
+        }
+        current = std::max(current, target);
+    }
+};
+
+}
+
+//
+// runs timed work on one thread and keeps pending timers in a hashed
+// hierarchical timer wheel, so scheduling and cancelling a timer costs
+// the same no matter how many are pending. unsubscribing a pending
+// schedulable removes its timer and destroys the action at once.
+//
+// due times are rounded up to the resolution of the wheel, timers
+// never fire early.
+//
+struct timer_wheel : public scheduler_interface
+{
+private:
+    typedef timer_wheel this_type;
+    timer_wheel(const this_type&);
+
+    typedef scheduler_base::clock_type clock;
+
+    // a timer does not keep the wheel alive. a schedulable of this
+    // wheel is kept without its scheduler, which it gets back when it
+    // runs. the timers that are left when the wheel is released are
+    // destroyed with it.
+    struct item_type
+    {
+        item_type(schedulable w, bool o)
+            : what(std::move(w))
+            , owned(o)
+        {
+        }
+        schedulable what;
+        bool owned;
+        // removes the cancel hook from the lifetime once the timer fires
+        composite_subscription::weak_subscription hook;
+    };
+
+    typedef detail::hierarchical_timer_wheel<item_type> wheel_type;
+    typedef wheel_type::tick_type tick_type;
+
+    struct state_type
+    {
+        explicit state_type(clock::duration r)
+            : start(clock::now())
+            , resolution(r <= clock::duration::zero() ? clock::duration(1) : r)
+            , sleepingUntil(0)
+            , stopping(false)
+        {
+        }
+
+        static tick_type awake() {
+            return 0;
+        }
+        static tick_type forever() {
+            return (std::numeric_limits<tick_type>::max)();
+        }
+
+        const clock::time_point start;
+        const clock::duration resolution;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        // these must only be accessed under lock
+        wheel_type wheel;
+        std::deque<item_type> ready;
+        // the wheel, for the timers that were scheduled on it
+        std::weak_ptr<scheduler_interface> owner;
+        // the tick the thread is waiting for, or awake
+        tick_type sleepingUntil;
+        bool stopping;
+
+        std::thread::id thread;
+        recursion r;
+
+        tick_type tick_floor(clock::time_point t) const {
+            return t <= start ? 0 : static_cast<tick_type>((t - start) / resolution);
+        }
+        tick_type tick_ceil(clock::time_point t) const {
+            return t <= start ? 0 : static_cast<tick_type>((t - start + resolution - clock::duration(1)) / resolution);
+        }
+        clock::time_point tick_time(tick_type t) const {
+            return start + resolution * static_cast<clock::duration::rep>(t);
+        }
+
+        void cancel(wheel_type::handle_type h) {
+            rxu::detail::maybe<item_type> cancelled;
+            std::unique_lock<std::mutex> guard(lock);
+            wheel.cancel(h, cancelled);
+            guard.unlock();
+            // the action is destroyed here, outside the lock
+        }
+    };
+
+    static void run(std::shared_ptr<state_type> state) {
+        std::unique_lock<std::mutex> guard(state->lock);
+        while (!state->stopping) {
+            state->wheel.advance(state->tick_floor(clock::now()), [&](item_type&& item){
+                state->ready.push_back(std::move(item));
+            });
+            if (state->ready.empty()) {
+                tick_type next = 0;
+                if (state->wheel.next_expiration(next)) {
+                    state->sleepingUntil = next;
+                    state->wake.wait_until(guard, state->tick_time(next));
+                } else {
+                    state->sleepingUntil = state_type::forever();
+                    state->wake.wait(guard);
+                }
+                state->sleepingUntil = state_type::awake();
+                continue;
+            }
+
+            rxu::detail::maybe<item_type> item;
+            item.reset(std::move(state->ready.front()));
+            state->ready.pop_front();
+            state->r.reset(state->ready.empty());
+            auto owner = state->owner;
+
+            guard.unlock();
+            {
+                // the wheel may be destroyed with the last of these, so
+                // they are released before taking the lock again
+                std::shared_ptr<scheduler_interface> wheel;
+                RXCPP_UNWIND_AUTO([&]{
+                    // destroy the action before taking the lock again
+                    item.reset();
+                    wheel.reset();
+                    guard.lock();
+                });
+                auto& what = item->what;
+                what.remove(item->hook);
+                if (item->owned) {
+                    wheel = owner.lock();
+                    if (wheel) {
+                        what = schedulable(what.get_subscription(), scheduler(wheel), what.get_action());
+                    }
+                }
+                if (what.is_subscribed() && (!item->owned || wheel)) {
+                    what(what, state->r.get_recurse());
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<state_type> state;
+    std::thread worker;
+
+    void schedule_ready(const schedulable& scbl) const {
+        std::unique_lock<std::mutex> guard(state->lock);
+        if (state->stopping) {
+            return;
+        }
+        if (state->thread == std::this_thread::get_id()) {
+            // disallow tail recursion so the new work gets a turn
+            state->r.reset(false);
+        }
+        state->ready.push_back(item_type(scbl, false));
+        if (state->sleepingUntil != state_type::awake()) {
+            state->wake.notify_one();
+        }
+    }
+
+public:
+    explicit timer_wheel(clock_type::duration resolution = std::chrono::milliseconds(1))
+        : state(std::make_shared<state_type>(resolution))
+    {
+        auto s = state;
+        worker = std::thread([s](){
+            run(s);
+        });
+        std::unique_lock<std::mutex> guard(state->lock);
+        state->thread = worker.get_id();
+    }
+    virtual ~timer_wheel()
+    {
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            state->stopping = true;
+            state->wake.notify_all();
+        }
+        if (worker.get_id() == std::this_thread::get_id()) {
+            // the last reference was released by an action on the timer thread
+            worker.detach();
+        } else if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // the number of timers and due actions that have not run
+    std::size_t pending() const {
+        std::unique_lock<std::mutex> guard(state->lock);
+        return state->wheel.size() + state->ready.size();
+    }
+
+    virtual clock_type::time_point now() const {
+        return clock_type::now();
+    }
+
+    virtual void schedule(const schedulable& scbl) const {
+        if (!scbl.is_subscribed()) {
+            return;
+        }
+        schedule_ready(scbl);
+    }
+
+    virtual void schedule(clock_type::duration when, const schedulable& scbl) const {
+        schedule(now() + when, scbl);
+    }
+
+    virtual void schedule(clock_type::time_point when, const schedulable& scbl) const {
+        if (!scbl.is_subscribed()) {
+            return;
+        }
+        auto expiry = state->tick_ceil(when);
+        auto self = std::const_pointer_cast<scheduler_interface>(shared_from_this());
+        bool owned = scbl.get_scheduler() == scheduler(self);
+
+        wheel_type::handle_type handle;
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            if (state->stopping) {
+                return;
+            }
+            if (expiry <= state->wheel.now()) {
+                guard.unlock();
+                return schedule_ready(scbl);
+            }
+            if (owned) {
+                state->owner = self;
+            }
+            handle = state->wheel.insert(expiry, item_type(owned ? schedulable(scbl.get_subscription(), scheduler(), scbl.get_action()) : scbl, owned));
+            if (expiry < state->sleepingUntil) {
+                // the thread is waiting for a later timer
+                state->wake.notify_one();
+            }
+        }
+
+        // unsubscribe cancels the timer
+        std::weak_ptr<state_type> weak = state;
+        auto hook = scbl.add(make_subscription([weak, handle](){
+            auto s = weak.lock();
+            if (s) {
+                s->cancel(handle);
+            }
+        }));
+
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            auto item = state->wheel.find(handle);
+            if (item) {
+                item->hook = hook;
+                return;
+            }
+        }
+        // the timer fired or was cancelled before the hook was recorded,
+        // nothing else will remove the hook from the lifetime
+        scbl.remove(hook);
+    }
+};
+
+inline scheduler make_timer_wheel(scheduler_base::clock_type::duration resolution = std::chrono::milliseconds(1)) {
+    return scheduler(std::static_pointer_cast<scheduler_interface>(std::make_shared<timer_wheel>(resolution)));
+}
+
+}
+
+}
+
+#endif
@@ -166,11 +166,11 @@ public:
     }
 
     virtual void schedule(clock_type::duration when, const schedulable& scbl) const {
-        schedule_absolute(to_relative(when), scbl);
+        schedule_relative(to_relative(when), scbl);
     }
 
     virtual void schedule(clock_type::time_point when, const schedulable& scbl) const {
-        schedule_absolute(to_relative(when - now()), scbl);
+        schedule_relative(to_relative(when - now()), scbl);
     }
 
 };
@@ -240,7 +240,10 @@ protected:
                 r.reset(false);
                 if (scbl.is_subscribed()) {
                     scbl.unsubscribe(); // unsubscribe() run, not a;
-                    a(a, r.get_recurse());
+                    // a may have been unsubscribed while it waited
+                    if (a.is_subscribed()) {
+                        a(a, r.get_recurse());
+                    }
                 }
             });
         queue.push(item_type(when, run));
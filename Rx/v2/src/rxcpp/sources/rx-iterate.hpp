@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_SOURCES_RX_ITERATE_HPP)
+#define RXCPP_SOURCES_RX_ITERATE_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace sources {
+
+namespace detail {
+
+template<class Collection>
+struct iterate_traits
+{
+    typedef typename std::decay<Collection>::type collection_type;
+    typedef decltype(std::begin(*(const collection_type*)nullptr)) iterator_type;
+    typedef typename std::decay<decltype(*(*(iterator_type*)nullptr))>::type value_type;
+};
+
+// the values between two iterators. the values belong to the caller.
+template<class Iterator>
+struct iterator_range
+{
+    iterator_range(Iterator b, Iterator e)
+        : first(std::move(b))
+        , last(std::move(e))
+    {
+    }
+    Iterator first;
+    Iterator last;
+
+    Iterator begin() const {
+        return first;
+    }
+    Iterator end() const {
+        return last;
+    }
+};
+
+template<class Collection>
+struct iterate : public source_base<typename iterate_traits<Collection>::value_type>
+{
+    typedef iterate_traits<Collection> traits;
+    typedef typename traits::collection_type collection_type;
+    typedef typename traits::iterator_type iterator_type;
+    typedef typename traits::value_type value_type;
+
+    struct values
+    {
+        values(std::shared_ptr<const collection_type> c, rxsc::scheduler sc)
+            : collection(std::move(c))
+            , sc(std::move(sc))
+        {
+        }
+        // shared by every subscription, never copied
+        std::shared_ptr<const collection_type> collection;
+        rxsc::scheduler sc;
+    };
+    values initial;
+
+    iterate(std::shared_ptr<const collection_type> c, rxsc::scheduler sc)
+        : initial(std::move(c), std::move(sc))
+    {
+    }
+
+    struct state_type
+        : public values
+    {
+        state_type(const values& i)
+            : values(i)
+            , cursor(std::begin(*this->collection))
+            , end(std::end(*this->collection))
+        {
+        }
+        iterator_type cursor;
+        iterator_type end;
+
+        bool at_end() const {
+            return cursor == end;
+        }
+        auto current() const
+            -> decltype(*cursor) {
+            return *cursor;
+        }
+        void advance() {
+            ++cursor;
+        }
+    };
+
+    // sends the elements to o through next(o, element), which returns
+    // false for an element it dropped. each element is passed as the
+    // iterator returns it, a reference into the collection is not copied
+    // unless the observer takes it by value.
+    template<class Subscriber, class Next>
+    void emit(Subscriber o, Next next) {
+        emit_loop(std::make_shared<state_type>(initial), std::move(o), std::move(next));
+    }
+
+    struct next_to_subscriber
+    {
+        template<class Subscriber, class V>
+        bool operator()(const Subscriber& o, V&& v) const {
+            o.on_next(std::forward<V>(v));
+            return true;
+        }
+    };
+
+    template<class Subscriber>
+    void on_subscribe(Subscriber o) {
+        emit(std::move(o), next_to_subscriber());
+    }
+};
+
+// the collection of iterate(c). a shared_ptr is shared with the caller,
+// any other collection is moved into a new shared_ptr.
+template<class Collection>
+struct shared_collection
+{
+    typedef Collection type;
+    static std::shared_ptr<const type> share(Collection c) {
+        return std::make_shared<const type>(std::move(c));
+    }
+};
+template<class Collection>
+struct shared_collection<std::shared_ptr<Collection>>
+{
+    typedef Collection type;
+    static std::shared_ptr<const type> share(std::shared_ptr<Collection> c) {
+        return std::move(c);
+    }
+};
+
+}
+
+// sends the elements of the collection. the collection is kept in
+// storage shared by all the subscriptions. pass std::move(c), or a
+// shared_ptr to share it with the caller, to avoid a copy.
+template<class Collection>
+auto iterate(Collection c, rxsc::scheduler sc = rxsc::make_current_thread())
+    ->      observable<typename detail::iterate<typename detail::shared_collection<Collection>::type>::value_type,   detail::iterate<typename detail::shared_collection<Collection>::type>> {
+    typedef detail::shared_collection<Collection> shared;
+    return  observable<typename detail::iterate<typename shared::type>::value_type,   detail::iterate<typename shared::type>>(
+                                                                                      detail::iterate<typename shared::type>(shared::share(std::move(c)), std::move(sc)));
+}
+
+// sends the values between two iterators. the values are not copied
+// and must outlive every subscription.
+template<class Iterator>
+auto from(Iterator b, Iterator e, rxsc::scheduler sc = rxsc::make_current_thread())
+    ->      observable<typename detail::iterate<detail::iterator_range<Iterator>>::value_type,   detail::iterate<detail::iterator_range<Iterator>>> {
+    return  observable<typename detail::iterate<detail::iterator_range<Iterator>>::value_type,   detail::iterate<detail::iterator_range<Iterator>>>(
+                                                                                                 detail::iterate<detail::iterator_range<Iterator>>(std::make_shared<const detail::iterator_range<Iterator>>(std::move(b), std::move(e)), std::move(sc)));
+}
+
+}
+
+}
+
+#endif
@@ -22,6 +22,17 @@ struct range : public source_base<T>
         size_t remaining;
         ptrdiff_t step;
         rxsc::scheduler sc;
+
+        bool at_end() const {
+            return remaining == 0;
+        }
+        const T& current() const {
+            return next;
+        }
+        void advance() {
+            --remaining;
+            next = static_cast<T>(step + next);
+        }
     };
     state_type init;
     range(T b, size_t c, ptrdiff_t s, rxsc::scheduler sc)
@@ -31,27 +42,29 @@ struct range : public source_base<T>
         init.step = s;
         init.sc = sc;
     }
+
+    // sends the values to o through next(o, value), which returns false
+    // for a value it dropped.
+    // on_subscribe passes each value to o.on_next, a fused map/filter
+    // chain passes its own next so the values run through the chain in
+    // this loop.
+    template<class Subscriber, class Next>
+    void emit(Subscriber o, Next next) {
+        emit_loop(std::make_shared<state_type>(init), std::move(o), std::move(next));
+    }
+
+    struct next_to_subscriber
+    {
+        template<class Subscriber>
+        bool operator()(const Subscriber& o, const T& t) const {
+            o.on_next(t);
+            return true;
+        }
+    };
+
     template<class Subscriber>
     void on_subscribe(Subscriber o) {
-        auto state = std::make_shared<state_type>(init);
-        schedule(state->sc, o.get_subscription(), [=](const rxsc::schedulable& self){
-            if (state->remaining == 0) {
-                o.on_completed();
-                // o is unsubscribed
-            }
-            if (!o.is_subscribed()) {
-                // terminate loop
-                return;
-            }
-
-            // send next value
-            --state->remaining;
-            o.on_next(state->next);
-            state->next = static_cast<T>(state->step + state->next);
-
-            // tail recurse this same action to continue loop
-            self();
-        });
+        emit(std::move(o), next_to_subscriber());
     }
 };
 
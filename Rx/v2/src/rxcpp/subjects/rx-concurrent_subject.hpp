@@ -0,0 +1,516 @@
+// Copyright (c) Microsoft Open Technologies, Inc. All rights reserved. See License.txt in the project root for license information.
+
+#pragma once
+
+#if !defined(RXCPP_RX_SCHEDULER_CONCURRENT_SUBJECT_HPP)
+#define RXCPP_RX_SCHEDULER_CONCURRENT_SUBJECT_HPP
+
+#include "../rx-includes.hpp"
+
+namespace rxcpp {
+
+namespace subjects {
+
+namespace detail {
+
+// epoch based reclamation.
+// readers announce the epoch they entered in. a retired object is only
+// destroyed once the global epoch has moved two past the epoch it was
+// retired in, which cannot happen while any reader that might still
+// hold it is active.
+class epoch_domain
+{
+public:
+    struct record_type
+    {
+        record_type()
+            : in_use(true)
+            , epoch(0)
+            , next(nullptr)
+        {
+        }
+        std::atomic<bool> in_use;
+        // 0 when the owner is not inside a read section
+        std::atomic<std::uint64_t> epoch;
+        record_type* next;
+        // keep records from sharing a cache line
+        char pad[64];
+    };
+
+private:
+    struct retired_type
+    {
+        void* p;
+        void (*destroy)(void*);
+        std::uint64_t epoch;
+    };
+
+    template<class T>
+    static void destroy(void* p) {
+        delete static_cast<T*>(p);
+    }
+
+    std::atomic<std::uint64_t> global;
+    std::atomic<record_type*> records;
+
+    std::mutex lock;
+    std::vector<retired_type> retired;
+
+    epoch_domain()
+        : global(1)
+        , records(nullptr)
+    {
+    }
+
+    record_type* acquire() {
+        for (auto r = records.load(); r != nullptr; r = r->next) {
+            bool expected = false;
+            if (!r->in_use.load(std::memory_order_relaxed) &&
+                r->in_use.compare_exchange_strong(expected, true)) {
+                return r;
+            }
+        }
+        auto r = new record_type();
+        auto head = records.load();
+        do {
+            r->next = head;
+        } while (!records.compare_exchange_weak(head, r));
+        return r;
+    }
+
+    // must be called with lock held
+    bool try_advance() {
+        auto e = global.load();
+        for (auto r = records.load(); r != nullptr; r = r->next) {
+            auto re = r->epoch.load();
+            if (re != 0 && re != e) {
+                return false;
+            }
+        }
+        return global.compare_exchange_strong(e, e + 1);
+    }
+
+public:
+    static epoch_domain& instance() {
+        // never destroyed, readers on other threads may outlive static destruction
+        static epoch_domain* domain = new epoch_domain();
+        return *domain;
+    }
+
+    record_type* enter() {
+        static RXCPP_THREAD_LOCAL record_type* hint;
+        auto r = hint;
+        bool expected = false;
+        if (!r || !r->in_use.compare_exchange_strong(expected, true)) {
+            r = acquire();
+            hint = r;
+        }
+        r->epoch.store(global.load());
+        return r;
+    }
+
+    void leave(record_type* r) {
+        r->epoch.store(0, std::memory_order_release);
+        r->in_use.store(false, std::memory_order_release);
+    }
+
+    template<class T>
+    void retire(T* p) {
+        if (!p) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            retired_type item = {p, &destroy<T>, global.load()};
+            retired.push_back(item);
+        }
+        collect();
+    }
+
+    void collect() {
+        std::vector<retired_type> expired;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (retired.empty()) {
+                return;
+            }
+            try_advance();
+            auto e = global.load();
+            auto split = std::partition(retired.begin(), retired.end(),
+                [e](const retired_type& item){
+                    return item.epoch + 2 > e;
+                });
+            expired.assign(split, retired.end());
+            retired.erase(split, retired.end());
+        }
+        // destroy outside the lock, destructors may retire more objects
+        for (auto& item : expired) {
+            item.destroy(item.p);
+        }
+    }
+};
+
+class epoch_guard
+{
+    epoch_domain& domain;
+    epoch_domain::record_type* record;
+
+    epoch_guard(const epoch_guard&);
+    epoch_guard& operator=(const epoch_guard&);
+
+public:
+    explicit epoch_guard(epoch_domain& d)
+        : domain(d)
+        , record(d.enter())
+    {
+    }
+    ~epoch_guard()
+    {
+        domain.leave(record);
+    }
+};
+
+// append-only array of observers. slots below count are immutable
+// once published, so readers only need an acquire load of count.
+template<class Observer>
+struct observer_snapshot
+{
+    typedef typename std::aligned_storage<sizeof(Observer), std::alignment_of<Observer>::value>::type storage_type;
+
+    explicit observer_snapshot(std::size_t c)
+        : capacity(c)
+        , count(0)
+        , slots(new storage_type[c])
+    {
+    }
+    ~observer_snapshot()
+    {
+        auto n = count.load();
+        for (std::size_t i = 0; i < n; ++i) {
+            get(i).~Observer();
+        }
+    }
+
+    Observer& get(std::size_t i) const {
+        return *reinterpret_cast<Observer*>(&slots[i]);
+    }
+
+    // must only be called by the single writer
+    void push_back(const Observer& o) {
+        auto n = count.load(std::memory_order_relaxed);
+        new (&slots[n]) Observer(o);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    std::size_t capacity;
+    std::atomic<std::size_t> count;
+    std::unique_ptr<storage_type[]> slots;
+
+private:
+    observer_snapshot(const observer_snapshot&);
+    observer_snapshot& operator=(const observer_snapshot&);
+};
+
+template<class T>
+class concurrent_multicast_observer
+    : public observer_base<T>
+{
+    typedef observer_base<T> base;
+    typedef subscriber<T> observer_type;
+    typedef observer_snapshot<observer_type> snapshot_type;
+
+    struct mode
+    {
+        enum type {
+            Invalid = 0,
+            Casting,
+            Completed,
+            Errored
+        };
+    };
+
+    // dead observers are dropped when the array has to grow, or once
+    // this many have unsubscribed and they are at least half of the array.
+    static const std::size_t compact_batch = 32;
+    static const std::size_t initial_capacity = 8;
+
+    struct state_type
+        : public std::enable_shared_from_this<state_type>
+    {
+        state_type()
+            : current(mode::Casting)
+            , snapshot(nullptr)
+            , dead(0)
+            , active(0)
+            , delivered(false)
+            , terminal(nullptr)
+        {
+        }
+        ~state_type()
+        {
+            // no reader can be active, each one holds a ref to this state
+            delete snapshot.load();
+            delete terminal;
+        }
+
+        // writers (add, compact, on_error, on_completed) take the lock.
+        // on_next only reads current and snapshot.
+        std::mutex lock;
+        std::atomic<int> current;
+        std::exception_ptr error;
+        std::atomic<snapshot_type*> snapshot;
+        std::atomic<std::size_t> dead;
+
+        // the on_next calls in progress, and the on_error or on_completed
+        // call that ends casting. the last of them to leave once casting
+        // has ended sends the on_error or on_completed, so it never
+        // overtakes an on_next that was already sending.
+        std::atomic<std::size_t> active;
+        std::atomic<bool> delivered;
+        // the observers to send on_error or on_completed to. written
+        // under lock before current leaves Casting.
+        snapshot_type* terminal;
+
+        void enter() {
+            ++active;
+        }
+
+        void leave() {
+            if (--active != 0 || current == mode::Casting) {
+                return;
+            }
+            bool expected = false;
+            if (!delivered.compare_exchange_strong(expected, true)) {
+                return;
+            }
+            auto s = terminal;
+            terminal = nullptr;
+            if (s) {
+                auto n = s->count.load();
+                for (std::size_t i = 0; i < n; ++i) {
+                    auto& o = s->get(i);
+                    if (!o.is_subscribed()) {
+                        continue;
+                    }
+                    if (current == mode::Errored) {
+                        o.on_error(error);
+                    } else {
+                        o.on_completed();
+                    }
+                }
+            }
+            epoch_domain::instance().retire(s);
+        }
+
+        void terminate(typename mode::type m, std::exception_ptr e) {
+            enter();
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if (current == mode::Casting) {
+                    error = e;
+                    terminal = snapshot.exchange(nullptr);
+                    current = m;
+                }
+            }
+            leave();
+        }
+
+        // must be called with lock held
+        snapshot_type* copy_live(snapshot_type* old, std::size_t extra) {
+            std::size_t live = 0;
+            auto n = old ? old->count.load() : 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                if (old->get(i).is_subscribed()) {
+                    ++live;
+                }
+            }
+            auto capacity = (live + extra) * 2;
+            if (capacity < initial_capacity) {
+                capacity = initial_capacity;
+            }
+            auto next = new snapshot_type(capacity);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (old->get(i).is_subscribed()) {
+                    next->push_back(old->get(i));
+                }
+            }
+            dead = 0;
+            return next;
+        }
+
+        void compact() {
+            snapshot_type* old = nullptr;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                auto s = snapshot.load();
+                if (current != mode::Casting || !s || !should_compact(s)) {
+                    return;
+                }
+                old = snapshot.exchange(copy_live(s, 0));
+            }
+            epoch_domain::instance().retire(old);
+        }
+
+        bool should_compact(snapshot_type* s) const {
+            auto d = dead.load();
+            return d >= compact_batch && d * 2 >= s->count.load();
+        }
+
+        void on_unsubscribe() {
+            ++dead;
+            auto s = snapshot.load();
+            if (s && should_compact(s)) {
+                compact();
+            }
+        }
+    };
+
+    std::shared_ptr<state_type> state;
+
+public:
+    concurrent_multicast_observer()
+        : state(std::make_shared<state_type>())
+    {
+    }
+    bool has_observers() const {
+        epoch_guard guard(epoch_domain::instance());
+        auto s = state->snapshot.load();
+        if (!s) {
+            return false;
+        }
+        // unsubscribed observers keep their slots until the array is compacted
+        auto n = s->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (s->get(i).is_subscribed()) {
+                return true;
+            }
+        }
+        return false;
+    }
+    void add(observer_type o) const {
+        snapshot_type* old = nullptr;
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            switch (state->current) {
+            case mode::Casting:
+                {
+                    if (!o.is_subscribed()) {
+                        return;
+                    }
+                    auto s = state->snapshot.load();
+                    if (s && s->count.load() < s->capacity) {
+                        // readers never look past count, so appending in place is safe
+                        s->push_back(o);
+                    } else {
+                        auto next = state->copy_live(s, 1);
+                        next->push_back(o);
+                        old = state->snapshot.exchange(next);
+                    }
+                }
+                break;
+            case mode::Completed:
+                {
+                    guard.unlock();
+                    o.on_completed();
+                    return;
+                }
+                break;
+            case mode::Errored:
+                {
+                    auto e = state->error;
+                    guard.unlock();
+                    o.on_error(e);
+                    return;
+                }
+                break;
+            default:
+                abort();
+            }
+        }
+        epoch_domain::instance().retire(old);
+
+        std::weak_ptr<state_type> weak = state;
+        o.add(make_subscription([weak](){
+            auto s = weak.lock();
+            if (s) {
+                s->on_unsubscribe();
+            }
+        }));
+    }
+    template<class V>
+    void on_next(V&& v) const {
+        if (state->current.load(std::memory_order_relaxed) != mode::Casting) {
+            return;
+        }
+        state->enter();
+        RXCPP_UNWIND_AUTO([this](){
+            state->leave();
+        });
+        // checked again after entering, casting ends either before this
+        // or after this call leaves
+        if (state->current != mode::Casting) {
+            return;
+        }
+        epoch_guard guard(epoch_domain::instance());
+        auto s = state->snapshot.load();
+        if (!s) {
+            return;
+        }
+        // the observers before the last only read the value, the last may take it
+        const auto& shared = v;
+        auto n = s->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto& o = s->get(i);
+            if (!o.is_subscribed()) {
+                continue;
+            }
+            if (i + 1 == n) {
+                o.on_next(std::forward<V>(v));
+            } else {
+                o.on_next(shared);
+            }
+        }
+    }
+    void on_error(std::exception_ptr e) const {
+        state->terminate(mode::Errored, e);
+    }
+    void on_completed() const {
+        state->terminate(mode::Completed, std::exception_ptr());
+    }
+};
+
+}
+
+// a subject that allows on_next to be called from several threads at
+// once. each observer may receive concurrent on_next calls from those
+// threads and must be safe for that.
+template<class T>
+class concurrent_subject
+{
+    detail::concurrent_multicast_observer<T> s;
+
+public:
+    concurrent_subject()
+    {
+    }
+
+    bool has_observers() const {
+        return s.has_observers();
+    }
+
+    subscriber<T, observer<T, detail::concurrent_multicast_observer<T>>> get_subscriber(composite_subscription cs = composite_subscription()) const {
+        return make_subscriber<T>(cs, observer<T, detail::concurrent_multicast_observer<T>>(s));
+    }
+    observable<T> get_observable() const {
+        auto keepAlive = s;
+        return make_dynamic_observable<T>([keepAlive](subscriber<T> o){
+            keepAlive.add(std::move(o));
+        });
+    }
+};
+
+}
+
+}
+
+#endif
@@ -88,6 +88,100 @@ class multicast_observer
 
         // must only be accessed under state->lock
         mutable std::shared_ptr<completer_type> completer;
+
+        // must only be called from the thread that calls on_next
+        const std::shared_ptr<completer_type>& current() const {
+            if (current_generation != state->generation) {
+                std::unique_lock<std::mutex> guard(state->lock);
+                if (!completer) {
+                    static const std::shared_ptr<completer_type> none;
+                    return none;
+                }
+                current_generation = state->generation;
+                current_completer = completer;
+            }
+            return current_completer;
+        }
+
+        std::shared_ptr<completer_type> locked() const {
+            std::unique_lock<std::mutex> guard(state->lock);
+            return completer;
+        }
+    };
+
+    // the credit of the source that calls on_next. the source may
+    // only send a value once every observer has credit for it.
+    struct demand_type
+        : public rxcpp::detail::regulator_state_type
+    {
+        typedef rxcpp::detail::regulator_state_type base_type;
+
+        explicit demand_type(std::shared_ptr<binder_type> binder)
+            : b(std::move(binder))
+        {
+        }
+
+        static bool has_credit(const std::shared_ptr<completer_type>& c) {
+            if (!c) {
+                return true;
+            }
+            for (auto& o : c->observers) {
+                if (o.is_subscribed() && !o.is_resumed()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        virtual bool is_resumed() {
+            return has_credit(b->current());
+        }
+        virtual bool try_consume() {
+            auto& c = b->current();
+            if (!has_credit(c)) {
+                return false;
+            }
+            if (c) {
+                for (auto& o : c->observers) {
+                    if (o.is_subscribed()) {
+                        o.get_resumption().try_consume();
+                    }
+                }
+            }
+            return true;
+        }
+        virtual void resume_with(rxsc::schedulable rw) {
+            base_type::resume_with(rw);
+
+            // each observer that has no credit wakes the source
+            // when it is given more
+            std::weak_ptr<base_type> weak = this->shared_from_this();
+            auto& c = b->current();
+            if (!c) {
+                return;
+            }
+            for (auto& o : c->observers) {
+                if (o.is_subscribed() && !o.is_resumed()) {
+                    o.resume_with(rxsc::make_schedulable(rw.get_scheduler(), rw.get_subscription(), [weak](const rxsc::schedulable&){
+                        auto d = std::static_pointer_cast<demand_type>(weak.lock());
+                        if (d && has_credit(d->b->locked())) {
+                            d->wake();
+                        }
+                    }));
+                }
+            }
+        }
+        virtual void request(std::uint64_t n) {
+            auto c = b->locked();
+            if (!c) {
+                return;
+            }
+            for (auto& o : c->observers) {
+                o.get_resumption().request(n);
+            }
+        }
+
+        std::shared_ptr<binder_type> b;
     };
 
     std::shared_ptr<binder_type> b;
@@ -137,22 +231,27 @@ public:
             abort();
         }
     }
+    resumption make_resumption() const {
+        return resumption(std::make_shared<demand_type>(b));
+    }
     template<class V>
     void on_next(V&& v) const {
-        if (b->current_generation != b->state->generation) {
-            std::unique_lock<std::mutex> guard(b->state->lock);
-            if (!b->completer) {
-                return;
-            }
-            b->current_generation = b->state->generation;
-            b->current_completer = b->completer;
-        }
-        if (!b->current_completer || b->current_completer->observers.empty()) {
+        auto& c = b->current();
+        if (!c || c->observers.empty()) {
             return;
         }
-        for (auto& o : b->current_completer->observers) {
-            if (o.is_subscribed()) {
+        // the observers before the last only read the value, the last may take it
+        const auto& shared = v;
+        auto remaining = c->observers.size();
+        for (auto& o : c->observers) {
+            if (!o.is_subscribed()) {
+                --remaining;
+                continue;
+            }
+            if (--remaining == 0) {
                 o.on_next(std::forward<V>(v));
+            } else {
+                o.on_next(shared);
             }
         }
     }
@@ -211,7 +310,7 @@ public:
     }
 
     subscriber<T, observer<T, detail::multicast_observer<T>>> get_subscriber(composite_subscription cs = composite_subscription()) const {
-        return make_subscriber<T>(cs, observer<T, detail::multicast_observer<T>>(s));
+        return make_subscriber<T>(cs, s.make_resumption(), observer<T, detail::multicast_observer<T>>(s));
     }
     observable<T> get_observable() const {
         return make_dynamic_observable<T>([this](subscriber<T> o){
@@ -0,0 +1,254 @@
+#define RXCPP_USE_OBSERVABLE_MEMBERS 1
+
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxo=rxcpp::operators;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+namespace rxsub=rxcpp::subjects;
+namespace rxn=rxcpp::notifications;
+
+#include "rxcpp/rx-test.hpp"
+namespace rxt=rxcpp::test;
+
+#include "catch.hpp"
+
+namespace {
+
+std::vector<int> ints(std::initializer_list<int> il) {
+    return std::vector<int>(il);
+}
+
+// a buffer and the virtual time it arrived
+typedef std::pair<long, std::vector<int>> timed_buffer;
+
+}
+
+SCENARIO("buffer test", "[hide][buffer][operators][perf]"){
+    GIVEN("a range of ten million ints"){
+        WHEN("it is buffered"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int count = 10000000;
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .buffer(1024)
+                    .subscribe([&](const std::vector<int>& b){sum += b.back();});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "buffer : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+            {
+                long long sum = 0;
+                rxo::buffer_pool<int> pool(4);
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .buffer(1024, pool)
+                    .subscribe([&](std::vector<int> b){
+                        sum += b.back();
+                        pool.recycle(std::move(b));
+                    });
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "buffer with pool : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
+
+SCENARIO("buffer by count", "[buffer][operators]"){
+    GIVEN("a range of five ints"){
+        auto xs = rxs::range<int>(1, 5);
+
+        WHEN("buffered by two"){
+            std::vector<std::vector<int>> got;
+            bool completed = false;
+            xs
+                .buffer(2)
+                .subscribe(
+                    [&](std::vector<int> b){got.push_back(std::move(b));},
+                    [&](){completed = true;});
+
+            THEN("the last buffer holds the values that are left"){
+                std::vector<int> required[] = {ints({1, 2}), ints({3, 4}), ints({5})};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(completed);
+            }
+        }
+
+        WHEN("buffered by three, skipping one"){
+            std::vector<std::vector<int>> got;
+            xs
+                >> rxo::buffer(3, 1)
+                >> rxo::subscribe<std::vector<int>>([&](std::vector<int> b){got.push_back(std::move(b));});
+
+            THEN("the buffers overlap"){
+                std::vector<int> required[] = {ints({1, 2, 3}), ints({2, 3, 4}), ints({3, 4, 5}), ints({4, 5}), ints({5})};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("buffered by two, skipping three"){
+            std::vector<std::vector<int>> got;
+            xs
+                .buffer(2, 3)
+                .subscribe([&](std::vector<int> b){got.push_back(std::move(b));});
+
+            THEN("the values between the buffers are left out"){
+                std::vector<int> required[] = {ints({1, 2}), ints({4, 5})};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("buffered from a pool"){
+            rxo::buffer_pool<int> pool(2);
+            std::vector<const int*> storage;
+            std::vector<std::size_t> capacity;
+            xs
+                .buffer(2, pool)
+                .subscribe([&](std::vector<int> b){
+                    storage.push_back(b.data());
+                    capacity.push_back(b.capacity());
+                    pool.recycle(std::move(b));
+                });
+
+            THEN("each buffer reuses the storage of the one before"){
+                REQUIRE(storage.size() == 3);
+                REQUIRE(storage[1] == storage[0]);
+                REQUIRE(storage[2] == storage[0]);
+                REQUIRE(capacity[0] == 2);
+                REQUIRE(pool.size() == 1);
+            }
+        }
+    }
+
+    GIVEN("a count or skip of zero"){
+        auto xs = rxs::range<int>(1, 5);
+
+        THEN("the buffer is rejected"){
+            REQUIRE_THROWS_AS(xs.buffer(0), std::invalid_argument);
+            REQUIRE_THROWS_AS(xs.buffer(2, 0), std::invalid_argument);
+            REQUIRE_THROWS_AS(rxo::buffer(0), std::invalid_argument);
+            REQUIRE_THROWS_AS(rxo::buffer(2, 0), std::invalid_argument);
+            REQUIRE_THROWS_AS(xs.buffer_with_time_or_count(std::chrono::seconds(1), 0, rxsc::make_current_thread()), std::invalid_argument);
+            REQUIRE_THROWS_AS(rxo::buffer_with_time_or_count(std::chrono::seconds(1), 0, rxsc::make_current_thread()), std::invalid_argument);
+        }
+    }
+
+    GIVEN("a regulated range"){
+        rx::regulator r(0);
+        std::vector<std::vector<int>> got;
+        rxs::range<int>(0, 7)
+            .buffer(3)
+            .subscribe(
+                r.get_resumption(),
+                [&](std::vector<int> b){got.push_back(std::move(b));});
+
+        WHEN("one buffer is requested"){
+            r.request(1);
+
+            THEN("one buffer arrives"){
+                std::vector<int> required[] = {ints({0, 1, 2})};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+    }
+}
+
+SCENARIO("buffer by time", "[buffer][operators]"){
+    GIVEN("a test hot observable of ints"){
+        auto sc = rxsc::make_test();
+        typedef rxsc::test::messages<int> m;
+        typedef m::recorded_type record;
+        auto on_next = m::on_next;
+        auto on_completed = m::on_completed;
+
+        record messages[] = {
+            on_next(150, 0),
+            on_next(210, 1),
+            on_next(240, 2),
+            on_next(290, 3),
+            on_next(350, 4),
+            on_next(520, 5),
+            on_completed(600)
+        };
+        auto xs = sc.make_hot_observable(messages);
+        auto period = rxsc::test::clock_type::duration(100);
+
+        std::vector<timed_buffer> got;
+        auto record_buffer = [&](std::vector<int> b){
+            got.push_back(timed_buffer(static_cast<long>(sc.now().time_since_epoch().count()), std::move(b)));
+        };
+        auto completed = 0L;
+        auto record_completed = [&](){
+            completed = static_cast<long>(sc.now().time_since_epoch().count());
+        };
+
+        WHEN("buffered every 100 ticks"){
+            sc.schedule_absolute(rxsc::test::subscribed_time, [&](const rxsc::schedulable&){
+                xs
+                    .buffer_with_time(period, sc)
+                    .subscribe(record_buffer, record_completed);
+            });
+            sc.start();
+
+            THEN("each period closes a buffer, empty or not"){
+                timed_buffer required[] = {
+                    timed_buffer(300, ints({1, 2, 3})),
+                    timed_buffer(400, ints({4})),
+                    timed_buffer(500, ints({})),
+                    timed_buffer(600, ints({5}))
+                };
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(completed == 600);
+            }
+        }
+
+        WHEN("buffered every 100 ticks or two values"){
+            sc.schedule_absolute(rxsc::test::subscribed_time, [&](const rxsc::schedulable&){
+                xs
+                    >> rxo::buffer_with_time_or_count(period, 2, sc)
+                    >> rxo::subscribe<std::vector<int>>(record_buffer, record_completed);
+            });
+            sc.start();
+
+            THEN("a full buffer starts the next period"){
+                timed_buffer required[] = {
+                    timed_buffer(240, ints({1, 2})),
+                    timed_buffer(340, ints({3})),
+                    timed_buffer(440, ints({4})),
+                    timed_buffer(540, ints({5}))
+                };
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(completed == 600);
+            }
+        }
+    }
+
+    GIVEN("a subject buffered by a long period or two values on a timer_wheel"){
+        auto wheel = std::make_shared<rxsc::timer_wheel>();
+        rxsc::scheduler sc(std::static_pointer_cast<rxsc::scheduler_interface>(wheel));
+        rxsub::subject<int> sub;
+        std::vector<std::vector<int>> got;
+        rx::composite_subscription cs;
+        sub.get_observable()
+            .buffer_with_time_or_count(std::chrono::hours(1), 2, sc)
+            .subscribe(cs, [&](std::vector<int> b){got.push_back(std::move(b));});
+
+        WHEN("every buffer is closed by count"){
+            auto o = sub.get_subscriber();
+            for (int i = 0; i < 10; ++i) {
+                o.on_next(i);
+            }
+
+            THEN("only the timer of the open buffer is waiting"){
+                REQUIRE(got.size() == 5);
+                REQUIRE(wheel->pending() == 1);
+                cs.unsubscribe();
+                REQUIRE(wheel->pending() == 0);
+            }
+        }
+    }
+}
@@ -301,3 +301,162 @@ SCENARIO("flat_map inner error", "[flat_map][map][operators]"){
         }
     }
 }
+
+SCENARIO("flat_map max_concurrent", "[flat_map][map][operators]"){
+    GIVEN("two cold observables. one of ints. one of strings."){
+        auto sc = rxsc::make_test();
+        typedef rxsc::test::messages<int> m;
+        typedef rxsc::test::messages<std::string> ms;
+        typedef rxn::subscription life;
+
+        typedef m::recorded_type irecord;
+        auto ion_next = m::on_next;
+        auto ion_completed = m::on_completed;
+        auto isubscribe = m::subscribe;
+
+        typedef ms::recorded_type srecord;
+        auto son_next = ms::on_next;
+        auto son_completed = ms::on_completed;
+        auto ssubscribe = ms::subscribe;
+
+        irecord int_messages[] = {
+            ion_next(100, 4),
+            ion_next(200, 2),
+            ion_next(300, 3),
+            ion_next(400, 1),
+            ion_completed(500)
+        };
+        auto xs = sc.make_cold_observable(int_messages);
+
+        srecord string_messages[] = {
+            son_next(50, "foo"),
+            son_next(100, "bar"),
+            son_next(150, "baz"),
+            son_next(200, "qux"),
+            son_completed(250)
+        };
+        auto ys = sc.make_cold_observable(string_messages);
+
+        WHEN("each int is mapped to the strings with at most two active"){
+
+            auto res = sc.start<std::string>(
+                [&]() {
+                    return xs
+                        .flat_map(
+                            [&](int){
+                                return ys;},
+                            [](int, std::string s){
+                                return s;},
+                            2)
+                        // forget type to workaround lambda deduction bug on msvc 2013
+                        .as_dynamic();
+                }
+            );
+
+            THEN("the output contains strings repeated for each int"){
+                srecord items[] = {
+                    son_next(350, "foo"),
+                    son_next(400, "bar"),
+                    son_next(450, "baz"),
+                    son_next(450, "foo"),
+                    son_next(500, "qux"),
+                    son_next(500, "bar"),
+                    son_next(550, "baz"),
+                    son_next(600, "qux"),
+                    son_next(600, "foo"),
+                    son_next(650, "bar"),
+                    son_next(700, "foo"),
+                    son_next(700, "baz"),
+                    son_next(750, "bar"),
+                    son_next(750, "qux"),
+                    son_next(800, "baz"),
+                    son_next(850, "qux"),
+                    son_completed(900)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = res.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+            THEN("there was one subscription and one unsubscription to the ints"){
+                life items[] = {
+                    isubscribe(200, 700)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = xs.subscriptions();
+                REQUIRE(required == actual);
+            }
+
+            THEN("the waiting strings were subscribed as the active ones completed"){
+                life items[] = {
+                    ssubscribe(300, 550),
+                    ssubscribe(400, 650),
+                    ssubscribe(550, 800),
+                    ssubscribe(650, 900)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = ys.subscriptions();
+                REQUIRE(required == actual);
+            }
+        }
+    }
+}
+
+SCENARIO("flat_map inner sources on different threads", "[flat_map][map][operators]"){
+    GIVEN("subjects driven from their own threads"){
+        const int producers = 4;
+        const int onnextcalls = 10000;
+
+        std::vector<rxsub::subject<int>> inners(producers);
+
+        WHEN("the subjects are merged with flat_map"){
+
+            std::atomic<int> inside(0);
+            int count = 0;
+            int completions = 0;
+            bool overlapped = false;
+
+            rxs::range<int>(0, producers)
+                .flat_map(
+                    [&](int i){
+                        return inners[i].get_observable();},
+                    [](int, int v){
+                        return v;})
+                .subscribe(
+                    [&](int){
+                        if (++inside != 1) {
+                            overlapped = true;
+                        }
+                        ++count;
+                        --inside;
+                    },
+                    [](std::exception_ptr){abort();},
+                    [&](){
+                        ++completions;
+                    });
+
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++) {
+                auto o = inners[p].get_subscriber();
+                threads.push_back(std::thread([o, onnextcalls](){
+                    for (int i = 0; i < onnextcalls; i++) {
+                        o.on_next(i);
+                    }
+                    o.on_completed();
+                }));
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+
+            THEN("the output was never called concurrently"){
+                REQUIRE(!overlapped);
+            }
+
+            THEN("the output received every value and completed once"){
+                REQUIRE(count == producers * onnextcalls);
+                REQUIRE(completions == 1);
+            }
+        }
+    }
+}
@@ -81,3 +81,238 @@ SCENARIO("map stops on completion", "[map][operators]"){
         }
     }
 }
+
+namespace {
+template<class Observable>
+struct source_operator_of;
+template<class T, class SourceOperator>
+struct source_operator_of<rx::observable<T, SourceOperator>>
+{
+    typedef SourceOperator type;
+};
+}
+
+SCENARIO("map and filter chains are fused", "[map][filter][operators]"){
+    GIVEN("a range of ints"){
+        auto xs = rxs::range<int>(1, 10);
+        // the stages run inside the loop of the range
+        typedef rxs::detail::range<int> source_type;
+
+        WHEN("maps and filters are chained with members and with >>"){
+            auto times3 = [](int x){return x * 3;};
+            auto even = [](int x){return x % 2 == 0;};
+            auto show = [](int x){return std::to_string(x);};
+
+            auto members = xs.map(times3).filter(even).map(show);
+            auto piped = xs >> rxo::map(times3) >> rxo::filter(even) >> rxo::map(show);
+
+            typedef typename source_operator_of<decltype(members)>::type members_type;
+            typedef typename source_operator_of<decltype(piped)>::type piped_type;
+
+            THEN("each chain is one operator over the range"){
+                static_assert(std::is_same<typename members_type::source_type, source_type>::value, "the stages must be fused into one operator");
+                static_assert(std::is_same<typename piped_type::source_type, source_type>::value, "the stages must be fused into one operator");
+                static_assert(std::is_same<typename members_type::value_type, std::string>::value, "the last stage must select the value_type");
+            }
+
+            THEN("the stages run in order"){
+                std::vector<std::string> got;
+                members.subscribe([&](std::string s){got.push_back(s);});
+                piped.subscribe([&](std::string s){got.push_back(s);});
+                std::string required[] = {"6", "12", "18", "24", "30", "6", "12", "18", "24", "30"};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("a stage in the middle throws"){
+            long after = 0;
+            std::vector<int> got;
+            std::exception_ptr error;
+            xs
+                .map([](int x){return x + 1;})
+                .filter([](int x){
+                    if (x == 4) {
+                        throw std::runtime_error("filter failed");
+                    }
+                    return true;
+                })
+                .map([&after](int x){++after; return x;})
+                .subscribe(
+                    [&](int x){got.push_back(x);},
+                    [&](std::exception_ptr e){error = e;});
+
+            THEN("the later stages are skipped and the output receives the error"){
+                int required[] = {2, 3};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(after == 2);
+                REQUIRE(!!error);
+            }
+        }
+
+        WHEN("a fused chain is subscribed with limited credit"){
+            rx::regulator r(2);
+            std::vector<int> got;
+            xs
+                .filter([](int x){return x % 3 == 0;})
+                .map([](int x){return x * 10;})
+                .subscribe(
+                    r.get_resumption(),
+                    [&](int x){got.push_back(x);});
+
+            THEN("dropped values are replaced, so the credit is spent on delivered values"){
+                int required[] = {30, 60};
+                REQUIRE(got == rxu::to_vector(required));
+                r.request(10);
+                REQUIRE(got.size() == 3);
+            }
+        }
+    }
+}
+
+namespace {
+// counts the copies and moves of all its instances
+struct counted
+{
+    static int copies;
+    static int moves;
+    static void reset() {
+        copies = 0;
+        moves = 0;
+    }
+
+    explicit counted(int v)
+        : value(v)
+    {
+    }
+    counted(const counted& o)
+        : value(o.value)
+    {
+        ++copies;
+    }
+    counted(counted&& o)
+        : value(o.value)
+    {
+        ++moves;
+    }
+    counted& operator=(const counted& o) {
+        value = o.value;
+        ++copies;
+        return *this;
+    }
+    counted& operator=(counted&& o) {
+        value = o.value;
+        ++moves;
+        return *this;
+    }
+
+    int value;
+};
+int counted::copies = 0;
+int counted::moves = 0;
+}
+
+SCENARIO("values move through map and filter chains", "[map][filter][operators]"){
+    GIVEN("a subject of counted values"){
+        rxsub::subject<counted> sub;
+        auto o = sub.get_subscriber();
+
+        // five stages that take the value by value, by const reference,
+        // make a new value and pass it through
+        auto chain = sub.get_observable()
+            .map([](counted c){ c.value += 1; return c; })
+            .filter([](const counted& c){ return c.value % 2 == 0; })
+            .map([](const counted& c){ return counted(c.value * 10); })
+            .filter([](const counted& c){ return c.value > 0; })
+            .map([](counted c){ c.value += 1; return c; });
+
+        WHEN("one observer receives the values"){
+            std::vector<int> got;
+            chain.subscribe([&](const counted& c){ got.push_back(c.value); });
+
+            counted::reset();
+            for (int i = 0; i < 4; ++i) {
+                o.on_next(counted(i));
+            }
+            o.on_completed();
+
+            THEN("the values are not copied"){
+                int required[] = {21, 41};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(counted::copies == 0);
+                REQUIRE(counted::moves > 0);
+            }
+        }
+
+        WHEN("the chain is type-forgotten"){
+            std::vector<int> got;
+            chain.as_dynamic().subscribe([&](counted c){ got.push_back(c.value); });
+
+            counted::reset();
+            for (int i = 0; i < 4; ++i) {
+                o.on_next(counted(i));
+            }
+            o.on_completed();
+
+            THEN("the values are still only moved"){
+                int required[] = {21, 41};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(counted::copies == 0);
+            }
+        }
+
+        WHEN("two observers receive the values"){
+            std::vector<int> got;
+            chain.subscribe([&](const counted& c){ got.push_back(c.value); });
+            chain.subscribe([&](const counted& c){ got.push_back(c.value); });
+
+            counted::reset();
+            for (int i = 0; i < 4; ++i) {
+                o.on_next(counted(i));
+            }
+            o.on_completed();
+
+            THEN("each value is copied once, for the observer that cannot take it"){
+                int required[] = {21, 21, 41, 41};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(counted::copies == 4);
+            }
+        }
+    }
+}
+
+SCENARIO("map chain test", "[hide][map][operators][perf]"){
+    GIVEN("a range of a million ints"){
+        WHEN("ten small maps and filters are chained"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int count = 1000000;
+            auto inc = [](int x){return x + 1;};
+            auto odd = [](int x){return (x & 1) != 0;};
+            auto all = [](int){return true;};
+
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .map(inc).filter(all).map(inc).filter(all).map(inc)
+                    .filter(all).map(inc).filter(all).map(inc).filter(odd)
+                    .subscribe([&](int x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "fused chain of 10 : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+
+            {
+                // as_dynamic between the stages stops them being fused
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .map(inc).as_dynamic().filter(all).as_dynamic().map(inc).as_dynamic().filter(all).as_dynamic().map(inc).as_dynamic()
+                    .filter(all).as_dynamic().map(inc).as_dynamic().filter(all).as_dynamic().map(inc).as_dynamic().filter(odd)
+                    .subscribe([&](int x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "unfused chain of 10 : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
@@ -0,0 +1,254 @@
+#define RXCPP_USE_OBSERVABLE_MEMBERS 1
+
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxo=rxcpp::operators;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+namespace {
+
+// blocks until count() has been called n times
+class countdown
+{
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining;
+public:
+    explicit countdown(int n)
+        : remaining(n)
+    {
+    }
+    void count() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return done.wait_for(guard, timeout, [this](){return remaining <= 0;});
+    }
+};
+
+// blocks the actions that wait on it until it is opened
+class gate
+{
+    std::mutex lock;
+    std::condition_variable opened;
+    bool isOpen;
+public:
+    gate()
+        : isOpen(false)
+    {
+    }
+    void open() {
+        std::unique_lock<std::mutex> guard(lock);
+        isOpen = true;
+        opened.notify_all();
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return opened.wait_for(guard, timeout, [this](){return isOpen;});
+    }
+};
+
+}
+
+SCENARIO("observe_on test", "[hide][observe_on][operators][perf]"){
+    GIVEN("a range observed on a thread_pool"){
+        WHEN("a million ints hop threads"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int count = 1000000;
+            auto sc = rxsc::make_thread_pool(1);
+
+            {
+                // one scheduled action per value, as observers did before observe_on
+                countdown finished(count);
+                int received = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .subscribe([&](int){
+                        rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                            ++received;
+                            finished.count();
+                        });
+                    });
+                finished.wait(milliseconds(600000));
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "schedule per value : " << received << " on_next calls, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+
+            for (std::size_t capacity = 16; capacity <= 4096; capacity *= 16) {
+                countdown finished(1);
+                int received = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .observe_on(sc, capacity)
+                    .subscribe(
+                        [&](int){++received;},
+                        [&](){finished.count();});
+                finished.wait(milliseconds(600000));
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "observe_on(" << capacity << ") : " << received << " on_next calls, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
+
+SCENARIO("observe_on delivers on the scheduler", "[observe_on][operators]"){
+    GIVEN("a thread_pool"){
+        auto sc = rxsc::make_thread_pool(1);
+
+        WHEN("a range is observed on it"){
+            countdown finished(1);
+            std::vector<int> got;
+            std::atomic<bool> onSource(false);
+            auto source = std::this_thread::get_id();
+            rxs::range<int>(0, 1000)
+                .observe_on(sc, 16)
+                .subscribe(
+                    [&](int v){
+                        if (std::this_thread::get_id() == source) {
+                            onSource = true;
+                        }
+                        got.push_back(v);
+                    },
+                    [&](){finished.count();});
+
+            THEN("every value arrives in order on the other thread before on_completed"){
+                REQUIRE(finished.wait());
+                REQUIRE(!onSource);
+                REQUIRE(got.size() == 1000);
+                for (int i = 0; i < 1000; ++i) {
+                    REQUIRE(got[i] == i);
+                }
+            }
+        }
+
+        WHEN("the source fails"){
+            countdown finished(1);
+            int received = 0;
+            std::exception_ptr error;
+            rxs::range<int>(0, 10)
+                .map([](int v){
+                    if (v == 5) {
+                        throw std::runtime_error("five");
+                    }
+                    return v;
+                })
+                .observe_on(sc)
+                .subscribe(
+                    [&](int){++received;},
+                    [&](std::exception_ptr e){
+                        error = e;
+                        finished.count();
+                    });
+
+            THEN("the values before the error are delivered first"){
+                REQUIRE(finished.wait());
+                REQUIRE(received == 5);
+                REQUIRE(!!error);
+            }
+        }
+    }
+}
+
+SCENARIO("observe_on overflow policies", "[observe_on][operators]"){
+    GIVEN("a thread_pool that is busy while the source runs"){
+        auto sc = rxsc::make_thread_pool(1);
+        gate busy;
+        rxsc::schedule(sc, [&](const rxsc::schedulable&){
+            busy.wait();
+        });
+
+        const int count = 100;
+        const std::size_t capacity = 4;
+        countdown finished(1);
+        std::vector<int> got;
+        std::exception_ptr error;
+        auto subscribe = [&](rxo::overflow_policy::type policy){
+            rxs::range<int>(0, count)
+                .observe_on(sc, capacity, policy)
+                .subscribe(
+                    [&](int v){got.push_back(v);},
+                    [&](std::exception_ptr e){
+                        error = e;
+                        finished.count();
+                    },
+                    [&](){finished.count();});
+            busy.open();
+        };
+
+        WHEN("the newest values are dropped"){
+            subscribe(rxo::overflow_policy::drop_newest);
+            THEN("the first values are delivered"){
+                REQUIRE(finished.wait());
+                int required[] = {0, 1, 2, 3};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(!error);
+            }
+        }
+
+        WHEN("the oldest values are dropped"){
+            subscribe(rxo::overflow_policy::drop_oldest);
+            THEN("the last values are delivered"){
+                REQUIRE(finished.wait());
+                int required[] = {96, 97, 98, 99};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(!error);
+            }
+        }
+
+        WHEN("overflow is an error"){
+            subscribe(rxo::overflow_policy::error);
+            THEN("the queued values are delivered and then the error"){
+                REQUIRE(finished.wait());
+                int required[] = {0, 1, 2, 3};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(!!error);
+                bool overflowed = false;
+                try {
+                    std::rethrow_exception(error);
+                } catch(const std::overflow_error&) {
+                    overflowed = true;
+                }
+                REQUIRE(overflowed);
+            }
+        }
+    }
+
+    GIVEN("a slow observer"){
+        auto sc = rxsc::make_thread_pool(1);
+
+        WHEN("the source blocks"){
+            const int count = 200;
+            countdown finished(1);
+            std::vector<int> got;
+            std::thread producer([&](){
+                rxs::range<int>(0, count)
+                    .observe_on(sc, 4, rxo::overflow_policy::block)
+                    .subscribe(
+                        [&](int v){
+                            std::this_thread::sleep_for(std::chrono::microseconds(100));
+                            got.push_back(v);
+                        },
+                        [&](){finished.count();});
+            });
+
+            THEN("no value is lost"){
+                REQUIRE(finished.wait());
+                producer.join();
+                REQUIRE(got.size() == count);
+                for (int i = 0; i < count; ++i) {
+                    REQUIRE(got[i] == i);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+SCENARIO("current_thread test", "[hide][current_thread][schedulers][perf]"){
+    GIVEN("the current_thread scheduler"){
+        WHEN("scheduling many immediate actions"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int actions = 1000000;
+
+            auto sc = rxsc::make_current_thread();
+
+            int count = 0;
+            auto start = clock::now();
+            // one action fans out, the rest wait in the trampoline queue
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                for (int i = 0; i < actions; i++) {
+                    rxsc::schedule(self.get_scheduler(), [&count](const rxsc::schedulable&){
+                        ++count;
+                    });
+                }
+            });
+            auto finish = clock::now();
+            auto msElapsed = duration_cast<milliseconds>(finish - start);
+            std::cout << "current_thread queued    : " << count << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+
+            count = 0;
+            start = clock::now();
+            for (int i = 0; i < actions; i++) {
+                rxsc::schedule(sc, [&count](const rxsc::schedulable&){
+                    ++count;
+                });
+            }
+            finish = clock::now();
+            msElapsed = duration_cast<milliseconds>(finish - start);
+            std::cout << "current_thread outermost : " << count << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+        }
+    }
+}
+
+SCENARIO("current_thread order", "[current_thread][schedulers]"){
+    GIVEN("the current_thread scheduler"){
+        auto sc = rxsc::make_current_thread();
+        std::vector<int> order;
+        auto record = [&](int i){
+            return [&, i](const rxsc::schedulable&){
+                order.push_back(i);
+            };
+        };
+
+        WHEN("immediate actions are scheduled from an action"){
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                auto inner = self.get_scheduler();
+                for (int i = 1; i <= 5; i++) {
+                    rxsc::schedule(inner, record(i));
+                }
+                order.push_back(0);
+            });
+            THEN("they run after it, in the order they were scheduled"){
+                int required[] = {0, 1, 2, 3, 4, 5};
+                REQUIRE(order == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("timed and immediate actions are mixed"){
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                auto inner = self.get_scheduler();
+                auto now = inner.now();
+                rxsc::schedule(inner, now + std::chrono::milliseconds(20), record(4));
+                rxsc::schedule(inner, now + std::chrono::milliseconds(1), record(2));
+                rxsc::schedule(inner, record(1));
+                // the 1ms timer is due before the next action is scheduled
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                rxsc::schedule(inner, record(3));
+            });
+            THEN("they run in due order"){
+                int required[] = {1, 2, 3, 4};
+                REQUIRE(order == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("overdue timers are scheduled out of due order"){
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                auto inner = self.get_scheduler();
+                auto now = inner.now();
+                rxsc::schedule(inner, record(1));
+                rxsc::schedule(inner, now - std::chrono::milliseconds(5), record(3));
+                rxsc::schedule(inner, now - std::chrono::milliseconds(10), record(2));
+                rxsc::schedule(inner, now - std::chrono::milliseconds(1), record(4));
+                rxsc::schedule(inner, record(5));
+            });
+            THEN("they run in due order"){
+                int required[] = {1, 2, 3, 4, 5};
+                REQUIRE(order == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("a queued action is unsubscribed before it runs"){
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                auto inner = self.get_scheduler();
+                rx::composite_subscription cs;
+                rxsc::schedule(inner, cs, record(1));
+                rxsc::schedule(inner, record(2));
+                cs.unsubscribe();
+            });
+            THEN("it does not run"){
+                int required[] = {2};
+                REQUIRE(order == rxu::to_vector(required));
+            }
+        }
+    }
+}
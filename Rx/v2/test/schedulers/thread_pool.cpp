@@ -0,0 +1,381 @@
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+namespace {
+
+// blocks until count() has been called n times
+class countdown
+{
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining;
+public:
+    explicit countdown(int n)
+        : remaining(n)
+    {
+    }
+    void count() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return done.wait_for(guard, timeout, [this](){return remaining <= 0;});
+    }
+};
+
+}
+
+SCENARIO("thread_pool test", "[hide][thread_pool][schedulers][perf]"){
+    GIVEN("a thread_pool"){
+        WHEN("scheduling many short actions"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int actions = 1000000;
+            const int hops = 100000;
+
+            for (std::size_t n = 1; n <= std::max<std::size_t>(4, std::thread::hardware_concurrency()); n *= 2)
+            {
+                auto sc = rxsc::make_thread_pool(n);
+
+                {
+                    countdown finished(actions);
+                    auto start = clock::now();
+                    for (int i = 0; i < actions; i++) {
+                        rxsc::schedule(sc, [&finished](const rxsc::schedulable&){
+                            finished.count();
+                        });
+                    }
+                    finished.wait(milliseconds(600000));
+                    auto finish = clock::now();
+                    auto msElapsed = duration_cast<milliseconds>(finish - start);
+                    std::cout << "thread_pool(" << n << ") posted from outside  : " << actions << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+                }
+
+                {
+                    countdown finished(actions);
+                    auto start = clock::now();
+                    // one action fans out from inside the pool, idle workers steal
+                    rxsc::schedule(sc, [&finished, actions](const rxsc::schedulable& self){
+                        for (int i = 0; i < actions; i++) {
+                            rxsc::schedule(self.get_scheduler(), [&finished](const rxsc::schedulable&){
+                                finished.count();
+                            });
+                        }
+                    });
+                    finished.wait(milliseconds(600000));
+                    auto finish = clock::now();
+                    auto msElapsed = duration_cast<milliseconds>(finish - start);
+                    std::cout << "thread_pool(" << n << ") posted from worker   : " << actions << " actions, " << msElapsed.count() << "ms elapsed " << std::endl;
+                }
+
+                {
+                    clock::duration latency(0);
+                    for (int i = 0; i < hops; i++) {
+                        // post from outside the pool and wait, so every hop pays the wake-up
+                        countdown finished(1);
+                        auto posted = clock::now();
+                        rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                            latency += clock::now() - posted;
+                            finished.count();
+                        });
+                        finished.wait(milliseconds(600000));
+                    }
+                    std::cout << "thread_pool(" << n << ") post latency        : " << hops << " hops, " << duration_cast<nanoseconds>(latency).count() / hops << "ns average " << std::endl;
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("thread_pool runs actions", "[thread_pool][schedulers]"){
+    GIVEN("a thread_pool with several workers"){
+        auto sc = rxsc::make_thread_pool(4);
+
+        WHEN("actions are scheduled from outside the pool"){
+            const int actions = 1000;
+            countdown finished(actions);
+            std::atomic<int> count(0);
+            for (int i = 0; i < actions; i++) {
+                rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                    ++count;
+                    finished.count();
+                });
+            }
+            THEN("all of them run"){
+                REQUIRE(finished.wait());
+                REQUIRE(count == actions);
+            }
+        }
+
+        WHEN("actions are scheduled from inside the pool"){
+            const int actions = 1000;
+            countdown finished(actions);
+            std::atomic<int> count(0);
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                for (int i = 0; i < actions; i++) {
+                    rxsc::schedule(self.get_scheduler(), [&](const rxsc::schedulable&){
+                        ++count;
+                        finished.count();
+                    });
+                }
+            });
+            THEN("all of them run"){
+                REQUIRE(finished.wait());
+                REQUIRE(count == actions);
+            }
+        }
+
+        WHEN("an action is unsubscribed before it runs"){
+            countdown finished(1);
+            std::atomic<bool> ran(false);
+            rx::composite_subscription cs;
+            cs.unsubscribe();
+            rxsc::schedule(sc, cs, [&](const rxsc::schedulable&){
+                ran = true;
+            });
+            rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                finished.count();
+            });
+            THEN("it does not run"){
+                REQUIRE(finished.wait());
+                REQUIRE(!ran);
+            }
+        }
+    }
+}
+
+SCENARIO("thread_pool tail recursion", "[thread_pool][schedulers]"){
+    GIVEN("a thread_pool with several workers"){
+        auto sc = rxsc::make_thread_pool(4);
+
+        WHEN("an action recurses"){
+            const int iterations = 10000;
+            countdown finished(1);
+            int remaining = iterations;
+            std::thread::id first;
+            bool moved = false;
+            rxsc::schedule(sc, [&](const rxsc::schedulable& self){
+                if (remaining == iterations) {
+                    first = std::this_thread::get_id();
+                } else if (first != std::this_thread::get_id()) {
+                    moved = true;
+                }
+                if (--remaining == 0) {
+                    finished.count();
+                    return;
+                }
+                self();
+            });
+            THEN("every iteration runs on the same worker"){
+                REQUIRE(finished.wait());
+                REQUIRE(!moved);
+            }
+        }
+
+        WHEN("an action recurses while other work is queued on its worker"){
+            // a single worker, so nothing is stolen
+            auto single = rxsc::make_thread_pool(1);
+            const int iterations = 1000;
+            const int others = 100;
+            countdown finished(1 + others);
+            int remaining = iterations;
+            std::atomic<int> othersRun(0);
+            std::atomic<int> othersRunBeforeEnd(-1);
+            rxsc::schedule(single, [&](const rxsc::schedulable& self){
+                if (remaining == iterations) {
+                    for (int i = 0; i < others; i++) {
+                        rxsc::schedule(self.get_scheduler(), [&](const rxsc::schedulable&){
+                            ++othersRun;
+                            finished.count();
+                        });
+                    }
+                }
+                if (--remaining == 0) {
+                    othersRunBeforeEnd = othersRun.load();
+                    finished.count();
+                    return;
+                }
+                self();
+            });
+            THEN("the recursing action does not starve the rest"){
+                REQUIRE(finished.wait());
+                REQUIRE(othersRunBeforeEnd == others);
+            }
+        }
+    }
+}
+
+SCENARIO("thread_pool timed actions", "[thread_pool][schedulers]"){
+    GIVEN("a thread_pool"){
+        auto sc = rxsc::make_thread_pool(2);
+
+        WHEN("actions are scheduled for later"){
+            typedef rxsc::scheduler::clock_type clock;
+            countdown finished(3);
+            std::mutex lock;
+            std::vector<int> order;
+            std::vector<bool> late;
+            auto start = sc.now();
+            auto record = [&](int i, clock::time_point due){
+                return [&, i, due](const rxsc::schedulable&){
+                    std::unique_lock<std::mutex> guard(lock);
+                    order.push_back(i);
+                    late.push_back(clock::now() >= due);
+                    finished.count();
+                };
+            };
+            rxsc::schedule(sc, start + std::chrono::milliseconds(60), record(3, start + std::chrono::milliseconds(60)));
+            rxsc::schedule(sc, start + std::chrono::milliseconds(20), record(1, start + std::chrono::milliseconds(20)));
+            rxsc::schedule(sc, start + std::chrono::milliseconds(40), record(2, start + std::chrono::milliseconds(40)));
+
+            THEN("they run in due order and not early"){
+                REQUIRE(finished.wait());
+                std::unique_lock<std::mutex> guard(lock);
+                int required[] = {1, 2, 3};
+                REQUIRE(order == rxu::to_vector(required));
+                REQUIRE(std::count(late.begin(), late.end(), true) == 3);
+            }
+        }
+
+        WHEN("a timed action is unsubscribed before it is due"){
+            countdown finished(1);
+            std::atomic<bool> ran(false);
+            rx::composite_subscription cs;
+            rxsc::schedule(sc, cs, sc.now() + std::chrono::milliseconds(20), [&](const rxsc::schedulable&){
+                ran = true;
+            });
+            cs.unsubscribe();
+            rxsc::schedule(sc, sc.now() + std::chrono::milliseconds(40), [&](const rxsc::schedulable&){
+                finished.count();
+            });
+            THEN("it does not run"){
+                REQUIRE(finished.wait());
+                REQUIRE(!ran);
+            }
+        }
+
+        WHEN("the pool is released while a timer is far from due"){
+            auto pool = rxsc::make_thread_pool(2);
+            auto payload = std::make_shared<int>(0);
+            std::weak_ptr<int> watch = payload;
+            rxsc::schedule(pool, pool.now() + std::chrono::hours(1), [payload](const rxsc::schedulable&){});
+            payload.reset();
+            REQUIRE(!watch.expired());
+            pool = rxsc::scheduler();
+            THEN("the timer does not keep the pool alive"){
+                REQUIRE(watch.expired());
+            }
+        }
+    }
+}
+
+namespace {
+
+// blocks the actions that wait on it until it is opened
+class gate
+{
+    std::mutex lock;
+    std::condition_variable opened;
+    bool isOpen;
+public:
+    gate()
+        : isOpen(false)
+    {
+    }
+    void open() {
+        std::unique_lock<std::mutex> guard(lock);
+        isOpen = true;
+        opened.notify_all();
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return opened.wait_for(guard, timeout, [this](){return isOpen;});
+    }
+};
+
+}
+
+SCENARIO("thread_pool long actions", "[thread_pool][schedulers]"){
+    GIVEN("a thread_pool with one worker"){
+        auto pool = std::make_shared<rxsc::thread_pool>(1, 2);
+        rxsc::scheduler sc(std::static_pointer_cast<rxsc::scheduler_interface>(pool));
+
+        WHEN("a long action blocks"){
+            gate blocked;
+            countdown longFinished(1);
+            countdown shortFinished(100);
+            std::thread::id worker;
+            std::thread::id blocking;
+            rxsc::schedule(sc, rxsc::action_duration::runs_long, [&](const rxsc::schedulable&){
+                blocking = std::this_thread::get_id();
+                blocked.wait();
+                longFinished.count();
+            });
+            for (int i = 0; i < 100; i++) {
+                rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                    worker = std::this_thread::get_id();
+                    shortFinished.count();
+                });
+            }
+            THEN("the short actions run on the worker meanwhile"){
+                REQUIRE(shortFinished.wait());
+                blocked.open();
+                REQUIRE(longFinished.wait());
+                REQUIRE(worker != blocking);
+            }
+        }
+
+        WHEN("more long actions block than the blocking limit"){
+            gate blocked;
+            countdown started(2);
+            countdown finished(4);
+            for (int i = 0; i < 4; i++) {
+                rxsc::schedule(sc, rxsc::action_duration::runs_long, [&](const rxsc::schedulable&){
+                    started.count();
+                    blocked.wait();
+                    finished.count();
+                });
+            }
+            THEN("the rest wait in the long queue until a thread is free"){
+                REQUIRE(started.wait());
+                REQUIRE(pool->blocking_threads() == 2);
+                REQUIRE(pool->queue_depth(rxsc::action_duration::runs_long) == 2);
+                REQUIRE(pool->queue_depth(rxsc::action_duration::runs_short) == 0);
+                blocked.open();
+                REQUIRE(finished.wait());
+                REQUIRE(pool->queue_depth(rxsc::action_duration::runs_long) == 0);
+            }
+        }
+
+        WHEN("short actions queue behind a busy worker"){
+            gate blocked;
+            countdown started(1);
+            countdown finished(11);
+            rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                started.count();
+                blocked.wait();
+                finished.count();
+            });
+            REQUIRE(started.wait());
+            for (int i = 0; i < 10; i++) {
+                rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                    finished.count();
+                });
+            }
+            THEN("the short queue depth counts them"){
+                REQUIRE(pool->queue_depth(rxsc::action_duration::runs_short) == 10);
+                REQUIRE(pool->queue_depth(rxsc::action_duration::runs_long) == 0);
+                blocked.open();
+                REQUIRE(finished.wait());
+            }
+        }
+    }
+}
@@ -0,0 +1,191 @@
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+namespace {
+
+// blocks until count() has been called n times
+class countdown
+{
+    std::mutex lock;
+    std::condition_variable done;
+    int remaining;
+public:
+    explicit countdown(int n)
+        : remaining(n)
+    {
+    }
+    void count() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) {
+        std::unique_lock<std::mutex> guard(lock);
+        return done.wait_for(guard, timeout, [this](){return remaining <= 0;});
+    }
+};
+
+}
+
+SCENARIO("timer_wheel test", "[hide][timer_wheel][schedulers][perf]"){
+    GIVEN("schedulers with many pending timers"){
+        WHEN("scheduling and cancelling timeouts"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int timers = 1000000;
+
+            auto measure = [&](const char* name, rxsc::scheduler sc) {
+                std::vector<rx::composite_subscription> lifetimes(timers);
+                auto start = clock::now();
+                for (int i = 0; i < timers; i++) {
+                    // spread over ten minutes, like per request timeouts
+                    rxsc::schedule(sc, lifetimes[i], sc.now() + milliseconds(60000 + (i * 7919LL) % 540000), [](const rxsc::schedulable&){});
+                }
+                auto scheduled = clock::now();
+                for (auto& cs : lifetimes) {
+                    cs.unsubscribe();
+                }
+                auto cancelled = clock::now();
+                std::cout << name << " schedule : " << timers << " timers, " << duration_cast<milliseconds>(scheduled - start).count() << "ms elapsed " << std::endl;
+                std::cout << name << " cancel   : " << timers << " timers, " << duration_cast<milliseconds>(cancelled - scheduled).count() << "ms elapsed " << std::endl;
+            };
+
+            measure("timer_wheel     ", rxsc::make_timer_wheel());
+            measure("thread_pool(1)  ", rxsc::make_thread_pool(1));
+        }
+    }
+}
+
+SCENARIO("timer_wheel timed actions", "[timer_wheel][schedulers]"){
+    GIVEN("a timer_wheel"){
+        auto wheel = std::make_shared<rxsc::timer_wheel>();
+        rxsc::scheduler sc(std::static_pointer_cast<rxsc::scheduler_interface>(wheel));
+        typedef rxsc::scheduler::clock_type clock;
+
+        WHEN("actions are scheduled for later"){
+            countdown finished(4);
+            std::mutex lock;
+            std::vector<int> order;
+            std::vector<bool> late;
+            auto start = sc.now();
+            auto record = [&](int i, clock::time_point due){
+                return [&, i, due](const rxsc::schedulable&){
+                    std::unique_lock<std::mutex> guard(lock);
+                    order.push_back(i);
+                    late.push_back(clock::now() >= due);
+                    finished.count();
+                };
+            };
+            // 150ms is past the first level of the wheel
+            rxsc::schedule(sc, start + std::chrono::milliseconds(150), record(4, start + std::chrono::milliseconds(150)));
+            rxsc::schedule(sc, start + std::chrono::milliseconds(40), record(2, start + std::chrono::milliseconds(40)));
+            rxsc::schedule(sc, start + std::chrono::milliseconds(20), record(1, start + std::chrono::milliseconds(20)));
+            rxsc::schedule(sc, start + std::chrono::milliseconds(90), record(3, start + std::chrono::milliseconds(90)));
+
+            THEN("they run in due order and not early"){
+                REQUIRE(finished.wait());
+                std::unique_lock<std::mutex> guard(lock);
+                int required[] = {1, 2, 3, 4};
+                REQUIRE(order == rxu::to_vector(required));
+                REQUIRE(std::count(late.begin(), late.end(), true) == 4);
+                REQUIRE(wheel->pending() == 0);
+            }
+        }
+
+        WHEN("many timers are spread over several levels"){
+            const int timers = 2000;
+            countdown finished(timers);
+            std::mutex lock;
+            std::vector<clock::time_point> fired;
+            std::atomic<int> early(0);
+            // leave time to schedule them all before the first is due
+            auto start = sc.now() + std::chrono::milliseconds(100);
+            for (int i = 0; i < timers; i++) {
+                auto due = start + std::chrono::microseconds((i * 7919LL) % 300000);
+                rxsc::schedule(sc, due, [&, due](const rxsc::schedulable&){
+                    auto now = clock::now();
+                    if (now < due) {
+                        ++early;
+                    }
+                    std::unique_lock<std::mutex> guard(lock);
+                    fired.push_back(due);
+                    finished.count();
+                });
+            }
+            THEN("each runs once, in due order and not early"){
+                REQUIRE(finished.wait());
+                std::unique_lock<std::mutex> guard(lock);
+                REQUIRE(fired.size() == timers);
+                REQUIRE(early == 0);
+                // timers due within the same tick may run in any order
+                int outOfOrder = 0;
+                for (size_t i = 1; i < fired.size(); ++i) {
+                    if (fired[i] + std::chrono::milliseconds(1) < fired[i - 1]) {
+                        ++outOfOrder;
+                    }
+                }
+                REQUIRE(outOfOrder == 0);
+            }
+        }
+
+        WHEN("an action recurses with a delay"){
+            countdown finished(1);
+            int remaining = 5;
+            rx::composite_subscription cs;
+            rxsc::schedule(sc, cs, [&](const rxsc::schedulable& self){
+                if (--remaining == 0) {
+                    finished.count();
+                    return;
+                }
+                self.schedule(std::chrono::milliseconds(2));
+            });
+            THEN("every iteration runs and no cancel hooks are left behind"){
+                REQUIRE(finished.wait());
+                REQUIRE(remaining == 0);
+                REQUIRE(wheel->pending() == 0);
+            }
+        }
+
+        WHEN("many timers are unsubscribed before they are due"){
+            const int timers = 10000;
+            auto payload = std::make_shared<int>(0);
+            std::weak_ptr<int> watch = payload;
+            std::vector<rx::composite_subscription> lifetimes(timers);
+            std::atomic<int> ran(0);
+            for (int i = 0; i < timers; i++) {
+                rxsc::schedule(sc, lifetimes[i], sc.now() + std::chrono::seconds(60 + i), [payload, &ran](const rxsc::schedulable&){
+                    ++ran;
+                });
+            }
+            payload.reset();
+            REQUIRE(wheel->pending() == timers);
+            for (auto& cs : lifetimes) {
+                cs.unsubscribe();
+            }
+            THEN("they are removed and their actions destroyed at once"){
+                REQUIRE(wheel->pending() == 0);
+                REQUIRE(watch.expired());
+                REQUIRE(ran == 0);
+            }
+        }
+
+        WHEN("the wheel is released while a timer is far from due"){
+            auto other = rxsc::make_timer_wheel();
+            auto payload = std::make_shared<int>(0);
+            std::weak_ptr<int> watch = payload;
+            rxsc::schedule(other, other.now() + std::chrono::hours(1), [payload](const rxsc::schedulable&){});
+            payload.reset();
+            REQUIRE(!watch.expired());
+            other = rxsc::scheduler();
+            THEN("the timer does not keep the wheel alive"){
+                REQUIRE(watch.expired());
+            }
+        }
+    }
+}
@@ -0,0 +1,175 @@
+#define RXCPP_USE_OBSERVABLE_MEMBERS 1
+
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+SCENARIO("iterate test", "[hide][iterate][sources][perf]"){
+    GIVEN("a vector of ten million ints"){
+        WHEN("it is summed"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int count = 10000000;
+            auto v = std::make_shared<std::vector<int>>(count);
+            for (int i = 0; i < count; ++i) {
+                (*v)[i] = i;
+            }
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::iterate(v)
+                    .subscribe([&](const int& x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "iterate : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::from(v->begin(), v->end())
+                    .map([](int x){return x * 2;})
+                    .filter([](int x){return x % 3 != 0;})
+                    .subscribe([&](int x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "from map filter : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
+
+SCENARIO("iterate sends the elements of a collection", "[iterate][sources]"){
+    GIVEN("a shared vector longer than a chunk"){
+        const int count = 5000;
+        auto v = std::make_shared<std::vector<int>>(count);
+        for (int i = 0; i < count; ++i) {
+            (*v)[i] = i;
+        }
+        auto xs = rxs::iterate(v);
+
+        WHEN("it is subscribed twice"){
+            int received = 0;
+            int inplace = 0;
+            int completed = 0;
+            auto observe = [&](){
+                xs.subscribe(
+                    [&](const int& x){
+                        ++received;
+                        if (&x == &(*v)[x]) {
+                            ++inplace;
+                        }
+                    },
+                    [&](){++completed;});
+            };
+            observe();
+            observe();
+
+            THEN("every element is sent by reference from the shared vector"){
+                REQUIRE(received == 2 * count);
+                REQUIRE(inplace == 2 * count);
+                REQUIRE(completed == 2);
+                REQUIRE(v.use_count() == 2);
+            }
+        }
+
+        WHEN("it is unsubscribed in the middle of a chunk"){
+            std::vector<int> got;
+            rx::composite_subscription cs;
+            xs.subscribe(
+                cs,
+                [&](int x){
+                    got.push_back(x);
+                    if (x == 4) {
+                        cs.unsubscribe();
+                    }
+                });
+
+            THEN("no elements arrive after the unsubscribe"){
+                int required[] = {0, 1, 2, 3, 4};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("it is regulated"){
+            rx::regulator r(0);
+            int received = 0;
+            xs
+                .filter([](int x){return x % 2 == 0;})
+                .subscribe(
+                    r.get_resumption(),
+                    [&](int){++received;});
+
+            THEN("the credit is spent on the elements that pass the filter"){
+                REQUIRE(received == 0);
+                r.request(1500);
+                REQUIRE(received == 1500);
+                r.request(5000);
+                REQUIRE(received == count / 2);
+            }
+        }
+    }
+
+    GIVEN("a vector moved into iterate"){
+        std::vector<std::string> v;
+        v.push_back("a");
+        v.push_back("b");
+        v.push_back("c");
+        auto data = v.data();
+        auto xs = rxs::iterate(std::move(v));
+
+        WHEN("it is mapped"){
+            std::vector<std::string> got;
+            bool inplace = false;
+            xs
+                .map([&](const std::string& s){
+                    inplace = inplace || &s == data;
+                    return s + s;
+                })
+                .subscribe([&](const std::string& s){got.push_back(s);});
+
+            THEN("the elements of the moved vector are sent"){
+                std::string required[] = {"aa", "bb", "cc"};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(inplace);
+            }
+        }
+    }
+}
+
+SCENARIO("from sends the values between two iterators", "[from][sources]"){
+    GIVEN("an array"){
+        const int values[] = {1, 2, 3, 4};
+
+        WHEN("a part of it is subscribed"){
+            std::vector<int> got;
+            bool completed = false;
+            rxs::from(values + 1, values + 4)
+                .subscribe(
+                    [&](int x){got.push_back(x);},
+                    [&](){completed = true;});
+
+            THEN("the values between the iterators arrive in order"){
+                int required[] = {2, 3, 4};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(completed);
+            }
+        }
+
+        WHEN("the iterators are equal"){
+            int received = 0;
+            bool completed = false;
+            rx::observable<>::from(values, values)
+                .subscribe(
+                    [&](int){++received;},
+                    [&](){completed = true;});
+
+            THEN("only on_completed arrives"){
+                REQUIRE(received == 0);
+                REQUIRE(completed);
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#define RXCPP_USE_OBSERVABLE_MEMBERS 1
+
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+
+#include "catch.hpp"
+
+SCENARIO("range test", "[hide][range][sources][perf]"){
+    GIVEN("a range of ten million ints"){
+        WHEN("it is summed"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int count = 10000000;
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .subscribe([&](int x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "range : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+            {
+                long long sum = 0;
+                auto start = clock::now();
+                rxs::range<int>(0, count)
+                    .map([](int x){return x * 2;})
+                    .filter([](int x){return x % 3 != 0;})
+                    .subscribe([&](int x){sum += x;});
+                auto msElapsed = duration_cast<milliseconds>(clock::now() - start);
+                std::cout << "range map filter : " << sum << " sum, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
+
+SCENARIO("range sends every value across chunks", "[range][sources]"){
+    GIVEN("a range longer than a chunk"){
+        const int count = 5000;
+        auto xs = rxs::range<int>(0, count);
+
+        WHEN("it is subscribed"){
+            int received = 0;
+            long long sum = 0;
+            bool completed = false;
+            xs.subscribe(
+                [&](int x){++received; sum += x;},
+                [&](){completed = true;});
+
+            THEN("every value arrives once before on_completed"){
+                REQUIRE(received == count);
+                REQUIRE(sum == (long long)count * (count - 1) / 2);
+                REQUIRE(completed);
+            }
+        }
+
+        WHEN("it is unsubscribed in the middle of a chunk"){
+            std::vector<int> got;
+            rx::composite_subscription cs;
+            xs.subscribe(
+                cs,
+                [&](int x){
+                    got.push_back(x);
+                    if (x == 4) {
+                        cs.unsubscribe();
+                    }
+                });
+
+            THEN("no values arrive after the unsubscribe"){
+                int required[] = {0, 1, 2, 3, 4};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("it is regulated"){
+            rx::regulator r(0);
+            int received = 0;
+            xs
+                .filter([](int x){return x % 2 == 0;})
+                .subscribe(
+                    r.get_resumption(),
+                    [&](int){++received;});
+
+            THEN("the credit is spent on the values that pass the filter"){
+                REQUIRE(received == 0);
+                r.request(1500);
+                REQUIRE(received == 1500);
+                r.request(5000);
+                REQUIRE(received == count / 2);
+            }
+        }
+    }
+}
+
+SCENARIO("range yields to waiting work", "[range][sources]"){
+    GIVEN("a range on the current thread"){
+        auto sc = rxsc::make_current_thread();
+
+        WHEN("a value schedules more work on the same thread"){
+            std::vector<std::string> got;
+            rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                rxs::range<int>(1, 3, 1, sc)
+                    .subscribe([&](int x){
+                        got.push_back(std::to_string(x));
+                        if (x == 1) {
+                            rxsc::schedule(sc, [&](const rxsc::schedulable&){
+                                got.push_back("action");
+                            });
+                        }
+                    });
+            });
+
+            THEN("the work runs before the next value"){
+                std::string required[] = {"1", "action", "2", "3"};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+    }
+}
@@ -0,0 +1,506 @@
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+namespace rxsub=rxcpp::subjects;
+namespace rxn=rxcpp::notifications;
+
+#include "rxcpp/rx-test.hpp"
+namespace rxt=rxcpp::test;
+
+#include "catch.hpp"
+
+SCENARIO("concurrent_subject test", "[hide][concurrent_subject][subjects][perf]"){
+    GIVEN("a concurrent_subject with 10k subscribers"){
+        WHEN("several threads call on_next at once"){
+            using namespace std::chrono;
+            typedef steady_clock clock;
+
+            const int subscribers = 10000;
+            const int onnextcalls = 3200;
+
+            {
+                rxsub::subject<int> sub;
+                for (int i = 0; i < subscribers; i++) {
+                    sub.get_observable().subscribe(
+                        [](int){},
+                        [](std::exception_ptr){abort();});
+                }
+
+                auto o = sub.get_subscriber();
+
+                auto start = clock::now();
+                for (int i = 0; i < onnextcalls; i++) {
+                    o.on_next(i);
+                }
+                auto finish = clock::now();
+                o.on_completed();
+                auto msElapsed = duration_cast<milliseconds>(finish.time_since_epoch()) -
+                       duration_cast<milliseconds>(start.time_since_epoch());
+                std::cout << "loop -> subject               : 1 producers, " << subscribers << " subscribed, " << (onnextcalls * subscribers) << " on_next calls, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+
+            for (int producers = 1; producers <= 32; producers *= 2)
+            {
+                rxsub::concurrent_subject<int> sub;
+                for (int i = 0; i < subscribers; i++) {
+                    // subscribers do not share state, so only the subject itself is measured
+                    sub.get_observable().subscribe(
+                        [](int){},
+                        [](std::exception_ptr){abort();});
+                }
+
+                auto o = sub.get_subscriber();
+
+                std::vector<std::thread> threads;
+                auto start = clock::now();
+                for (int p = 0; p < producers; p++) {
+                    threads.push_back(std::thread([o, producers, onnextcalls](){
+                        for (int i = 0; i < onnextcalls / producers; i++) {
+                            o.on_next(i);
+                        }
+                    }));
+                }
+                for (auto& t : threads) {
+                    t.join();
+                }
+                auto finish = clock::now();
+                o.on_completed();
+                auto msElapsed = duration_cast<milliseconds>(finish.time_since_epoch()) -
+                       duration_cast<milliseconds>(start.time_since_epoch());
+                std::cout << "threads -> concurrent_subject : " << producers << " producers, " << subscribers << " subscribed, " << (onnextcalls * subscribers) << " on_next calls, " << msElapsed.count() << "ms elapsed " << std::endl;
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - multiple producers", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject with several subscribers"){
+        const int subscribers = 8;
+        const int producers = 4;
+        const int onnextcalls = 10000;
+
+        rxsub::concurrent_subject<int> sub;
+
+        std::vector<std::shared_ptr<std::atomic<int>>> counts;
+        auto completions = std::make_shared<std::atomic<int>>(0);
+        for (int i = 0; i < subscribers; i++) {
+            auto c = std::make_shared<std::atomic<int>>(0);
+            counts.push_back(c);
+            sub.get_observable().subscribe(
+                [c](int){
+                    ++(*c);
+                },
+                [](std::exception_ptr){abort();},
+                [completions](){
+                    ++(*completions);
+                });
+        }
+
+        WHEN("each producer calls on_next from its own thread"){
+
+            auto o = sub.get_subscriber();
+
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++) {
+                threads.push_back(std::thread([o, onnextcalls](){
+                    for (int i = 0; i < onnextcalls; i++) {
+                        o.on_next(i);
+                    }
+                }));
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            o.on_completed();
+
+            THEN("every subscriber received every value"){
+                for (auto& c : counts) {
+                    REQUIRE(c->load() == producers * onnextcalls);
+                }
+            }
+
+            THEN("every subscriber completed once"){
+                REQUIRE(completions->load() == subscribers);
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - subscribe and unsubscribe while producing", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject and a producer thread"){
+        rxsub::concurrent_subject<int> sub;
+
+        auto stable = std::make_shared<std::atomic<int>>(0);
+        sub.get_observable().subscribe(
+            [stable](int){
+                ++(*stable);
+            },
+            [](std::exception_ptr){abort();});
+
+        WHEN("other threads churn subscribers"){
+            const int onnextcalls = 20000;
+            const int churners = 2;
+            const int churn = 500;
+
+            auto o = sub.get_subscriber();
+
+            std::vector<std::thread> threads;
+            threads.push_back(std::thread([o, onnextcalls](){
+                for (int i = 0; i < onnextcalls; i++) {
+                    o.on_next(i);
+                }
+            }));
+            for (int t = 0; t < churners; t++) {
+                threads.push_back(std::thread([sub, churn](){
+                    for (int i = 0; i < churn; i++) {
+                        rx::composite_subscription cs;
+                        sub.get_observable().subscribe(cs, [](int){}, [](std::exception_ptr){abort();});
+                        if (i % 3 != 0) {
+                            cs.unsubscribe();
+                        }
+                    }
+                }));
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+
+            THEN("the stable subscriber received every value"){
+                REQUIRE(stable->load() == onnextcalls);
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - unsubscribed observers", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject with many subscribers"){
+        const int subscribers = 200;
+
+        rxsub::concurrent_subject<int> sub;
+
+        auto c = std::make_shared<int>(0);
+        std::vector<rx::composite_subscription> lifetimes;
+        for (int i = 0; i < subscribers; i++) {
+            rx::composite_subscription cs;
+            lifetimes.push_back(cs);
+            sub.get_observable().subscribe(cs,
+                [c](int){
+                    ++(*c);
+                },
+                [](std::exception_ptr){abort();});
+        }
+
+        WHEN("most of them unsubscribe"){
+            for (int i = 0; i < subscribers; i++) {
+                if (i % 10 != 0) {
+                    lifetimes[i].unsubscribe();
+                }
+            }
+
+            auto o = sub.get_subscriber();
+            o.on_next(1);
+
+            THEN("only the remaining subscribers receive values"){
+                REQUIRE(*c == subscribers / 10);
+                REQUIRE(sub.has_observers());
+            }
+
+            THEN("the remaining subscribers are still reached after more subscribe"){
+                auto late = std::make_shared<int>(0);
+                sub.get_observable().subscribe(
+                    [late](int){
+                        ++(*late);
+                    },
+                    [](std::exception_ptr){abort();});
+                o.on_next(2);
+                REQUIRE(*c == 2 * (subscribers / 10));
+                REQUIRE(*late == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - observers that unsubscribed", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject with one subscriber"){
+        rxsub::concurrent_subject<int> sub;
+        rx::composite_subscription cs;
+        sub.get_observable().subscribe(cs, [](int){});
+
+        WHEN("it unsubscribes"){
+            REQUIRE(sub.has_observers());
+            cs.unsubscribe();
+
+            THEN("the subject has no observers"){
+                REQUIRE(!sub.has_observers());
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - completion", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject"){
+        rxsub::concurrent_subject<int> sub;
+
+        WHEN("on_completed is called while another thread calls on_next"){
+            const int rounds = 200;
+            int late = 0;
+            int completions = 0;
+            for (int r = 0; r < rounds; r++) {
+                rxsub::concurrent_subject<int> round;
+                auto completed = std::make_shared<std::atomic<bool>>(false);
+                auto after = std::make_shared<std::atomic<int>>(0);
+                auto count = std::make_shared<std::atomic<int>>(0);
+                round.get_observable().subscribe(
+                    [completed, after](int){
+                        if (*completed) {
+                            ++(*after);
+                        }
+                        std::this_thread::yield();
+                    },
+                    [completed, count](){
+                        *completed = true;
+                        ++(*count);
+                    });
+                // the producer has its own subscriber, it is not
+                // unsubscribed by the on_completed of the other
+                auto o = round.get_subscriber();
+                std::thread producer([o](){
+                    for (int i = 0; i < 100; i++) {
+                        o.on_next(i);
+                    }
+                });
+                std::this_thread::yield();
+                round.get_subscriber().on_completed();
+                producer.join();
+                late += after->load();
+                completions += count->load();
+            }
+
+            THEN("no on_next arrives after on_completed"){
+                REQUIRE(late == 0);
+                REQUIRE(completions == rounds);
+            }
+        }
+
+        WHEN("an observer completes the subject from its on_next"){
+            std::vector<std::string> got;
+            auto o = sub.get_subscriber();
+            sub.get_observable().subscribe(
+                [&](int){
+                    got.push_back("first");
+                    o.on_completed();
+                },
+                [&](){got.push_back("first completed");});
+            sub.get_observable().subscribe(
+                [&](int){got.push_back("second");},
+                [&](){got.push_back("second completed");});
+            o.on_next(1);
+
+            THEN("the on_next reaches every observer before on_completed"){
+                std::string required[] = {"first", "second", "first completed", "second completed"};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+    }
+}
+
+SCENARIO("concurrent_subject - finite source", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject and an finite source"){
+
+        auto sc = rxsc::make_test();
+        typedef rxsc::test::messages<int> m;
+        typedef rxn::subscription life;
+        typedef m::recorded_type record;
+        auto on_next = m::on_next;
+        auto on_error = m::on_error;
+        auto on_completed = m::on_completed;
+
+        record messages[] = {
+            on_next(70, 1),
+            on_next(110, 2),
+            on_next(220, 3),
+            on_next(270, 4),
+            on_next(340, 5),
+            on_next(410, 6),
+            on_next(520, 7),
+            on_completed(630),
+            on_next(640, 9),
+            on_completed(650),
+            on_error(660, std::runtime_error("error on unsubscribed stream"))
+        };
+        auto xs = sc.make_hot_observable(messages);
+
+        rxsub::concurrent_subject<int> s;
+
+        auto results1 = sc.make_subscriber<int>();
+
+        auto results2 = sc.make_subscriber<int>();
+
+        auto results3 = sc.make_subscriber<int>();
+
+        WHEN("multicasting an infinite source"){
+
+            auto o = s.get_subscriber();
+
+            sc.schedule_absolute(100, [&s, &o](const rxsc::schedulable& scbl){
+                s = rxsub::concurrent_subject<int>(); o = s.get_subscriber();});
+            sc.schedule_absolute(200, [&xs, &o](const rxsc::schedulable& scbl){
+                xs.subscribe(o);});
+            sc.schedule_absolute(1000, [&o](const rxsc::schedulable& scbl){
+                o.unsubscribe();});
+
+            sc.schedule_absolute(300, [&s, &results1](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results1);});
+            sc.schedule_absolute(400, [&s, &results2](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results2);});
+            sc.schedule_absolute(900, [&s, &results3](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results3);});
+
+            sc.schedule_absolute(600, [&results1](const rxsc::schedulable& scbl){
+                results1.unsubscribe();});
+            sc.schedule_absolute(700, [&results2](const rxsc::schedulable& scbl){
+                results2.unsubscribe();});
+            sc.schedule_absolute(800, [&results1](const rxsc::schedulable& scbl){
+                results1.unsubscribe();});
+            sc.schedule_absolute(950, [&results3](const rxsc::schedulable& scbl){
+                results3.unsubscribe();});
+
+            sc.start();
+
+            THEN("result1 contains expected messages"){
+                record items[] = {
+                    on_next(340, 5),
+                    on_next(410, 6),
+                    on_next(520, 7)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results1.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+            THEN("result2 contains expected messages"){
+                record items[] = {
+                    on_next(410, 6),
+                    on_next(520, 7),
+                    on_completed(630)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results2.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+            THEN("result3 contains expected messages"){
+                record items[] = {
+                    on_completed(900)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results3.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+        }
+    }
+}
+
+
+SCENARIO("concurrent_subject - on_error in source", "[concurrent_subject][subjects]"){
+    GIVEN("a concurrent_subject and a source with an error"){
+
+        auto sc = rxsc::make_test();
+        typedef rxsc::test::messages<int> m;
+        typedef rxn::subscription life;
+        typedef m::recorded_type record;
+        auto on_next = m::on_next;
+        auto on_error = m::on_error;
+        auto on_completed = m::on_completed;
+
+        std::runtime_error ex("concurrent_subject on_error in stream");
+
+        record messages[] = {
+            on_next(70, 1),
+            on_next(110, 2),
+            on_next(220, 3),
+            on_next(270, 4),
+            on_next(340, 5),
+            on_next(410, 6),
+            on_next(520, 7),
+            on_error(630, ex),
+            on_next(640, 9),
+            on_completed(650),
+            on_error(660, std::runtime_error("error on unsubscribed stream"))
+        };
+        auto xs = sc.make_hot_observable(messages);
+
+        rxsub::concurrent_subject<int> s;
+
+        auto results1 = sc.make_subscriber<int>();
+
+        auto results2 = sc.make_subscriber<int>();
+
+        auto results3 = sc.make_subscriber<int>();
+
+        WHEN("multicasting an infinite source"){
+
+            auto o = s.get_subscriber();
+
+            sc.schedule_absolute(100, [&s, &o](const rxsc::schedulable& scbl){
+                s = rxsub::concurrent_subject<int>(); o = s.get_subscriber();});
+            sc.schedule_absolute(200, [&xs, &o](const rxsc::schedulable& scbl){
+                xs.subscribe(o);});
+            sc.schedule_absolute(1000, [&o](const rxsc::schedulable& scbl){
+                o.unsubscribe();});
+
+            sc.schedule_absolute(300, [&s, &results1](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results1);});
+            sc.schedule_absolute(400, [&s, &results2](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results2);});
+            sc.schedule_absolute(900, [&s, &results3](const rxsc::schedulable& scbl){
+                s.get_observable().subscribe(results3);});
+
+            sc.schedule_absolute(600, [&results1](const rxsc::schedulable& scbl){
+                results1.unsubscribe();});
+            sc.schedule_absolute(700, [&results2](const rxsc::schedulable& scbl){
+                results2.unsubscribe();});
+            sc.schedule_absolute(800, [&results1](const rxsc::schedulable& scbl){
+                results1.unsubscribe();});
+            sc.schedule_absolute(950, [&results3](const rxsc::schedulable& scbl){
+                results3.unsubscribe();});
+
+            sc.start();
+
+            THEN("result1 contains expected messages"){
+                record items[] = {
+                    on_next(340, 5),
+                    on_next(410, 6),
+                    on_next(520, 7)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results1.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+            THEN("result2 contains expected messages"){
+                record items[] = {
+                    on_next(410, 6),
+                    on_next(520, 7),
+                    on_error(630, ex)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results2.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+            THEN("result3 contains expected messages"){
+                record items[] = {
+                    on_error(900, ex)
+                };
+                auto required = rxu::to_vector(items);
+                auto actual = results3.get_observer().messages();
+                REQUIRE(required == actual);
+            }
+
+        }
+    }
+}
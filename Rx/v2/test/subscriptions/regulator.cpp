@@ -0,0 +1,223 @@
+#define RXCPP_USE_OBSERVABLE_MEMBERS 1
+
+#include "rxcpp/rx.hpp"
+namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxo=rxcpp::operators;
+namespace rxs=rxcpp::sources;
+namespace rxsc=rxcpp::schedulers;
+namespace rxsub=rxcpp::subjects;
+
+#include "catch.hpp"
+
+SCENARIO("range is regulated", "[regulator][subscriptions]"){
+    GIVEN("a regulator without credit"){
+        rx::regulator r(0);
+        std::vector<int> got;
+        bool completed = false;
+
+        WHEN("a range is subscribed"){
+            rxs::range<int>(1, 10).subscribe(
+                r.get_resumption(),
+                [&](int v){got.push_back(v);},
+                [&](){completed = true;});
+
+            THEN("values are only sent for the credit requested"){
+                REQUIRE(got.empty());
+                r.request(3);
+                int required[] = {1, 2, 3};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(!completed);
+                r.request(100);
+                REQUIRE(got.size() == 10);
+                REQUIRE(completed);
+            }
+        }
+
+        WHEN("the regulator is paused and resumed"){
+            rx::regulator p(2);
+            rxs::range<int>(1, 10).subscribe(
+                p.get_resumption(),
+                [&](int v){
+                    got.push_back(v);
+                    if (v == 1) {
+                        p.pause();
+                    }
+                },
+                [&](){completed = true;});
+
+            THEN("the source waits while paused"){
+                REQUIRE(got.size() == 1);
+                p.resume();
+                REQUIRE(got.size() == 10);
+                REQUIRE(completed);
+            }
+        }
+    }
+}
+
+SCENARIO("operators pass credit through", "[regulator][subscriptions]"){
+    GIVEN("a regulator with a little credit"){
+        std::vector<int> got;
+
+        WHEN("values are filtered"){
+            rx::regulator r(3);
+            rxs::range<int>(1, 10)
+                .filter([](int v){return v % 2 == 0;})
+                .subscribe(r.get_resumption(), [&](int v){got.push_back(v);});
+
+            THEN("each dropped value is replaced"){
+                int required[] = {2, 4, 6};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("values are mapped"){
+            rx::regulator r(2);
+            rxs::range<int>(1, 10)
+                .map([](int v){return v * 10;})
+                .subscribe(r.get_resumption(), [&](int v){got.push_back(v);});
+
+            THEN("map uses the same credit"){
+                int required[] = {10, 20};
+                REQUIRE(got == rxu::to_vector(required));
+            }
+        }
+
+        WHEN("collections are merged with flat_map"){
+            rx::regulator r(4);
+            bool completed = false;
+            rxs::range<int>(0, 3)
+                .flat_map(
+                    [](int v){return rxs::range<int>(v * 10, 3);},
+                    [](int, int v){return v;})
+                .subscribe(
+                    r.get_resumption(),
+                    [&](int v){got.push_back(v);},
+                    [&](){completed = true;});
+
+            THEN("the inner sources share the credit"){
+                REQUIRE(got.size() == 4);
+                r.request(100);
+                std::sort(got.begin(), got.end());
+                int required[] = {0, 1, 2, 10, 11, 12, 20, 21, 22};
+                REQUIRE(got == rxu::to_vector(required));
+                REQUIRE(completed);
+            }
+        }
+
+        WHEN("flat_map has a concurrency limit"){
+            rx::regulator r(1);
+            int selected = 0;
+            rxs::range<int>(0, 3)
+                .flat_map(
+                    [&](int v){++selected; return rxs::range<int>(v * 10, 3);},
+                    [](int, int v){return v;},
+                    1)
+                .subscribe(r.get_resumption(), [&](int v){got.push_back(v);});
+
+            THEN("the outer source only runs ahead for free slots"){
+                REQUIRE(got.size() == 1);
+                REQUIRE(selected == 1);
+                r.request(100);
+                REQUIRE(got.size() == 9);
+                REQUIRE(selected == 3);
+            }
+        }
+    }
+}
+
+SCENARIO("subject is regulated by its observers", "[regulator][subject][subjects]"){
+    GIVEN("a subject with two regulated observers"){
+        rxsub::subject<int> s;
+        rx::regulator fast(5);
+        rx::regulator slow(2);
+        std::vector<int> fastGot;
+        std::vector<int> slowGot;
+        s.get_observable().subscribe(fast.get_resumption(), [&](int v){fastGot.push_back(v);});
+        s.get_observable().subscribe(slow.get_resumption(), [&](int v){slowGot.push_back(v);});
+
+        WHEN("a range is subscribed to the subject"){
+            rxs::range<int>(0, 10).subscribe(s.get_subscriber());
+
+            THEN("the slowest observer sets the pace"){
+                REQUIRE(fastGot.size() == 2);
+                REQUIRE(slowGot.size() == 2);
+                slow.request(10);
+                REQUIRE(fastGot.size() == 5);
+                REQUIRE(slowGot.size() == 5);
+                fast.request(10);
+                REQUIRE(fastGot.size() == 10);
+                REQUIRE(slowGot == fastGot);
+            }
+        }
+    }
+}
+
+SCENARIO("regulated source with a slow consumer", "[regulator][subscriptions]"){
+    GIVEN("a consumer a thousand times slower than the source"){
+        const int count = 2000;
+        const int window = 16;
+        const int batch = 8;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<int> queue;
+        std::size_t maxQueued = 0;
+        bool completed = false;
+
+        rx::regulator r(window);
+
+        WHEN("the values are queued across threads"){
+            std::thread producer([&](){
+                rxs::range<int>(0, count * 2)
+                    .filter([](int v){return v % 2 == 0;})
+                    .map([](int v){return v / 2;})
+                    .subscribe(
+                        r.get_resumption(),
+                        [&](int v){
+                            std::unique_lock<std::mutex> guard(lock);
+                            queue.push_back(v);
+                            maxQueued = std::max(maxQueued, queue.size());
+                            wake.notify_one();
+                        },
+                        [&](){
+                            std::unique_lock<std::mutex> guard(lock);
+                            completed = true;
+                            wake.notify_one();
+                        });
+            });
+
+            std::vector<int> got;
+            for (;;) {
+                int v = 0;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [&](){return !queue.empty() || completed;});
+                    if (queue.empty()) {
+                        break;
+                    }
+                    v = queue.front();
+                    queue.pop_front();
+                }
+                // about 1000 times the cost of sending a value
+                auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(100);
+                while (std::chrono::steady_clock::now() < until);
+                got.push_back(v);
+                if (got.size() % batch == 0) {
+                    // the parked source may run here, so the lock must not be held
+                    r.request(batch);
+                }
+            }
+            producer.join();
+
+            THEN("the queue never holds more than the credit"){
+                REQUIRE(got.size() == count);
+                REQUIRE(maxQueued <= window);
+                for (int i = 0; i < count; ++i) {
+                    REQUIRE(got[i] == i);
+                }
+            }
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "rxcpp/rx.hpp"
 namespace rx=rxcpp;
+namespace rxu=rxcpp::util;
+namespace rxsc=rxcpp::schedulers;
 
 #include "catch.hpp"
 
@@ -179,3 +181,272 @@ SCENARIO("subscription composite", "[subscription]"){
     }
 }
 
+SCENARIO("subscription composite remove", "[subscription]"){
+    GIVEN("given a subscription with three children"){
+        int i=0;
+        rx::composite_subscription s;
+        auto first = s.add(rx::make_subscription([&i](){++i;}));
+        auto second = s.add(rx::make_subscription([&i](){i+=10;}));
+        auto third = s.add(rx::make_subscription([&i](){i+=100;}));
+        WHEN("the second child is removed"){
+            s.remove(second);
+            THEN("the removed child is not unsubscribed"){
+                REQUIRE(i == 0);
+            }
+            THEN("i is 101 when unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(i == 101);
+            }
+            THEN("removing the same token again has no effect"){
+                s.remove(second);
+                s.unsubscribe();
+                REQUIRE(i == 101);
+            }
+        }
+        WHEN("a stale token is removed after its slot is reused"){
+            s.remove(first);
+            auto fourth = s.add(rx::make_subscription([&i](){i+=1000;}));
+            s.remove(first);
+            THEN("the new child is still unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(i == 1110);
+            }
+        }
+        WHEN("the same shared child is added twice"){
+            auto shared = std::make_shared<rx::dynamic_subscription>([&i](){i+=1000;});
+            auto once = s.add(shared);
+            s.add(shared);
+            THEN("it is unsubscribed once"){
+                s.unsubscribe();
+                REQUIRE(i == 1111);
+            }
+            THEN("removing it once removes it"){
+                s.remove(once);
+                s.unsubscribe();
+                REQUIRE(i == 111);
+            }
+        }
+        WHEN("a default token is removed"){
+            s.remove(rx::composite_subscription::weak_subscription());
+            THEN("all children are unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(i == 111);
+            }
+        }
+    }
+}
+
+SCENARIO("subscription composite many children", "[subscription]"){
+    GIVEN("given a subscription with more children than fit inline"){
+        int i=0;
+        rx::composite_subscription s;
+        std::vector<rx::composite_subscription::weak_subscription> tokens;
+        for (int n = 0; n < 1000; ++n) {
+            tokens.push_back(s.add(rx::make_subscription([&i](){++i;})));
+        }
+        WHEN("every other child is removed"){
+            for (int n = 0; n < 1000; n += 2) {
+                s.remove(tokens[n]);
+            }
+            THEN("i is 500 when unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(i == 500);
+            }
+            THEN("i is 500 when cleared and the subscription is still subscribed"){
+                s.clear();
+                REQUIRE(i == 500);
+                REQUIRE(s.is_subscribed());
+            }
+        }
+        WHEN("a child is added after unsubscribe"){
+            s.unsubscribe();
+            s.add(rx::make_subscription([&i](){++i;}));
+            THEN("the child is unsubscribed immediately"){
+                REQUIRE(i == 1001);
+            }
+        }
+    }
+}
+
+SCENARIO("subscription composite concurrent add and remove", "[subscription]"){
+    GIVEN("given a subscription shared by several threads"){
+        const int threads = 4;
+        const int children = 10000;
+        std::vector<std::unique_ptr<std::atomic<int>[]>> counts(threads);
+        for (auto& c : counts) {
+            c.reset(new std::atomic<int>[children]);
+            for (int n = 0; n < children; ++n) {
+                c[n] = 0;
+            }
+        }
+        rx::composite_subscription s;
+        WHEN("each thread adds and removes children while the subscription is unsubscribed"){
+            std::vector<std::future<void>> f(threads);
+            for (int t = 0; t < threads; ++t) {
+                auto c = counts[t].get();
+                f[t] = std::async(std::launch::async, [&s, c, children](){
+                    for (int n = 0; n < children; ++n) {
+                        auto counter = c + n;
+                        auto token = s.add(rx::make_subscription([counter](){++(*counter);}));
+                        if (n % 2 == 0) {
+                            s.remove(token);
+                        }
+                    }
+                });
+            }
+            std::this_thread::yield();
+            s.unsubscribe();
+            for (auto& t : f) {
+                t.get();
+            }
+            THEN("no child is unsubscribed more than once and every child that was not removed is unsubscribed"){
+                int twice = 0;
+                int missed = 0;
+                for (auto& c : counts) {
+                    for (int n = 0; n < children; ++n) {
+                        twice += c[n] > 1 ? 1 : 0;
+                        missed += (n % 2 != 0 && c[n] != 1) ? 1 : 0;
+                    }
+                }
+                REQUIRE(twice == 0);
+                REQUIRE(missed == 0);
+            }
+        }
+    }
+}
+
+namespace {
+// models the composite_subscription that took a lock and
+// searched a vector of shared_ptr on every add and remove
+struct locked_vector_subscription
+{
+    typedef std::shared_ptr<rx::dynamic_subscription> shared_subscription;
+    std::vector<shared_subscription> subscriptions;
+    std::recursive_mutex lock;
+
+    std::weak_ptr<rx::dynamic_subscription> add(rx::dynamic_subscription d) {
+        auto s = std::make_shared<rx::dynamic_subscription>(std::move(d));
+        std::unique_lock<std::recursive_mutex> guard(lock);
+        if (std::find(subscriptions.begin(), subscriptions.end(), s) == subscriptions.end()) {
+            subscriptions.push_back(s);
+        }
+        return s;
+    }
+    void remove(std::weak_ptr<rx::dynamic_subscription> w) {
+        std::unique_lock<std::recursive_mutex> guard(lock);
+        auto s = w.lock();
+        auto it = std::find(subscriptions.begin(), subscriptions.end(), s);
+        if (it != subscriptions.end()) {
+            subscriptions.erase(it);
+        }
+    }
+    void unsubscribe() {
+        std::unique_lock<std::recursive_mutex> guard(lock);
+        std::vector<shared_subscription> v(std::move(subscriptions));
+        for (auto& s : v) {
+            s->unsubscribe();
+        }
+    }
+};
+
+template<class Subscription>
+void composite_churn(const char* name, int children)
+{
+    using namespace std::chrono;
+    typedef steady_clock clock;
+
+    int c = 0;
+    std::vector<decltype(std::declval<Subscription&>().add(std::declval<rx::dynamic_subscription>()))> tokens;
+    tokens.reserve(children);
+
+    Subscription s;
+    auto start = clock::now();
+    for (int i = 0; i < children; ++i) {
+        tokens.push_back(s.add(rx::dynamic_subscription([&c](){++c;})));
+    }
+    auto added = clock::now();
+    for (int i = 0; i < children; i += 2) {
+        s.remove(tokens[i]);
+    }
+    auto removed = clock::now();
+    s.unsubscribe();
+    auto finish = clock::now();
+
+    std::cout << name << " : " << children << " children, "
+              << duration_cast<microseconds>(added - start).count() << "us add, "
+              << duration_cast<microseconds>(removed - added).count() << "us remove half, "
+              << duration_cast<microseconds>(finish - removed).count() << "us unsubscribe, "
+              << c << " unsubscribed" << std::endl;
+}
+}
+
+SCENARIO("subscription composite churn", "[hide][subscription][perf]"){
+    GIVEN("a composite subscription"){
+        WHEN("adding, removing and unsubscribing 10k children"){
+            composite_churn<locked_vector_subscription>("locked vector (before)", 10000);
+            composite_churn<rx::composite_subscription>("composite (after)     ", 10000);
+        }
+    }
+}
+
+SCENARIO("dynamic_subscription storage", "[subscription]"){
+    GIVEN("unsubscribe functions of different sizes"){
+        auto a = std::make_shared<int>(0);
+        auto b = std::make_shared<int>(0);
+        auto c = std::make_shared<int>(0);
+        auto small = [a, b, c](){++(*a); ++(*b); ++(*c);};
+        struct large_type {
+            std::shared_ptr<int> counter;
+            int padding[64];
+            void operator()() const {++(*counter);}
+        } large = {a, {}};
+        int moveonlycount = 0;
+        struct move_only_type {
+            std::unique_ptr<int> owned;
+            int* count;
+            void operator()() const {++(*count);}
+        } moveonly = {std::unique_ptr<int>(new int(0)), &moveonlycount};
+        WHEN("the sizes are checked"){
+            typedef rxu::detail::small_function<void()> function_type;
+            THEN("a lambda that captures three shared_ptr is stored inline"){
+                REQUIRE(function_type::fits_inline<decltype(small)>::value);
+            }
+            THEN("a large function object is not stored inline"){
+                REQUIRE(!function_type::fits_inline<large_type>::value);
+            }
+            THEN("an action that captures a dynamic subscriber is stored inline"){
+                auto o = rx::make_subscriber<int>(rx::make_observer_dynamic<int>([](int){}));
+                auto fn = [o, a](const rxsc::schedulable&){};
+                REQUIRE(rxsc::detail::action_type::function_type::fits_inline<rxsc::detail::action_tailrecurser<decltype(fn)>>::value);
+            }
+        }
+        WHEN("each is used as a subscription"){
+            rx::composite_subscription s;
+            s.add(rx::dynamic_subscription(small));
+            s.add(rx::dynamic_subscription(large));
+            s.add(rx::dynamic_subscription(std::move(moveonly)));
+            THEN("each is called once when unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(*a == 2);
+                REQUIRE(*b == 1);
+                REQUIRE(*c == 1);
+                REQUIRE(moveonlycount == 1);
+            }
+            THEN("the captures are released when unsubscribed"){
+                s.unsubscribe();
+                REQUIRE(b.use_count() == 2);
+                REQUIRE(c.use_count() == 2);
+            }
+        }
+        WHEN("a mutable lambda is called twice"){
+            int seen = 0;
+            int n = 0;
+            rxu::detail::small_function<void()> f([&seen, n]() mutable {seen = ++n;});
+            f();
+            f();
+            THEN("it keeps its own state between calls"){
+                REQUIRE(seen == 2);
+            }
+        }
+    }
+}